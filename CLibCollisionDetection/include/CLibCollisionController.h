@@ -26,6 +26,12 @@ namespace simobj {
 	}
 }
 
+namespace collision {
+	namespace octtree {
+		class TreeStats;
+	}
+}
+
 namespace clib
 {
 	// Aliases for used namespaces
@@ -42,6 +48,7 @@ namespace clib
 	using ShapePtr = std::shared_ptr<simobj::shapes::Shape>;
 	using simobj::shapes::ShapeType;
 	using collision::CollisionDetection;
+	using collision::octtree::TreeStats;
 
 	/**
 		\brief Helper function to create a site specification with a locally unique (i.e. within an agent) id,
@@ -270,6 +277,15 @@ namespace clib
 		*/
 		CLIB_COLLISION_DETECTION_API bool displayClusterCollisionTree(const unsigned long& clusterId);
 
+		/**
+			\brief Get statistics about the shape and memory usage of the oct tree of the agent cluster with the given ID,
+			e.g. to see the impact of the minimal leaf diameter and the initial root diameter.
+			\param[in] clusterId Unique identifier of an agent cluster.
+			\param[out] stats Node, leaf and id counts, depth and occupancy histograms, number of resizes and bytes used by the tree.
+			\returns True if no error was logged.
+		*/
+		CLIB_COLLISION_DETECTION_API bool getClusterTreeStats(const unsigned long& clusterId, TreeStats& stats);
+
 		/**
 			\brief Packs the controllers's internal information into a formatted readable string.
 		*/
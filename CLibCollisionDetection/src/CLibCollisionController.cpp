@@ -45,7 +45,6 @@ namespace clib {
 	CLIB_COLLISION_DETECTION_API CLibCollisionController::CLibCollisionController(const double& initialTreeDiameter, const double& minimalCellDiameter, const bool rescalingOn) {
 		ErrorLogger::instance();
 		simContainer = SimulationContainer();
-		collisionDetector = CollisionDetection();
 		vtkVis = VTKVisualization();
 		nextClusterID = 0;
 		collisionDetector.setMinimalCellDiameter(minimalCellDiameter);
@@ -64,7 +63,6 @@ namespace clib {
 		}
 
 		simContainer = SimulationContainer(metaSpecs);
-		collisionDetector = CollisionDetection();
 		vtkVis = VTKVisualization();
 		nextClusterID = 0;
 		collisionDetector.setMinimalCellDiameter(minimalCellDiameter);
@@ -358,6 +356,19 @@ namespace clib {
 		return true;
 	}
 
+	CLIB_COLLISION_DETECTION_API bool CLibCollisionController::getClusterTreeStats(const unsigned long& clusterId, TreeStats& stats) {
+		try {
+			if (!collisionDetector.isClusterInTree(clusterId)) throw std::runtime_error("Given cluster has no oct tree, i.e. it was not added to the collision detector.");
+			stats = collisionDetector.getTree(clusterId)->getStats();
+		}
+		catch (std::exception& e) {
+			std::cout << e.what() << std::endl;
+			LOG_ERROR(e.what());
+			return false;
+		}
+		return true;
+	}
+
 	CLIB_COLLISION_DETECTION_API string CLibCollisionController::toString() {
 		return simContainer.toString();
 	}
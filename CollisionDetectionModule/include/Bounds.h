@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 
 namespace collision {
 	namespace octtree {
@@ -31,5 +32,80 @@ namespace collision {
 			Bounds(const double& x, const double& y, const double& z) : x(x), y(y), z(z) {};
 		};
 
+		/**
+		\brief Helper class to pass an object's unique identifier together with its
+		spatial boundaries (aka. Bounding-Box), e.g. when inserting many objects into an OctTree at once.
+		*/
+		template <typename T>
+		class ObjectEntry {
+		public:
+
+			/* Unique identifier of the object. */
+			T id;
+
+			/* Lower and upper bounds of the object's bounding box. */
+			Bounds lower, upper;
+
+			/**
+			\brief Construct an ObjectEntry-object.
+			\param[in] id Unique identifier of the object.
+			\param[in] lower Coordinates of the object's BBox lower bound in real vector space.
+			\param[in] upper Coordinates of the object's BBox upper bound in real vector space.
+			*/
+			ObjectEntry(const T& id, const Bounds& lower, const Bounds& upper) : id(id), lower(lower), upper(upper) {};
+		};
+
+		// Alias for ease of use
+		template <typename T>
+		using ObjectArray = std::vector<ObjectEntry<T>>;
+
+		/**
+		\brief Helper class to define an oriented (i.e. rotated) box as query-region of an OctTree.
+		*/
+		class OrientedBox {
+		public:
+
+			/* Karthesian coordinates of the box's center. */
+			Bounds center;
+
+			/* Half of the box's width, height and length along its own axes. */
+			Bounds halfExtents;
+
+			/* Orthonormal axes of the box, i.e. the columns of its rotation matrix. */
+			Bounds axes[3];
+
+			/**
+			\brief Construct an OrientedBox-object.
+			\param[in] center Coordinates of the box's center in real vector space.
+			\param[in] halfExtents Half of the box's width, height and length along its own axes.
+			\param[in] axisX Normalized direction of the box's x-axis.
+			\param[in] axisY Normalized direction of the box's y-axis, perpendicular to the x-axis.
+			\param[in] axisZ Normalized direction of the box's z-axis, perpendicular to the x- and y-axis.
+			*/
+			OrientedBox(const Bounds& center, const Bounds& halfExtents, const Bounds& axisX, const Bounds& axisY, const Bounds& axisZ) :
+				center(center), halfExtents(halfExtents), axes{ axisX, axisY, axisZ } {};
+		};
+
+		/**
+		\brief Helper class to define a plane bounding a half-space, e.g. one face of a convex polytope used as query-region of an OctTree.
+		Points p with normal * p <= offset lie inside the half-space.
+		*/
+		class Plane {
+		public:
+
+			/* Outward pointing normal of the plane. */
+			Bounds normal;
+
+			/* Signed distance of the plane to the origin along its normal, if the normal is normalized. */
+			double offset;
+
+			/**
+			\brief Construct a Plane-object.
+			\param[in] normal Outward pointing normal of the plane.
+			\param[in] offset Value of normal * p for all points p on the plane.
+			*/
+			Plane(const Bounds& normal, const double& offset) : normal(normal), offset(offset) {};
+		};
+
 	}
 }
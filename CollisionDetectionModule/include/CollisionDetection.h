@@ -1,7 +1,12 @@
 #pragma once
 #include <memory>
+#include <string>
+#include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 namespace simobj {
 	// Forward declaration to remove unnecessary includes.
@@ -16,6 +21,39 @@ namespace collision {
 		template <typename T>
 		class OctTree;
 
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class LinearOctTree;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class SpatialTree;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class MappedOctTree;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class MappedOctTreeQuery;
+
+		// Forward declaration to remove unnecessary includes.
+		class Bounds;
+
+		// Forward declaration to remove unnecessary includes.
+		class ObjectSphere;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class ObjectEntry;
+
+		// Alias for ease of use
+		template <typename T>
+		using ObjectArray = std::vector<ObjectEntry<T>>;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class OctTreeQuery;
 	}
 
 	// Aliases for used namespaces
@@ -23,10 +61,158 @@ namespace collision {
 	using octtree::OctTree;
 	using TreePtr = shared_ptr<OctTree<unsigned int>>;
 	using TreeMap = std::unordered_map<unsigned int, TreePtr>;
+	using octtree::LinearOctTree;
+	using LinearTreePtr = shared_ptr<LinearOctTree<unsigned int>>;
+	using LinearTreeMap = std::unordered_map<unsigned int, LinearTreePtr>;
+	using octtree::SpatialTree;
+	using SpatialTreePtr = shared_ptr<SpatialTree<unsigned int>>;
+	using octtree::MappedOctTree;
+	using MappedTreePtr = shared_ptr<MappedOctTree<unsigned int>>;
+	using MappedTreeMap = std::unordered_map<unsigned int, MappedTreePtr>;
+	using MappedQueryPtr = shared_ptr<octtree::MappedOctTreeQuery<unsigned int>>;
+	using QueryPtr = shared_ptr<octtree::OctTreeQuery<unsigned int>>;
 	using simobj::SimulationObject;
 	using simobj::SimObjPtr;
 	using IDSet = std::unordered_set<unsigned int>;
 
+	/**
+		\brief Objects of this class remember the versions of a cluster and its agents, at the time
+		the cluster's tree was constructed or last synchronized.
+	*/
+	class SyncState {
+	public:
+
+		/* The synchronized cluster, which is not kept alive by its tree. */
+		std::weak_ptr<SimulationObject> cluster;
+
+		/* Version of the cluster, the global bounds of all agents change with the cluster's position and orientation. */
+		unsigned long clusterVersion;
+
+		/* Versions of the cluster's agents by agent id. */
+		std::unordered_map<unsigned int, unsigned long> agentVersions;
+	};
+	using SyncMap = std::unordered_map<unsigned int, SyncState>;
+
+	/**
+		\brief Objects of this class are published snapshots of trees, together with the version of the snapshot.
+	*/
+	class FrozenTree {
+	public:
+
+		/* Read-only snapshot of a cluster's tree. */
+		MappedTreePtr tree;
+
+		/* Version of the snapshot, which is incremented every time a snapshot of the same cluster is published. */
+		unsigned long version;
+	};
+	using FrozenTreeMap = std::unordered_map<unsigned int, FrozenTree>;
+
+	/* Maximal number of readers that may pin the published snapshots of a collision detector at the same time. */
+	static const size_t MAX_FROZEN_READERS = 64;
+
+	/**
+		\brief Objects of this class pin the map of published snapshots for a reader, i.e. the map and its trees
+		are not deleted by the collision detector until the object is destroyed.
+		Pinning takes no lock and changes no reference count, it only announces the reader's epoch in a slot of the collision detector.
+		\note Objects may be moved but not copied, and must not outlive the collision detector they were pinned from.
+	*/
+	class PinnedFrozenTrees {
+	public:
+
+		/**
+			\brief Move-Constructor, the given object is left without a pinned map.
+			\param[in] other Object whose pinned map is taken over.
+		*/
+		PinnedFrozenTrees(PinnedFrozenTrees&& other);
+
+		PinnedFrozenTrees(const PinnedFrozenTrees&) = delete;
+		PinnedFrozenTrees& operator=(const PinnedFrozenTrees&) = delete;
+
+		/**
+			\brief Destructor, releases the reader's slot, after which the map may be deleted.
+		*/
+		~PinnedFrozenTrees();
+
+		/**
+			\brief Access the pinned map.
+			\returns Immutable hash map of read-only trees belonging to agent clusters with the same id.
+		*/
+		inline const FrozenTreeMap* operator->() const { return map; };
+
+		/**
+			\brief Access the pinned map.
+			\returns Immutable hash map of read-only trees belonging to agent clusters with the same id.
+		*/
+		inline const FrozenTreeMap& operator*() const { return *map; };
+
+	private:
+		friend class CollisionDetection;
+
+		/**
+			\brief Constructor, only used by the collision detector after the reader's epoch was announced.
+			\param[in] slot Slot of the collision detector that holds the reader's epoch.
+			\param[in] map Map of published snapshots loaded after the epoch was announced.
+		*/
+		PinnedFrozenTrees(std::atomic<unsigned long>* slot, const FrozenTreeMap* map) : slot(slot), map(map) {};
+
+		/* Slot of the collision detector that holds the reader's epoch, nullptr once moved. */
+		std::atomic<unsigned long>* slot;
+
+		/* The pinned map. */
+		const FrozenTreeMap* map;
+	};
+
+	/**
+		\brief Objects of this class count the collision candidates checked by a collision detector,
+		e.g. to see how many agents are rejected by their bounding spheres without being looked up.
+	*/
+	class CandidateStats {
+	public:
+
+		/* Number of candidates that were not ignored, i.e. either rejected or looked up. */
+		size_t candidateCount;
+
+		/* Number of candidates rejected by their bounding spheres, without looking up their agents. */
+		size_t rejectedCount;
+
+		/* Number of candidates whose agents were looked up in their cluster to calculate their distance. */
+		size_t lookupCount;
+
+		/**
+			\brief Default-Constructor
+		*/
+		CandidateStats() : candidateCount(0), rejectedCount(0), lookupCount(0) {};
+	};
+
+	/**
+		\brief Objects of this class hold the state of a tree that is rebuilt by a background worker.
+		The worker only touches the new tree, everything else is handed over once the worker is done.
+	*/
+	class PendingRebuild {
+	public:
+
+		/* Thread the tree is rebuilt on. */
+		std::thread worker;
+
+		/* Flag if the worker finished, the tree (or error) may only be used once it is set. */
+		std::atomic<bool> done;
+
+		/* The rebuilt tree. */
+		TreePtr tree;
+
+		/* Exception thrown by the worker, nullptr if the rebuild succeeded. */
+		std::exception_ptr error;
+
+		/* Versions of the cluster and its agents at the time their bounds were collected for the rebuild. */
+		SyncState state;
+
+		/**
+			\brief Destructor, waits for the worker.
+		*/
+		~PendingRebuild();
+	};
+	using RebuildMap = std::unordered_map<unsigned int, shared_ptr<PendingRebuild>>;
+
 	/**
 		\brief Objects of this class are used to provide collision checking functionality
 		for Agent-objects used in the simulation. To check for collisions between agents,
@@ -49,6 +235,14 @@ namespace collision {
 		*/
 		CollisionDetection(const double& initialTreeDiameter = 16.0, const double& minimalCellDiameter = 2.0, const bool rescalingOn = false);
 
+		CollisionDetection(const CollisionDetection&) = delete;
+		CollisionDetection& operator=(const CollisionDetection&) = delete;
+
+		/**
+			\brief Destructor, deletes the published and all retired maps of snapshots.
+		*/
+		~CollisionDetection();
+
 		/**
 			\brief Set the initial tree diameter of internally constructed OctTrees, i.e.
 			the initial symmetric allowed width/heigth/length of new tree's roots.
@@ -74,6 +268,45 @@ namespace collision {
 		*/
 		void setAllowRescaling(const bool rescalingOn);
 
+		/**
+			\brief Set the flag for building new trees as pointer-free linear OctTrees, i.e. trees
+			whose nodes are identified by Morton keys instead of smart pointers.
+			\param[in] linearTreesOn If true, clusters are inserted into LinearOctTree-objects instead of OctTree-objects.
+			\note This only affects trees constructed after this call.
+		*/
+		void setUseLinearTrees(const bool linearTreesOn);
+
+		/**
+			\brief Set the looseness of internally constructed OctTrees, i.e. the factor by which node bounds are enlarged.
+			\param[in] looseness 1.0 for regular OctTrees, values greater than 1.0 (usually 2.0) for loose OctTrees,
+			which store each agent exactly once instead of in every leaf its bounding box overlaps.
+			\note This only affects trees constructed after this call and is ignored by linear OctTrees.
+		*/
+		void setTreeLooseness(const double& looseness);
+
+		/**
+			\brief Set the leaf capacity of internally constructed OctTrees, i.e. leaves are split by occupancy instead of
+			always being subdivided down to the minimal leaf diameter.
+			\param[in] leafCapacity A leaf is split once it would contain more than this number of agents, 0 disables splitting by occupancy.
+			\param[in] mergeThreshold Sibling leaves are merged once they contain less than this number of agents.
+			\note This only affects trees constructed after this call and is ignored by linear OctTrees.
+		*/
+		void setLeafCapacity(const unsigned int& leafCapacity, const unsigned int& mergeThreshold);
+
+		/**
+			\brief Set the maximal depth of internally constructed OctTrees.
+			\param[in] maxTreeDepth Nodes at this depth are never split, where root has a depth of zero.
+			\note This only affects trees constructed after this call and is ignored by linear OctTrees.
+		*/
+		void setMaximalTreeDepth(const unsigned int& maxTreeDepth);
+
+		/**
+			\brief Set the number of threads used to construct OctTrees from clusters.
+			\param[in] treeBuildThreads Number of threads, 1 constructs trees on the calling thread and 0 uses all hardware threads.
+			\note Trees are identical regardless of the number of threads. This is ignored by linear OctTrees.
+		*/
+		void setTreeBuildThreads(const unsigned int& treeBuildThreads);
+
 		/**
 			\brief Check if a cluster with the given ID is registered in this collision detector,
 			i.e. has an OctTree constructed from it.
@@ -86,6 +319,8 @@ namespace collision {
 			\brief Construct an OctTree from the given cluster, where its agents are inserted into
 			the new tree's nodes as unqiue ids.
 			\param[in] cluster Smart pointer to the inserted cluster object.
+			\note The root starts from the initial tree diameter and is grown to fit all agents at once before any agent is inserted,
+			i.e. trees of all clusters share the same lattice of leaves around the origin, unlike OctTree::createFromObjects.
 		*/
 		void makeTreeFromCluster(SimObjPtr cluster);
 
@@ -96,11 +331,139 @@ namespace collision {
 		void addAgentToTree(SimObjPtr agent);
 
 		/**
-			\brief Get the OctTree with the given unique cluster id.
+			\brief Remove a single agent from a previously constructed OctTree.
+			\param[in] agent Smart pointer to the removed agent object.
+			\returns True if the agent was part of its cluster's tree.
+		*/
+		const bool removeAgentFromTree(SimObjPtr agent);
+
+		/**
+			\brief Update the position of a single agent in a previously constructed OctTree, e.g. after the agent moved.
+			Only the tree nodes the agent occupied before and after the update are touched.
+			\param[in] agent Smart pointer to the moved agent object.
+		*/
+		void updateAgentInTree(SimObjPtr agent);
+
+		/**
+			\brief Synchronize a previously constructed OctTree with its cluster, i.e. only agents that were moved or rotated
+			since the tree was constructed or last synchronized are updated, and only if their bounding box changed.
+			Agents added to or removed from the cluster in the meantime are inserted into or removed from the tree.
+			\param[in] clusterId Unique identifier of the synchronized agent cluster.
+			\returns Number of agents that were inserted, updated or removed.
+			\note Moving or rotating the cluster itself checks all of its agents.
+		*/
+		const size_t sync(const unsigned int& clusterId);
+
+		/**
+			\brief Get the tree with the given unique cluster id, regardless of whether it is an OctTree or a linear OctTree.
+			\param[in] id Unique cluster id, shared by trees constructed from a cluster.
+			\returns Smart pointer to the tree's common interface.
+			\note Throws if the cluster has no tree.
+		*/
+		SpatialTreePtr getTree(const unsigned int& id);
+
+		/**
+			\brief Get the OctTree with the given unique cluster id, e.g. for queries only pointer-based trees offer.
 			\param[in] id Unique cluster id, shared by trees constructed from a cluster.
 			\returns Smart pointer to an OctTree-object.
+			\note Throws if the cluster has no OctTree, e.g. because it has a linear OctTree.
+		*/
+		TreePtr getOctTree(const unsigned int& id);
+
+		/**
+			\brief Get the linear OctTree with the given unique cluster id.
+			\param[in] id Unique cluster id, shared by trees constructed from a cluster.
+			\returns Smart pointer to a LinearOctTree-object.
+		*/
+		LinearTreePtr getLinearTree(const unsigned int& id);
+
+		/**
+			\brief Get the read-only OctTree with the given unique cluster id, which was loaded from a file.
+			\param[in] id Unique cluster id, shared by trees constructed from a cluster.
+			\returns Smart pointer to a MappedOctTree-object.
 		*/
-		TreePtr getTree(const unsigned int& id);
+		MappedTreePtr getMappedTree(const unsigned int& id);
+
+		/**
+			\brief Write snapshots of all OctTrees of this collision detector into a single file, together with their cluster ids.
+			\param[in] path Path of the written file, an existing file is overwritten.
+			\note Linear OctTrees are not written. Throws if the file cannot be written.
+		*/
+		void saveTrees(const std::string& path) const;
+
+		/**
+			\brief Memory map a file written by saveTrees and use its trees as read-only OctTrees, i.e. the trees are not deserialized
+			and all processes that load the same file share one physical copy.
+			Collision checks for clusters without an OctTree of their own are answered by the loaded trees.
+			\param[in] path Path of a file written by saveTrees.
+			\note Previously loaded trees are replaced. Agents cannot be added to, removed from or updated in loaded trees,
+			their clusters have to be added to this collision detector again to construct modifiable trees.
+			Throws if the file is not a valid tree file.
+		*/
+		void loadTrees(const std::string& path);
+
+		/**
+			\brief Freeze the OctTree of a cluster into an immutable snapshot and publish it for concurrent queries.
+			Once published, the snapshot of the cluster is re-frozen and published again whenever its tree is rebuilt or synchronized.
+			\param[in] clusterId Unique id of the agent cluster.
+			\returns The published read-only tree.
+			\note Throws if the cluster has no OctTree, linear OctTrees are not supported.
+		*/
+		MappedTreePtr freezeTree(const unsigned int& clusterId);
+
+		/**
+			\brief Get the last published snapshot of a cluster's OctTree.
+			Any number of threads may call this method and query the returned tree, while trees are modified and published.
+			\note Every call pins the published map and copies the smart pointer of the tree, i.e. batches of queries
+			should pin the map once through getFrozenTrees and use the trees of the pinned map.
+			\param[in] clusterId Unique id of the agent cluster.
+			\returns Read-only tree, nullptr if no snapshot of the cluster was published.
+		*/
+		MappedTreePtr getFrozenTree(const unsigned int& clusterId) const;
+
+		/**
+			\brief Get the last published snapshot of a cluster's OctTree together with its version.
+			\param[in] clusterId Unique id of the agent cluster.
+			\param[out] version Version of the returned snapshot, 0 if no snapshot of the cluster was published.
+			\returns Read-only tree, nullptr if no snapshot of the cluster was published.
+		*/
+		MappedTreePtr getFrozenTree(const unsigned int& clusterId, unsigned long& version) const;
+
+		/**
+			\brief Get the version of the last published snapshot of a cluster's OctTree,
+			i.e. callers holding a snapshot with a smaller version may tell how stale their answers are.
+			\param[in] clusterId Unique id of the agent cluster.
+			\returns Version of the last published snapshot, 0 if no snapshot of the cluster was published.
+		*/
+		const unsigned long getTreeVersion(const unsigned int& clusterId) const;
+
+		/**
+			\brief Rebuild the OctTree of a cluster on a background worker from the current bounds of its agents.
+			Until the rebuild is completed, queries keep using the previous tree, and a snapshot of the previous tree is published
+			if there is none. A snapshot of the new tree is published by completeRebuilds, once the new tree caught up with the agents.
+			\param[in] clusterId Unique id of the agent cluster.
+			\note The new tree replaces the previous one in completeRebuilds, i.e. on the thread that owns this object.
+			Throws if the cluster has no OctTree, if it is already being rebuilt or if linear OctTrees are used.
+		*/
+		void rebuildTreeAsync(const unsigned int& clusterId);
+
+		/**
+			\brief Replace the trees of all clusters whose background rebuild finished with their rebuilt trees,
+			which are then synchronized with the agents that changed during the rebuild.
+			\param[in] wait Flag if unfinished rebuilds are waited for, otherwise they are left running.
+			\returns Number of replaced trees.
+			\note Throws if a rebuild failed, the previous tree of the cluster is kept in that case.
+		*/
+		const size_t completeRebuilds(const bool wait = false);
+
+		/**
+			\brief Get the last published snapshots of all clusters at once, i.e. a consistent set of trees for a batch of queries.
+			\returns Pinned immutable hash map of read-only trees belonging to agent clusters with the same id.
+			\note Readers should pin the map once per batch of queries and look up their clusters in the pinned map,
+			instead of calling getFrozenTree for every query. The pinned map and its trees stay valid until the reader drops it.
+			At most MAX_FROZEN_READERS maps may be pinned at once, further readers wait until a pinned map is dropped.
+		*/
+		PinnedFrozenTrees getFrozenTrees() const;
 
 		/**
 			\brief Check for a collision between agents of a cluster and a candidate agent.
@@ -115,6 +478,96 @@ namespace collision {
 		*/
 		const bool checkForCollision(SimObjPtr cluster, const IDSet& ignoreIDs, SimObjPtr candidate, SimObjPtr& nearest, double& nearestDistance);
 
+		/**
+			\brief Check for a collision between the agents of two clusters.
+			The OctTrees of both clusters are traversed simultaneously to find pairs of agents whose bounding boxes are within the margin,
+			only these pairs are checked individually for collisions.
+			This method may also return the closest pair of agents and their distance, even if no collision occurs.
+			\param[in] clusterA Smart pointer to the first Agent-Cluster object to be checked.
+			\param[in] clusterB Smart pointer to the second Agent-Cluster object to be checked.
+			\param[out] nearestA Agent of the first cluster of the colliding or closest pair, nullptr if no bounding boxes are within the margin.
+			\param[out] nearestB Agent of the second cluster of the colliding or closest pair, nullptr if no bounding boxes are within the margin.
+			\param[out] nearestDistance Distance between the agents of the colliding or closest pair.
+			\param[in] margin Maximal distance of the bounding boxes of checked agents, 0 only checks agents with touching or overlapping bounding boxes.
+			\returns True if collision occured.
+			\note Both clusters need an OctTree constructed from them, linear OctTrees are not supported.
+		*/
+		const bool checkClusterCollision(SimObjPtr clusterA, SimObjPtr clusterB, SimObjPtr& nearestA, SimObjPtr& nearestB, double& nearestDistance, const double& margin = 0.0);
+
+		/**
+			\brief Cast a ray against the agents of a cluster and find the first agent hit, e.g. to check if a site is accessible.
+			The cluster's OctTree is traversed front to back, agents are tested with their exact shape (sphere, cylinder or ellipsoid)
+			in their global pose, in the order the ray enters their bounding boxes, until no closer hit is possible.
+			\param[in] cluster Smart pointer to an Agent-Cluster object to be checked.
+			\param[in] ignoreIDs Agent ids that should be ignored, e.g. the agent the ray starts from.
+			\param[in] origin Coordinates of the ray's origin in real vector space.
+			\param[in] direction Direction of the ray, does not need to be normalized.
+			\param[in] maxDistance Maximal distance along the ray at which agents are hit.
+			\param[out] hit Agent hit first by the ray, nullptr if no agent is hit.
+			\param[out] hitDistance Distance along the ray to the first hit, 0 if the origin lies inside an agent.
+			\returns True if an agent was hit.
+			\note The cluster needs an OctTree constructed from it, linear OctTrees are not supported.
+			Throws if the direction has zero length.
+		*/
+		const bool raycast(SimObjPtr cluster, const IDSet& ignoreIDs, const octtree::Bounds& origin, const octtree::Bounds& direction, const double& maxDistance,
+			SimObjPtr& hit, double& hitDistance);
+
+		/**
+			\brief Cast a ray against the agents of a cluster and find the first agent hit, using the scratch memory of the given query context.
+			\param[in] cluster Smart pointer to an Agent-Cluster object to be checked.
+			\param[in] ignoreIDs Agent ids that should be ignored, e.g. the agent the ray starts from.
+			\param[in] origin Coordinates of the ray's origin in real vector space.
+			\param[in] direction Direction of the ray, does not need to be normalized.
+			\param[in] maxDistance Maximal distance along the ray at which agents are hit.
+			\param[in] query Query context, e.g. one per thread, that is reused across rays.
+			\param[out] hit Agent hit first by the ray, nullptr if no agent is hit.
+			\param[out] hitDistance Distance along the ray to the first hit, 0 if the origin lies inside an agent.
+			\returns True if an agent was hit.
+			\note The cluster needs an OctTree constructed from it, linear OctTrees are not supported.
+			Rays with distinct contexts may be cast concurrently. Throws if the direction has zero length.
+		*/
+		const bool raycast(SimObjPtr cluster, const IDSet& ignoreIDs, const octtree::Bounds& origin, const octtree::Bounds& direction, const double& maxDistance,
+			octtree::OctTreeQuery<unsigned int>& query, SimObjPtr& hit, double& hitDistance) const;
+
+		/**
+			\brief Cast many rays against the agents of a cluster, e.g. from all sites of an agent, and find the first agent hit by each ray.
+			\param[in] cluster Smart pointer to an Agent-Cluster object to be checked.
+			\param[in] ignoreIDs Agent ids that should be ignored by all rays.
+			\param[in] origins Coordinates of the rays' origins in real vector space.
+			\param[in] directions Directions of the rays, with the same size as the origins.
+			\param[in] maxDistance Maximal distance along the rays at which agents are hit.
+			\param[out] hits Agents hit first by each ray, nullptr for rays that hit no agent.
+			\param[out] hitDistances Distances along each ray to the first hit, POS_INF for rays that hit no agent.
+			\returns Number of rays that hit an agent.
+			\note The cluster needs an OctTree constructed from it, linear OctTrees are not supported.
+		*/
+		const size_t raycast(SimObjPtr cluster, const IDSet& ignoreIDs, const std::vector<octtree::Bounds>& origins, const std::vector<octtree::Bounds>& directions,
+			const double& maxDistance, std::vector<SimObjPtr>& hits, std::vector<double>& hitDistances);
+
+		/**
+			\brief Get the agents of a cluster whose bounding boxes overlap the oriented bounding box of a candidate agent in its global pose,
+			e.g. to check a proposed placement of an elongated, rotated agent against only the agents that matter.
+			\param[in] cluster Smart pointer to an Agent-Cluster object to be queried.
+			\param[in] candidate Agent whose oriented bounding box is used as query-region.
+			\param[out] ids Buffer the ids of the overlapping agents are appended to, in ascending order.
+			\param[in] margin Distance by which the candidate's bounding box is enlarged on each side.
+			\returns Number of ids appended to the buffer.
+			\note The cluster needs an OctTree constructed from it, linear OctTrees are not supported.
+			This query is independent of checkForCollision, which keeps checking the agents of the nodes nearest to the candidate's position.
+		*/
+		const size_t getOverlapCandidates(SimObjPtr cluster, SimObjPtr candidate, std::vector<unsigned int>& ids, const double& margin = 0.0);
+
+		/**
+			\brief Get the number of collision candidates checked by checkForCollision since the last reset.
+			\returns Counts of checked, rejected and looked up candidates.
+		*/
+		const CandidateStats& getCandidateStats() const;
+
+		/**
+			\brief Reset the counts of checked collision candidates to zero.
+		*/
+		void resetCandidateStats();
+
 		/**
 			\brief Calculate the closest inter-hull distance of two agents with a particular shape.
 			\note At the moment only spheres and cylinders are supported, more to come.. (ToDo!)
@@ -127,6 +580,39 @@ namespace collision {
 
 		/* Hash map of stored OctTrees belonging to agent clusters with the same id.*/
 		TreeMap trees;
+
+		/* Hash map of stored linear OctTrees belonging to agent clusters with the same id.*/
+		LinearTreeMap linearTrees;
+
+		/* Hash map of read-only OctTrees loaded from a file, belonging to agent clusters with the same id.*/
+		MappedTreeMap mappedTrees;
+
+		/* Query context of collision checks answered by loaded trees, reused by all checks of this collision detector. */
+		MappedQueryPtr mappedQuery;
+
+		/* Query context of ray casts, reused by all rays of this collision detector. */
+		QueryPtr rayQuery;
+
+		/* Collision candidates of loose loaded trees, reused by all checks of this collision detector. */
+		std::vector<unsigned int> mappedCandidates;
+
+		/* Counts of the collision candidates checked since the last reset. */
+		CandidateStats candidateStats;
+
+		/* Hash map of the versions of agent clusters and their agents, at the time their trees were last synchronized. */
+		SyncMap syncStates;
+
+		/* Published snapshots of trees, the map is never modified but replaced as a whole and retired by publishFrozenTree. */
+		std::atomic<const FrozenTreeMap*> frozenTrees;
+
+		/* Epoch of the published map, incremented whenever a map is replaced. */
+		std::atomic<unsigned long> frozenEpoch;
+
+		/* Epochs announced by readers that pinned the published map, 0 for free slots. */
+		mutable std::atomic<unsigned long> readerEpochs[MAX_FROZEN_READERS];
+
+		/* Replaced maps and the epochs they were retired at, deleted once no reader announced an earlier epoch. */
+		std::vector<std::pair<unsigned long, const FrozenTreeMap*>> retiredTrees;
 		
 		/* Initial symmetric allowed width/heigth/length of new tree roots. */
 		double initialTreeDiameter;
@@ -138,6 +624,110 @@ namespace collision {
 		for new objects outside of their inital root sub-space. */
 		bool allowRescaling;
 
+		/* Flag if new trees are constructed as linear OctTrees. */
+		bool useLinearTrees;
+
+		/* Factor by which node bounds of new trees are enlarged, 1.0 for regular OctTrees. */
+		double treeLooseness;
+
+		/* Number of agents a leaf of new trees may contain before it is split, 0 if leaves are split down to the minimal diameter. */
+		unsigned int leafCapacity;
+
+		/* Sibling leaves of new trees are merged once they contain less than this number of agents. */
+		unsigned int mergeThreshold;
+
+		/* Maximal depth of new trees. */
+		unsigned int maxTreeDepth;
+
+		/* Number of threads used to construct new trees. */
+		unsigned int treeBuildThreads;
+
+		/* Background rebuilds by cluster id, declared last so that workers are waited for before any other member is destroyed. */
+		RebuildMap pendingRebuilds;
+
+		/**
+			\brief Calculate the bounding box an agent occupies in its cluster's tree.
+			The box contains the agent in its global pose, i.e. rotated cylinders and ellipsoids are covered as well.
+			\param[in] agent Smart pointer to an agent object.
+			\param[out] lowerBound Coordinates of the agent's BBox lower bound in real vector space.
+			\param[out] upperBound Coordinates of the agent's BBox upper bound in real vector space.
+		*/
+		void calcAgentBounds(SimObjPtr agent, octtree::Bounds& lowerBound, octtree::Bounds& upperBound) const;
+
+		/**
+			\brief Collect the ids and bounding boxes of all agents of a cluster, e.g. to bulk-load a tree.
+			\param[in] cluster Smart pointer to an agent cluster object.
+			\returns Ids and bounding boxes of the cluster's agents.
+		*/
+		const octtree::ObjectArray<unsigned int> calcAgentObjects(SimObjPtr cluster) const;
+
+		/**
+			\brief Remember the current versions of a cluster and its agents, e.g. after its tree was constructed.
+			\param[in] cluster Smart pointer to an agent cluster object.
+		*/
+		void storeSyncState(SimObjPtr cluster);
+
+		/**
+			\brief Publish a snapshot of a cluster's tree, by atomically replacing the map of published snapshots with an updated copy.
+			The replaced map is retired and deleted once no reader may still use it.
+			\param[in] clusterId Unique id of the agent cluster.
+			\param[in] tree Snapshot of the cluster's tree.
+			\returns Version of the published snapshot.
+			\note Only called on the thread that owns this object, i.e. there is a single publisher.
+		*/
+		const unsigned long publishFrozenTree(const unsigned int& clusterId, MappedTreePtr tree);
+
+		/**
+			\brief Delete the retired maps of snapshots that no reader may still use,
+			i.e. all maps retired at or before the oldest epoch announced by a reader.
+		*/
+		void reclaimFrozenTrees();
+
+		/**
+			\brief Check the given collision candidates of a cluster for a collision with the query agent.
+			\param[in] cluster Smart pointer to the Agent-Cluster object the candidates belong to.
+			\param[in] ignoreIDs Agent ids that should be ignored during collsion checking.
+			\param[in] candidate Agent that should be checked for collision with the collision candidates.
+			\param[in] candidates Ids of the collision candidates, e.g. the ids of the nearest tree node.
+			\param[out] nearest Agent of the candidates that is nearest to the given query agent.
+			\param[out] nearestDistance Distance to the agent nearest to the given query agent.
+			\param[in] spheres Optional bounding spheres of the candidates in the order of their ids, candidates whose sphere
+			is farther away than the nearest agent found so far are rejected without looking up the agent.
+			\returns True if collision occured.
+		*/
+		template <typename IdContainer>
+		const bool checkCandidates(SimObjPtr cluster, const IDSet& ignoreIDs, SimObjPtr candidate, const IdContainer& candidates, SimObjPtr& nearest, double& nearestDistance,
+			const octtree::ObjectSphere* spheres = nullptr);
+
+		// Narrow-phase of ray casts, which hits the agents of a cluster in their global pose.
+		class AgentRayVisitor;
+
+		/**
+			\brief Cast a single ray against the agents of a cluster, reusing the given query context.
+			Agents are hit-tested in the order the ray enters their bounding boxes, until no agent may be hit closer.
+			\param[in] cluster Smart pointer to an Agent-Cluster object to be checked.
+			\param[in] tree OctTree constructed from the cluster.
+			\param[in] ignoreIDs Agent ids that should be ignored.
+			\param[in] origin Coordinates of the ray's origin in real vector space.
+			\param[in] direction Direction of the ray.
+			\param[in] maxDistance Maximal distance along the ray at which agents are hit.
+			\param[in] query Query context of the tree traversal, e.g. shared by all rays of a batch.
+			\param[out] hit Agent hit first by the ray, nullptr if no agent is hit.
+			\param[out] hitDistance Distance along the ray to the first hit, POS_INF if no agent is hit.
+			\returns True if an agent was hit.
+		*/
+		const bool castRay(SimObjPtr cluster, const OctTree<unsigned int>& tree, const IDSet& ignoreIDs, const octtree::Bounds& origin, const octtree::Bounds& direction,
+			const double& maxDistance, octtree::OctTreeQuery<unsigned int>& query, SimObjPtr& hit, double& hitDistance) const;
+
+		/**
+			\brief Calculate the distance at which a ray hits the hull of an agent with a particular shape in its global pose.
+			\param[in] origin Coordinates of the ray's origin in real vector space.
+			\param[in] direction Normalized direction of the ray.
+			\param[in] body Agent to be hit.
+			\returns Distance along the ray to the hit, 0 if the origin lies inside the agent and POS_INF if the agent is missed.
+		*/
+		const double calcRayToBodyDistance(const octtree::Bounds& origin, const octtree::Bounds& direction, SimObjPtr body) const;
+
 		/**
 			\brief Calculate the closest inter-hull distance of two spheres.
 			\param[in] sphere1 First sphere to be used for distance calculation.
@@ -162,4 +752,4 @@ namespace collision {
 		*/
 		const double calcCylinderToCylinderDistance(SimObjPtr cylinder1, SimObjPtr cylinder2) const;
 	};
-}
\ No newline at end of file
+}
\ No newline at end of file
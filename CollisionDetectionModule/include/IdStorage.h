@@ -0,0 +1,276 @@
+#pragma once
+#include <cstddef>
+#include <cmath>
+#include <unordered_set>
+#include "..\include\Bounds.h"
+
+namespace collision {
+	namespace octtree {
+
+		/* Number of ids a node stores inline, i.e. without any heap allocation. */
+		static const size_t INLINE_ID_COUNT = 4;
+
+		/**
+		\brief Helper class to store the bounding sphere of an object next to its id in a node.
+		Nodes keep one sphere per id, so that objects can be rejected by their distance without being looked up.
+		The radius is half the diagonal of the object's bounding-box, i.e. the sphere encloses the box and thus the object.
+		*/
+		class ObjectSphere {
+		public:
+
+			/* Karthesian coordinates of the center. */
+			double x, y, z;
+
+			/* Radius of the sphere. */
+			double radius;
+
+			/**
+			\brief Default-Constructor
+			*/
+			ObjectSphere() {};
+
+			/**
+			\brief Construct the bounding sphere of an object from its bounding-box.
+			\param[in] lowerBound Lower bounds of the object's bounding-box.
+			\param[in] upperBound Upper bounds of the object's bounding-box.
+			*/
+			ObjectSphere(const Bounds& lowerBound, const Bounds& upperBound) : x((lowerBound.x + upperBound.x) / 2.0), y((lowerBound.y + upperBound.y) / 2.0), z((lowerBound.z + upperBound.z) / 2.0),
+				radius(calcRadius(upperBound.x - lowerBound.x, upperBound.y - lowerBound.y, upperBound.z - lowerBound.z)) {};
+
+			/**
+			\brief Calculate the radius of the smallest sphere around a box, i.e. half of the box's diagonal.
+			\param[in] width Width of the box.
+			\param[in] height Height of the box.
+			\param[in] length Length of the box.
+			\returns Radius of the sphere enclosing the box.
+			*/
+			static const double calcRadius(const double& width, const double& height, const double& length) {
+				return std::sqrt(width * width + height * height + length * length) / 2.0;
+			};
+
+			/**
+			\brief Calculate a lower bound of the distance between this sphere and another sphere.
+			\param[in] x X-Coordinate of the other sphere's center
+			\param[in] y Y-Coordinate of the other sphere's center
+			\param[in] z Z-Coordinate of the other sphere's center
+			\param[in] radius Radius of the other sphere
+			\returns Distance between the centers minus both radii, negative if the spheres overlap.
+			*/
+			const double calcMinDistance(const double& x, const double& y, const double& z, const double& radius) const {
+				double dx = this->x - x;
+				double dy = this->y - y;
+				double dz = this->z - z;
+				return std::sqrt(dx * dx + dy * dy + dz * dz) - this->radius - radius;
+			};
+		};
+
+		/**
+			\brief Objects of this class are read-only views on the sorted ids of a node, which are iterated by a linear scan.
+			A span is only valid as long as the ids of the node it was taken from are not modified.
+		*/
+		template <typename T>
+		class IdSpan {
+		public:
+
+			/**
+				\brief Constructor
+				\param[in] first Pointer to the first id.
+				\param[in] last Pointer behind the last id.
+			*/
+			IdSpan(const T* first = nullptr, const T* last = nullptr) : first(first), last(last) {};
+
+			/**
+				\brief Get an iterator to the first id.
+				\returns Pointer to the first id.
+			*/
+			const T* begin() const;
+
+			/**
+				\brief Get an iterator behind the last id.
+				\returns Pointer behind the last id.
+			*/
+			const T* end() const;
+
+			/**
+				\brief Get the number of ids in this span.
+				\returns Number of ids.
+			*/
+			const size_t size() const;
+
+			/**
+				\brief Check if this span does not contain any ids.
+				\returns True if this span is empty.
+			*/
+			const bool empty() const;
+
+			/**
+				\brief Find an id in this span by a binary search.
+				\param[in] id unique identifier of an entity
+				\returns Pointer to the id or end() if the id is not part of this span.
+			*/
+			const T* find(const T& id) const;
+
+			/**
+				\brief Compare the ids of two spans.
+				\param[in] other Span that is compared with this span.
+				\returns True if both spans contain the same ids.
+			*/
+			const bool operator==(const IdSpan<T>& other) const;
+
+			/**
+				\brief Compare the ids of two spans.
+				\param[in] other Span that is compared with this span.
+				\returns True if the spans contain different ids.
+			*/
+			const bool operator!=(const IdSpan<T>& other) const;
+
+			/**
+				\brief Copy the ids of this span into a set.
+				\returns Set of all ids of this span.
+			*/
+			operator std::unordered_set<T>() const;
+
+		private:
+
+			/* Pointer to the first id. */
+			const T* first;
+
+			/* Pointer behind the last id. */
+			const T* last;
+		};
+
+		/**
+			\brief Objects of this class store the ids of a node as a sorted array, together with an array of their bounding spheres in the same order.
+			Up to INLINE_ID_COUNT ids are stored inline, larger arrays spill to a buffer on the heap that grows geometrically.
+			The spheres are always stored on the heap, in a buffer with the same capacity that is allocated with the first id,
+			i.e. they do not enlarge the nodes. Removing ids never shrinks the buffers, i.e. a node that was recycled
+			by its arena reuses the buffers of its previous life.
+		*/
+		template <typename T>
+		class IdStorage {
+		public:
+
+			/**
+				\brief Default-Constructor, constructs an empty storage without heap allocation.
+			*/
+			IdStorage();
+
+			/**
+				\brief Copy-Constructor
+				\param[in] other Storage whose ids are copied.
+			*/
+			IdStorage(const IdStorage<T>& other);
+
+			/**
+				\brief Move-Constructor, takes over the heap buffer of the other storage.
+				\param[in] other Storage whose ids are moved, it is empty afterwards.
+			*/
+			IdStorage(IdStorage<T>&& other);
+
+			/**
+				\brief Copy-Assignment
+				\param[in] other Storage whose ids are copied.
+				\returns This storage.
+			*/
+			IdStorage<T>& operator=(const IdStorage<T>& other);
+
+			/**
+				\brief Move-Assignment, takes over the heap buffer of the other storage.
+				\param[in] other Storage whose ids are moved, it is empty afterwards.
+				\returns This storage.
+			*/
+			IdStorage<T>& operator=(IdStorage<T>&& other);
+
+			/**
+				\brief Destructor, releases the heap buffer.
+			*/
+			~IdStorage();
+
+			/**
+				\brief Insert an id at its sorted position together with its bounding sphere.
+				If the id is already stored, only its bounding sphere is replaced.
+				\param[in] id unique identifier of an entity
+				\param[in] sphere Bounding sphere of the entity.
+				\returns True if the id was inserted, false if it was already stored.
+			*/
+			const bool insert(const T& id, const ObjectSphere& sphere);
+
+			/**
+				\brief Remove an id and its bounding sphere.
+				\param[in] id unique identifier of an entity
+				\returns True if the id was found and removed.
+			*/
+			const bool erase(const T& id);
+
+			/**
+				\brief Remove all ids and spheres, but keep the heap buffers.
+			*/
+			void clear();
+
+			/**
+				\brief Get the number of stored ids.
+				\returns Number of ids.
+			*/
+			const size_t size() const;
+
+			/**
+				\brief Get a view on the stored ids.
+				\returns Span of the sorted ids.
+			*/
+			const IdSpan<T> getSpan() const;
+
+			/**
+				\brief Get the bounding spheres of the stored ids.
+				\returns Pointer to the first sphere, the spheres are aligned with getSpan(). nullptr if no id was ever stored.
+			*/
+			const ObjectSphere* getSpheres() const;
+
+			/**
+				\brief Get the size of the heap buffers, e.g. to calculate the memory used by an OctTree.
+				\returns Bytes allocated on the heap, 0 if no id was ever stored.
+			*/
+			const size_t getHeapBytes() const;
+
+		private:
+
+			/* Number of stored ids. */
+			unsigned int count;
+
+			/* Number of ids and spheres that fit into the current buffers, INLINE_ID_COUNT while the ids are stored inline. */
+			unsigned int capacity;
+
+			/* Ids stored inline or pointer to the heap buffer, depending on the capacity. */
+			union {
+				T inlineIds[INLINE_ID_COUNT];
+				T* heapIds;
+			};
+
+			/* Heap buffer of the bounding spheres, nullptr until the first id is stored. */
+			ObjectSphere* spheres;
+
+			/**
+				\brief Get the buffer that holds the ids.
+				\returns Pointer to the first id.
+			*/
+			T* data();
+
+			/**
+				\brief Get the buffer that holds the ids.
+				\returns Pointer to the first id.
+			*/
+			const T* data() const;
+
+			/**
+				\brief Move the stored ids and spheres into buffers of the given capacity, the id buffer spills to the heap
+				once the capacity exceeds INLINE_ID_COUNT.
+				\param[in] grownCapacity Capacity of the new buffers, at least the current capacity.
+			*/
+			void grow(const unsigned int& grownCapacity);
+
+			/**
+				\brief Release the heap buffers and return to inline storage, the stored ids are lost.
+			*/
+			void release();
+		};
+	}
+}
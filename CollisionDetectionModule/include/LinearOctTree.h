@@ -0,0 +1,362 @@
+#pragma once
+#undef max
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include "..\include\Bounds.h"
+#include "..\include\SpatialTree.h"
+
+namespace collision {
+	namespace octtree {
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class LinearOctTree;
+
+		// Aliases for used namespaces
+		using std::shared_ptr;
+		using std::unordered_map;
+
+		/* Morton (Z-order) key of a node in a linear OctTree, prefixed with a sentinel bit that encodes the node's depth. */
+		using MortonKey = std::uint64_t;
+
+		template <typename T>
+		using LinearTreePtr = shared_ptr<LinearOctTree<T>>;
+		template <typename T>
+		using IdSet = std::unordered_set<T>;
+		template <typename T>
+		using IdArray = std::vector<T>;
+
+		/* Maximum depth of a linear OctTree, i.e. 21 levels with 3 bits each plus the sentinel bit fit into 64 bits. */
+		static const unsigned int MAX_LINEAR_DEPTH = 21;
+
+		/* Morton key of the root node of any linear OctTree. */
+		static const MortonKey ROOT_KEY = 1;
+
+		/**
+			\brief Objects of this class contain a pointer-free (aka. linear) OctTree, that divides real vector space (R^3)
+			into equally spaced sub-spaces just like OctTree does, but identifies its nodes by 64-bit Morton (Z-order) keys.
+			Nodes are stored in a flat hash table, hence there are no parent- or child-pointers and
+			traversing the tree is pure integer arithmetic on keys, i.e. child = (parent << 3) | octant and parent = child >> 3.
+			Spatial bounds of a node are not stored but derived from its key and the root's bounds on the fly.
+			The tree offers the same insertion and nearest neighbor search interface as OctTree, i.e. both may be used interchangeably as SpatialTree.
+			\note Only leaf-nodes may contain objects, all leaves lie at the same depth, which is given by the minimal leaf diameter.
+			One object may occupy more than one leaf-node if its boundaries overlap with other leafs.
+		*/
+		template <typename T>
+		class LinearOctTree : public SpatialTree<T> {
+		public:
+
+			/**
+				\brief Call to instantiate a new LinearOctTree-object.
+				\param[in] lower Initial lower spatial bounds of this tree's root.
+				\param[in] upper Initial upper spatial bounds of this tree's root.
+				\param[in] minDiameter Minimal allowed symmetric width/heigth/length of a leaf-node (i.e. resolution).
+				\returns Returns a smart pointer to the new object on the heap.
+				\note This is the only way to "make" a LinearOctTree-object, i.e. Constructor is private!
+			*/
+			static LinearTreePtr<T> create(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter);
+
+			/**
+				\brief Call to instantiate a new LinearOctTree-object.
+				\param[in] diameter Initial symmetric spatial bounds of this tree's root.
+				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\returns Returns a smart pointer to the new object on the heap.
+				\note This is the only way to "make" a LinearOctTree-object, i.e. Constructor is private!
+			*/
+			static LinearTreePtr<T> create(const Bounds& diameter, const Bounds& minDiameter);
+
+			/**
+				\brief Call to instantiate a new LinearOctTree-object.
+				\param[in] treeDiameter Initial symmetric allowed width/heigth/length of this tree's root.
+				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\returns Returns a smart pointer to the new object on the heap.
+				\note This is the only way to "make" a LinearOctTree-object, i.e. Constructor is private!
+			*/
+			static LinearTreePtr<T> create(const double& treeDiameter, const double& minCellDiameter);
+
+			/**
+				\brief Set the resize allowed flag for this tree.
+				\param[in] resizeOn If true, this tree is allowed to expand itself to accomodate
+				for new objects outside of the inital root sub-space.
+			*/
+			virtual void setAllowResize(const bool resizeOn);
+
+			/**
+				\brief Insert a new object with its unique identifier and bounding box into this tree.
+				\param[in] id unique identifier of the inserted object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\note Inserting an id that is already part of this tree moves the object to the new bounding box.
+			*/
+			virtual void insertObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Insert many objects with their unique identifiers and bounding boxes into this tree at once (bulk-load),
+				i.e. the tree is resized at most once to fit all objects, instead of re-inserting all objects on every resize.
+				\param[in] objects Unique identifiers and bounding boxes of the inserted objects.
+			*/
+			virtual void insertObjects(const ObjectArray<T>& objects);
+
+			/**
+				\brief Remove an object with its unique identifier from all leaves it occupies and prune empty branches.
+				\param[in] id unique identifier of the removed object.
+				\returns True if the object was part of this tree.
+			*/
+			virtual const bool removeObject(const T& id);
+
+			/**
+				\brief Move an object with its unique identifier to a new bounding box.
+				\param[in] id unique identifier of the updated object.
+				\param[in] lowerBound Coordinates of the object's new BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's new BBox upper bound in real vector space.
+				\note Objects that are not part of this tree are simply inserted.
+			*/
+			virtual void updateObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Get the ids of the leaf with the bounding box that has the nearest distance to the query-point.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\returns Ids of the closest leaf of the tree that is not empty.
+				\note If the tree is empty the (empty) ids of root are returned.
+			*/
+			const IdArray<T>& getNearest(const double& x, const double& y, const double& z) const;
+
+			/**
+				\brief Get the ids of the leaf with the bounding box that has the nearest distance to the query-point.
+				But ignore any leaves that only contain ids that should be ignored.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest leaf.
+				\returns Ids of the closest leaf of the tree that is not empty.
+				\note If the tree is empty the (empty) ids of root are returned.
+			*/
+			const IdArray<T>& getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) const;
+
+			/**
+				\brief Check if an object with the given unique identifier is part of this tree.
+				\param[in] id unique identifier of the object.
+				\returns True if the object occupies any leaf of this tree.
+			*/
+			virtual const bool containsObject(const T& id) const;
+
+			/**
+				\brief Get the bounding box an object was inserted with.
+				\param[in] id unique identifier of the object.
+				\param[out] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[out] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\returns True if the object is part of this tree, the bounds are not changed otherwise.
+			*/
+			virtual const bool getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const;
+
+			/**
+				\brief Get the ids of all leaves whose bounding boxes share the nearest distance to the query-point,
+				e.g. all leaves an object on the border of two leaves occupies.
+				But ignore any leaves that only contain ids that should be ignored.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest leaves.
+				\returns Union of the ids of the closest leaves without the ignored ids, empty if the tree is empty.
+			*/
+			virtual const IdSet<T> getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs);
+
+			/**
+				\brief Collect statistics about the shape and memory usage of this tree,
+				i.e. node, leaf and id counts, the depth and occupancy histograms and the number of resizes.
+				\returns Statistics of this tree's current state, node bytes are the approximate size of the node hash table.
+				\note Walks all nodes and objects of the tree, i.e. this is meant for tuning and not for hot paths.
+			*/
+			virtual const TreeStats getStats() const;
+
+			/**
+				\brief Get the bounds of this tree's nodes, e.g. to render the tree.
+				\param[out] bounds Buffer the lower and upper bounds of the nodes are appended to.
+				\param[in] includeEmpty If false, nodes that do not contain any ids are skipped.
+				\returns Number of bounds appended to the buffer.
+			*/
+			virtual const size_t getNodeBounds(std::vector<std::pair<Bounds, Bounds>>& bounds, const bool includeEmpty) const;
+
+			/**
+				\brief Get the lower spatial boundaries of this tree's root.
+				\returns Coordinates of the lower bound in real vector space.
+			*/
+			const Bounds& getLowerBounds() const;
+
+			/**
+				\brief Get the upper spatial boundaries of this tree's root.
+				\returns Coordinates of the upper bound in real vector space.
+			*/
+			const Bounds& getUpperBounds() const;
+
+			/**
+				\brief Get the depth at which all leaves of this tree reside.
+				\returns Leaf depth, where root has a depth of zero.
+			*/
+			const unsigned int& getLeafDepth() const;
+
+			/**
+				\brief Get the number of nodes (inner nodes and leaves) in this tree.
+				\returns Number of stored nodes.
+			*/
+			const size_t getNodeCount() const;
+
+			/**
+				\brief Calculate the Morton key of the cell with the given integer coordinates at the given depth.
+				\param[in] cx Integer x-coordinate of the cell, must be smaller than 2^depth.
+				\param[in] cy Integer y-coordinate of the cell, must be smaller than 2^depth.
+				\param[in] cz Integer z-coordinate of the cell, must be smaller than 2^depth.
+				\param[in] depth Depth of the cell, must not exceed MAX_LINEAR_DEPTH.
+				\returns Morton key of the cell including its depth sentinel bit.
+			*/
+			static const MortonKey encodeKey(const std::uint32_t& cx, const std::uint32_t& cy, const std::uint32_t& cz, const unsigned int& depth);
+
+			/**
+				\brief Calculate the depth of the node with the given Morton key.
+				\param[in] key Morton key of a node including its depth sentinel bit.
+				\returns Depth of the node, where root has a depth of zero.
+			*/
+			static const unsigned int calcDepthOfKey(const MortonKey& key);
+
+			/**
+				\brief Calculate the lower spatial boundaries of the node with the given Morton key.
+				\param[in] key Morton key of a node including its depth sentinel bit.
+				\returns Coordinates of the lower bound in real vector space.
+			*/
+			const Bounds calcLowerBoundsOfKey(const MortonKey& key) const;
+
+			/**
+				\brief Calculate the upper spatial boundaries of the node with the given Morton key.
+				\param[in] key Morton key of a node including its depth sentinel bit.
+				\returns Coordinates of the upper bound in real vector space.
+			*/
+			const Bounds calcUpperBoundsOfKey(const MortonKey& key) const;
+
+		private:
+
+			/**
+				\brief Helper class representing a node of a linear OctTree, i.e. a bit mask of existing children
+				and the ids of objects residing in the node.
+			*/
+			class LinearNode {
+			public:
+
+				/* Bit i is set if the child with the octant code i exists. */
+				unsigned char children;
+
+				/* Ids of objects residing in this node (leaves only). */
+				IdArray<T> ids;
+
+				/**
+					\brief Default-Constructor
+				*/
+				LinearNode() : children(0) {};
+			};
+
+			/* Hash table of this tree's nodes, mapped to their Morton keys. */
+			unordered_map<MortonKey, LinearNode> nodes;
+
+			/**
+				\brief Helper class storing an inserted object's id and bounding box.
+			*/
+			class LinearObject {
+			public:
+
+				/* Unique identifier of the object. */
+				T id;
+
+				/* Lower and upper bounds of the object's bounding box. */
+				Bounds lower, upper;
+
+				/**
+					\brief Construct a new object entry.
+				*/
+				LinearObject(const T& id, const Bounds& lower, const Bounds& upper) : id(id), lower(lower), upper(upper) {};
+			};
+
+			/* Bounding boxes of all inserted objects mapped to their ids, required to remove objects and to re-insert them after the tree was resized. */
+			unordered_map<T, LinearObject> objects;
+
+			/* Lower and upper spatial bounds of this tree's root. */
+			Bounds lower, upper;
+
+			/* Minimal symmetric diameter of this tree's leaf-nodes. */
+			Bounds minDiameter;
+
+			/* Diameter of a leaf-node in x, y and z direction. */
+			Bounds leafDiameter;
+
+			/* Depth at which all leaves of this tree reside. */
+			unsigned int leafDepth;
+
+			/* Flag if this tree is allowed to expand itself to accomodate
+				for new objects outside of the inital root sub-space. */
+			bool allowResize;
+
+			/* Number of times the root was replaced by growing this tree. */
+			size_t resizeCount;
+
+			/**
+				\brief Construct a new LinearOctTree-object.
+				\param[in] lower Initial lower spatial bounds of this tree's root.
+				\param[in] upper Initial upper spatial bounds of this tree's root.
+				\param[in] minDiameter Minimal allowed symmetric width/heigth/length of a leaf-node (i.e. resolution).
+			*/
+			LinearOctTree(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter);
+
+			/**
+				\brief Set the root bounds of this tree, recalculate the leaf depth and remove all nodes.
+				\param[in] lowerBound Lower spatial bounds of the tree's root.
+				\param[in] upperBound Upper spatial bounds of the tree's root.
+			*/
+			void reset(const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Resize this tree until the given bounds fit, then re-insert all objects.
+				\param[in] lowerBound Lower spatial bounds that should fit into the resized tree.
+				\param[in] upperBound Upper spatial bounds that should fit into the resized tree.
+			*/
+			void resize(const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Insert an object into all leaves its bounding box overlaps and link the leaves with their ancestors.
+				\param[in] id unique identifier of the inserted object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+			*/
+			void insertIntoLeaves(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Remove an object from all leaves its bounding box overlaps and remove leaves and ancestors that became empty.
+				\param[in] id unique identifier of the removed object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+			*/
+			void removeFromLeaves(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Calculate the integer cell coordinate of a real coordinate at leaf depth, clamped to the tree's bounds.
+				\param[in] value Real coordinate.
+				\param[in] rootLower Lower bound of the root in the same axis.
+				\param[in] cellDiameter Leaf diameter in the same axis.
+				\returns Integer cell coordinate.
+			*/
+			const std::uint32_t calcCell(const double& value, const double& rootLower, const double& cellDiameter) const;
+
+			/**
+				\brief Calculate the minimum distance of a given query-point to the bounding-box of the node with the given key.
+				\param[in] key Morton key of a node including its depth sentinel bit.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\returns Distance of the query-point to the BBox surface, 0 if inside the BBbox.
+			*/
+			const double calcMinDistance(const MortonKey& key, const double& x, const double& y, const double& z) const;
+		};
+	}
+}
@@ -0,0 +1,510 @@
+#pragma once
+#undef max
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_set>
+#include "..\include\Bounds.h"
+#include "..\include\IdStorage.h"
+
+namespace collision {
+	namespace octtree {
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class MappedOctTree;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class MappedOctTreeQuery;
+
+		// Forward declaration to remove unnecessary includes.
+		class SnapshotFile;
+
+		// Aliases for used namespaces
+		using std::shared_ptr;
+
+		template <typename T>
+		using MappedTreePtr = shared_ptr<MappedOctTree<T>>;
+		template <typename T>
+		using MappedQueryPtr = shared_ptr<MappedOctTreeQuery<T>>;
+		using SnapshotPtr = shared_ptr<SnapshotFile>;
+		template <typename T>
+		using IdSet = std::unordered_set<T>;
+
+		/* Magic number at the beginning of every OctTree snapshot, reads "OCTS" in a little endian file. */
+		static const std::uint32_t SNAPSHOT_MAGIC = 0x5354434F;
+
+		/* Version of the snapshot layout, snapshots of other versions are rejected. */
+		static const std::uint32_t SNAPSHOT_VERSION = 1;
+
+		/* Index of a node that does not exist, e.g. the parent of root. */
+		static const std::uint32_t NO_NODE = 0xFFFFFFFF;
+
+		/**
+			\brief Header of an OctTree snapshot, i.e. the counts of all sections and their offsets relative to the header.
+			A snapshot only contains indices and offsets, but no pointers, hence it may be mapped at any address.
+		*/
+		class SnapshotHeader {
+		public:
+
+			/* SNAPSHOT_MAGIC and SNAPSHOT_VERSION of the snapshot. */
+			std::uint32_t magic, version;
+
+			/* Size of an id in bytes and 1 if ids are integral numbers, to reject snapshots of trees with other id types. */
+			std::uint32_t idSize, idIntegral;
+
+			/* Number of nodes, ids stored in nodes, objects and occupied nodes of all objects. */
+			std::uint32_t nodeCount, idCount, objectCount, nodeRefCount;
+
+			/* Factor by which node bounds are enlarged, 1.0 for a regular OctTree. */
+			double looseness;
+
+			/* Offsets of the node, object, id and node reference sections in bytes. */
+			std::uint64_t nodeOffset, objectOffset, idOffset, nodeRefOffset;
+
+			/* Size of the whole snapshot in bytes. */
+			std::uint64_t size;
+		};
+
+		/**
+			\brief Node of an OctTree snapshot. Nodes are numbered breadth first, starting with root,
+			so that the children of a node are stored next to each other in the order of their octants.
+		*/
+		class SnapshotNode {
+		public:
+
+			/* Lower and upper bounds of the node. */
+			double lower[3], upper[3];
+
+			/* Index of the parent and of the first child, NO_NODE if there is none. */
+			std::uint32_t parent, firstChild;
+
+			/* Index of the node's first id in the id section and number of its (sorted) ids. */
+			std::uint32_t firstId, idCount;
+
+			/* Number of ids stored in the node and all of its descendants. */
+			std::uint32_t subtreeIdCount;
+
+			/* Bit i is set if the child of octant i exists. */
+			std::uint8_t childMask;
+
+			/* 1 if the node is a leaf. */
+			std::uint8_t leaf;
+		};
+
+		/**
+			\brief Object of an OctTree snapshot, objects are sorted by their ids.
+		*/
+		template <typename T>
+		class SnapshotObject {
+		public:
+
+			/* Unique identifier of the object. */
+			T id;
+
+			/* Lower and upper bounds of the object's bounding box. */
+			double lower[3], upper[3];
+
+			/* Index of the object's first occupied node in the node reference section and number of occupied nodes. */
+			std::uint32_t firstNodeRef, nodeRefCount;
+		};
+
+		/**
+			\brief Round an offset up to the alignment of all sections of a snapshot.
+			\param[in] offset Offset in bytes.
+			\returns Next multiple of eight.
+		*/
+		inline std::uint64_t alignSnapshotOffset(const std::uint64_t& offset) {
+			return (offset + 7) & ~static_cast<std::uint64_t>(7);
+		}
+
+		/**
+			\brief Objects of this class map a file read-only into memory, e.g. a file containing OctTree snapshots.
+			The pages are shared between all processes that map the same file.
+		*/
+		class SnapshotFile {
+		public:
+
+			/**
+				\brief Call to map a file into memory.
+				\param[in] path Path of the mapped file.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note Throws if the file cannot be opened or mapped.
+			*/
+			static SnapshotPtr create(const std::string& path);
+
+			/**
+				\brief Call to take ownership of snapshots in memory instead of a mapped file, e.g. to freeze an OctTree.
+				\param[in] buffer Buffer containing the snapshots, which is moved into the new object.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note Throws if the buffer is empty.
+			*/
+			static SnapshotPtr create(std::vector<char>&& buffer);
+
+			/**
+				\brief Get the first byte of the mapped file.
+				\returns Pointer to the mapped memory.
+			*/
+			const char* getData() const;
+
+			/**
+				\brief Get the size of the mapped file.
+				\returns Size in bytes.
+			*/
+			const size_t& getSize() const;
+
+			/**
+				\brief Destructor, unmaps the file.
+			*/
+			~SnapshotFile();
+
+		private:
+
+			/* First byte of the mapped file. */
+			const char* data;
+
+			/* Size of the mapped file in bytes. */
+			size_t size;
+
+			/* Handle of the file mapping, only used on Windows. */
+			void* mapping;
+
+			/* Snapshots owned in memory, empty if a file is mapped. */
+			std::vector<char> buffer;
+
+			/**
+				\brief Construct a new SnapshotFile-object.
+				\param[in] path Path of the mapped file.
+			*/
+			SnapshotFile(const std::string& path);
+
+			/**
+				\brief Construct a new SnapshotFile-object.
+				\param[in] buffer Buffer containing the snapshots.
+			*/
+			SnapshotFile(std::vector<char>&& buffer);
+
+			SnapshotFile(const SnapshotFile&) = delete;
+			SnapshotFile& operator=(const SnapshotFile&) = delete;
+		};
+
+		/**
+			\brief Objects of this class carry the scratch memory of MappedOctTree queries, like OctTreeQuery does for OctTrees,
+			i.e. the heap of node indices ordered by their distance to the query-point and the per-node marks of ignored ids.
+			Memory is only allocated when a query needs more space than any query before.
+			\note A query context may be used with any number of mapped trees, but only by one thread at a time.
+		*/
+		template <typename T>
+		class MappedOctTreeQuery {
+		public:
+
+			/**
+				\brief Call to instantiate a new MappedOctTreeQuery-object.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note This is the only way to "make" a MappedOctTreeQuery-object, i.e. Constructor is private!
+			*/
+			static MappedQueryPtr<T> create();
+
+		private:
+
+			/* Heap of node indices paired with their distance to the query-point, the nearest node is on top. */
+			std::vector<std::pair<double, std::uint32_t>> heap;
+
+			/* Stamp of the current query, marks of nodes with another stamp belong to previous queries. */
+			size_t stamp;
+
+			/* Stamp of the query that marked ignored ids of a node, indexed by node index. */
+			std::vector<size_t> stamps;
+
+			/* Number of ids in a node that are ignored by the current query, indexed by node index. */
+			std::vector<std::uint32_t> ignoredIds;
+
+			/* Number of ids in the sub-tree of a node that are ignored by the current query, indexed by node index. */
+			std::vector<std::uint32_t> ignoredSubtreeIds;
+
+			/* Ids collected by queries whose results are converted afterwards, e.g. into an IdSet. */
+			std::vector<T> ids;
+
+			/**
+				\brief Construct a new MappedOctTreeQuery-object.
+			*/
+			MappedOctTreeQuery();
+
+			/**
+				\brief Start a new query, i.e. empty the heap and discard all marks of previous queries.
+				\param[in] nodeCount Number of nodes of the queried tree.
+			*/
+			void begin(const size_t& nodeCount);
+
+			/**
+				\brief Push a node onto the heap.
+				\param[in] node Index of the pushed node.
+				\param[in] distance Distance of the node to the query-point.
+			*/
+			void push(const std::uint32_t& node, const double& distance);
+
+			/**
+				\brief Remove the nearest node from the heap.
+				\returns Distance and index of the nearest node.
+			*/
+			const std::pair<double, std::uint32_t> pop();
+
+			/**
+				\brief Mark one id in the sub-tree of a node as ignored.
+				\param[in] index Index of the node.
+				\param[in] own True if the id resides in the node itself, false if it resides in a descendant.
+			*/
+			void markIgnoredId(const std::uint32_t& index, const bool own);
+
+			/**
+				\brief Get the number of ignored ids of a node.
+				\param[in] index Index of the node.
+				\returns Number of ids of the node that are ignored by the current query.
+			*/
+			const std::uint32_t getIgnoredIds(const std::uint32_t& index) const;
+
+			/**
+				\brief Get the number of ignored ids in the sub-tree of a node.
+				\param[in] index Index of the node.
+				\returns Number of ids of the node and its descendants that are ignored by the current query.
+			*/
+			const std::uint32_t getIgnoredSubtreeIds(const std::uint32_t& index) const;
+
+			// Mapped trees run their queries on the scratch memory of this context.
+			friend class MappedOctTree<T>;
+		};
+
+		/**
+			\brief Objects of this class are read-only OctTrees, which answer queries directly from a snapshot written by OctTree::save,
+			i.e. without deserializing it. Snapshots are usually memory mapped, so that many processes share one physical copy.
+			Queries return the same results as the OctTree the snapshot was taken from.
+			\note All methods are const, hence queries may run concurrently, each thread with a query context of its own.
+			Queries without a query context allocate a temporary one.
+		*/
+		template <typename T>
+		class MappedOctTree {
+		public:
+
+			/**
+				\brief Call to open the snapshot of a single OctTree.
+				\param[in] path Path of a file written by OctTree::save.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note Throws if the file is not a valid snapshot of a tree with this id type,
+				e.g. if any node, id or node reference index exceeds its section.
+			*/
+			static MappedTreePtr<T> create(const std::string& path);
+
+			/**
+				\brief Call to open a snapshot inside a mapped file, e.g. one of many snapshots in the same file.
+				\param[in] file Mapped file, which is kept alive by the new tree.
+				\param[in] offset Offset of the snapshot in the file, must be a multiple of eight.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note Throws if there is no valid snapshot of a tree with this id type at the given offset.
+			*/
+			static MappedTreePtr<T> create(SnapshotPtr file, const size_t& offset);
+
+			/**
+				\brief Get the ids of the node with the bounding box that has the nearest distance to the query-point.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\returns Ids of the closest node of the tree that is not empty, which point into the mapped snapshot.
+				\note If the tree is empty the (empty) ids of root are returned.
+			*/
+			const IdSpan<T> getNearest(const double& x, const double& y, const double& z) const;
+
+			/**
+				\brief Get the ids of the node with the bounding box that has the nearest distance to the query-point,
+				using the scratch memory of the given query context.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Ids of the closest node of the tree that is not empty, which point into the mapped snapshot.
+			*/
+			const IdSpan<T> getNearest(const double& x, const double& y, const double& z, MappedOctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the ids of the node with the bounding box that has the nearest distance to the query-point.
+				But ignore any nodes that only contain ids that should be ignored.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest node.
+				\returns Ids of the closest node of the tree that is not empty, which point into the mapped snapshot.
+				\note If the tree is empty the (empty) ids of root are returned.
+			*/
+			const IdSpan<T> getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) const;
+
+			/**
+				\brief Get the ids of the node with the bounding box that has the nearest distance to the query-point,
+				but ignore any nodes that only contain ids that should be ignored, using the scratch memory of the given query context.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest node.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Ids of the closest node of the tree that is not empty, which point into the mapped snapshot.
+			*/
+			const IdSpan<T> getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, MappedOctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the ids of all nodes whose bounding boxes share the nearest distance to the query-point,
+				e.g. all nodes whose (loose) bounds contain the query-point.
+				But ignore any nodes that only contain ids that should be ignored.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest nodes.
+				\returns Union of the ids of the closest nodes, empty if the tree is empty.
+			*/
+			const IdSet<T> getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) const;
+
+			/**
+				\brief Get the ids of all nodes whose bounding boxes share the nearest distance to the query-point,
+				using the scratch memory of the given query context.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest nodes.
+				\param[out] results Buffer the sorted union of the ids of the closest nodes is appended to, i.e. it is not cleared.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Number of ids appended to the buffer, 0 if the tree is empty.
+			*/
+			const size_t getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, std::vector<T>& results, MappedOctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes are within the given distance of the query-point.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] radius Maximal distance of an object's bounding box to the query-point.
+				\param[out] results Buffer the ids are appended to, each id at most once and in ascending order.
+				\returns Number of ids appended to the buffer.
+			*/
+			const size_t queryRadius(const double& x, const double& y, const double& z, const double& radius, std::vector<T>& results) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes overlap the given axis aligned box.
+				\param[in] lowerBound Coordinates of the query-box's lower bound in real vector space.
+				\param[in] upperBound Coordinates of the query-box's upper bound in real vector space.
+				\param[out] results Buffer the ids are appended to, each id at most once and in ascending order.
+				\returns Number of ids appended to the buffer.
+			*/
+			const size_t queryBox(const Bounds& lowerBound, const Bounds& upperBound, std::vector<T>& results) const;
+
+			/**
+				\brief Check if an object with the given unique identifier is part of this tree.
+				\param[in] id unique identifier of an object.
+				\returns True if the object is part of the snapshot.
+			*/
+			const bool containsObject(const T& id) const;
+
+			/**
+				\brief Get the bounding box an object was inserted with.
+				\param[in] id unique identifier of an object.
+				\param[out] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[out] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\returns True if the object is part of this tree, the bounds are not changed otherwise.
+			*/
+			const bool getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const;
+
+			/**
+				\brief Check if this tree is a loose OctTree.
+				\returns True if the looseness of this tree is greater than 1.0.
+			*/
+			const bool isLoose() const;
+
+			/**
+				\brief Get the lower spatial boundaries of this tree's root.
+				\returns Coordinates of the lower bound in real vector space.
+			*/
+			const Bounds getLowerBounds() const;
+
+			/**
+				\brief Get the upper spatial boundaries of this tree's root.
+				\returns Coordinates of the upper bound in real vector space.
+			*/
+			const Bounds getUpperBounds() const;
+
+			/**
+				\brief Get the number of nodes (inner nodes and leaves) in this tree.
+				\returns Number of stored nodes.
+			*/
+			const size_t getNodeCount() const;
+
+			/**
+				\brief Get the number of objects in this tree.
+				\returns Number of stored objects.
+			*/
+			const size_t getObjectCount() const;
+
+		private:
+
+			/* Mapped file the snapshot resides in, which is kept alive as long as this tree exists. */
+			SnapshotPtr file;
+
+			/* Header of the snapshot. */
+			const SnapshotHeader* header;
+
+			/* Nodes of the snapshot, root is the first node. */
+			const SnapshotNode* nodes;
+
+			/* Objects of the snapshot, sorted by their ids. */
+			const SnapshotObject<T>* objects;
+
+			/* Ids of all nodes, the ids of each node are sorted. */
+			const T* ids;
+
+			/* Indices of the nodes occupied by all objects. */
+			const std::uint32_t* nodeRefs;
+
+			/**
+				\brief Construct a new MappedOctTree-object.
+				\param[in] file Mapped file the snapshot resides in.
+				\param[in] offset Offset of the snapshot in the file.
+			*/
+			MappedOctTree(SnapshotPtr file, const size_t& offset);
+
+			/**
+				\brief Get the ids of a node.
+				\param[in] node Node of the snapshot.
+				\returns Span of the node's sorted ids.
+			*/
+			const IdSpan<T> getIds(const SnapshotNode& node) const;
+
+			/**
+				\brief Find an object of the snapshot by a binary search.
+				\param[in] id unique identifier of an object.
+				\returns Pointer to the object or nullptr, if the object is not part of the snapshot.
+			*/
+			const SnapshotObject<T>* findObject(const T& id) const;
+
+			/**
+				\brief Calculate the distance of the query-point to the (loose) bounds of a node, exactly like OctTreeNode::calcMinDistance.
+				\param[in] node Node of the snapshot.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\returns Distance of the point to the node, 0 if the point lies inside.
+			*/
+			const double calcMinDistance(const SnapshotNode& node, const double& x, const double& y, const double& z) const;
+
+			/**
+				\brief Check the node, id and node reference indices of the snapshot once, so that queries never leave their sections.
+				\note Throws if a node's children, ids or parent or an object's node references exceed their sections,
+				or if a node's parent or children do not follow the breadth first numbering.
+			*/
+			void validate() const;
+
+			/**
+				\brief Mark the nodes of all ignored ids and their ancestors in the given query context, like OctTree does.
+				\param[in] ignoreIDs Set of IDs that should be ignored by the current query.
+				\param[in] query Query context of the current query.
+			*/
+			void markIgnoredIds(const IdSet<T>& ignoreIDs, MappedOctTreeQuery<T>& query) const;
+		};
+	}
+}
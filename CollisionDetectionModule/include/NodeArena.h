@@ -0,0 +1,128 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include "..\include\OctTreeNode.h"
+
+namespace collision {
+	namespace octtree {
+
+		// Forward declaration to deal with circular dependencies.
+		template <typename T>
+		class NodeArena;
+
+		// Aliases for used namespaces
+		template <typename T>
+		using ArenaPtr = shared_ptr<NodeArena<T>>;
+
+		/* Default number of nodes that fit into one slab of a NodeArena. */
+		static const size_t NODE_SLAB_SIZE = 256;
+
+		/**
+			\brief Objects of this class carry allocation statistics of a NodeArena,
+			e.g. to compare the number of heap allocations needed to build an OctTree.
+		*/
+		class AllocationStats {
+		public:
+
+			/* Number of nodes currently in use, i.e. allocated and not released. */
+			size_t nodeCount;
+
+			/* Number of slabs allocated on the heap, i.e. the number of heap allocations for nodes. */
+			size_t slabCount;
+
+			/* Number of bytes reserved for nodes in all slabs. */
+			size_t reservedBytes;
+
+			/**
+				\brief Default-Constructor
+			*/
+			AllocationStats() : nodeCount(0), slabCount(0), reservedBytes(0) {};
+		};
+
+		/**
+			\brief Objects of this class are block allocators for OctTreeNode-objects.
+			Nodes are constructed in large slabs of memory, which are only released when the arena itself is destroyed.
+			Nodes are handed out as smart pointers that share ownership of the arena (aliasing constructor), hence
+			no node requires a heap allocation or a control block of its own and all nodes of an arena are freed in one shot.
+			Released nodes are reset and recycled by subsequent allocations.
+			\note Nodes never move once constructed, i.e. raw pointers to nodes stay valid as long as the arena lives.
+		*/
+		template <typename T>
+		class NodeArena : public std::enable_shared_from_this<NodeArena<T>> {
+		public:
+
+			/**
+				\brief Call to instantiate a new NodeArena-object.
+				\param[in] slabSize Number of nodes that fit into one slab.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note This is the only way to "make" a NodeArena-object, i.e. Constructor is private!
+			*/
+			static ArenaPtr<T> create(const size_t& slabSize = NODE_SLAB_SIZE);
+
+			/**
+				\brief Construct a new node inside this arena.
+				\returns Smart pointer to the new node, which keeps this arena alive.
+			*/
+			NodePtr<T> allocate();
+
+			/**
+				\brief Release a node of this arena, so that its memory may be reused by the next allocation.
+				\param[in] node Smart pointer to a node constructed in this arena.
+				\note The node is reset immediately, other smart pointers to it must not be used afterwards.
+			*/
+			void release(NodePtr<T> node);
+
+			/**
+				\brief Take over all slabs and nodes of another arena, e.g. one that was filled by another thread.
+				Nodes do not move, smart pointers to them handed out by this arena afterwards keep this arena alive instead.
+				\param[in] other Arena whose slabs are moved into this arena, it is empty afterwards.
+				\note Both arenas have to use the same slab size.
+			*/
+			void adopt(ArenaPtr<T> other);
+
+			/**
+				\brief Get the allocation statistics of this arena.
+				\returns Number of constructed nodes, allocated slabs and reserved bytes.
+			*/
+			const AllocationStats& getStats() const;
+
+			/**
+				\brief Get the number of node indices handed out by this arena.
+				\returns Upper bound of the indices of all nodes in this arena, i.e. size of arrays indexed by node.
+			*/
+			const size_t& getIndexCount() const;
+
+			/**
+				\brief Destructor, destroys all nodes and releases all slabs.
+			*/
+			~NodeArena();
+
+		private:
+
+			/* Slabs of raw memory, each with space for slabSize nodes. */
+			std::vector<OctTreeNode<T>*> slabs;
+
+			/* Number of nodes that fit into one slab. */
+			size_t slabSize;
+
+			/* Number of nodes constructed in each slab, only the last slab may still have room for new nodes. */
+			std::vector<size_t> used;
+
+			/* Number of node indices handed out, every node constructed in this arena gets the next index. */
+			size_t indexCount;
+
+			/* Released nodes, which are reused before new nodes are constructed. */
+			std::vector<OctTreeNode<T>*> freeNodes;
+
+			/* Allocation statistics of this arena. */
+			AllocationStats stats;
+
+			/**
+				\brief Construct a new NodeArena-object.
+				\param[in] slabSize Number of nodes that fit into one slab.
+			*/
+			NodeArena(const size_t& slabSize);
+		};
+	}
+}
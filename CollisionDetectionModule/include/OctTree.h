@@ -1,9 +1,13 @@
 #pragma once
 #undef max
 #include <memory>
+#include <string>
+#include <cstdint>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 #include "..\include\Bounds.h"
+#include "..\include\SpatialTree.h"
 
 namespace collision {
 	namespace octtree {
@@ -16,6 +20,21 @@ namespace collision {
 		template <typename T>
 		class OctTree;
 
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class NodeArena;
+
+		// Forward declaration to remove unnecessary includes.
+		class AllocationStats;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class OctTreeQuery;
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class MappedOctTree;
+
 		namespace octant {
 			// Forward declaration to remove unnecessary includes.
 			enum Octant;
@@ -34,23 +53,85 @@ namespace collision {
 		template <typename T>
 		using TreePtr = shared_ptr<OctTree<T>>;
 		template <typename T>
+		using ArenaPtr = shared_ptr<NodeArena<T>>;
+		template <typename T>
+		using QueryPtr = shared_ptr<OctTreeQuery<T>>;
+		template <typename T>
+		using MappedTreePtr = shared_ptr<MappedOctTree<T>>;
+		template <typename T>
 		using IdSet = std::unordered_set<T>;
 
+		/**
+			\brief Objects of this class carry the result of a k-nearest-neighbor query, i.e. an object's id and
+			the distance of its bounding box to the query-point.
+		*/
+		template <typename T>
+		class Neighbor {
+		public:
+
+			/* Unique identifier of the object. */
+			T id;
+
+			/* Distance of the object's bounding box to the query-point, 0 if the query-point lies inside. */
+			double distance;
+
+			/**
+				\brief Constructor
+				\param[in] id Unique identifier of the object.
+				\param[in] distance Distance of the object's bounding box to the query-point.
+			*/
+			Neighbor(const T& id, const double& distance) : id(id), distance(distance) {};
+		};
+
+		template <typename T>
+		using NeighborArray = std::vector<Neighbor<T>>;
+
+		/**
+			\brief Objects of this class are the narrow-phase of a ray query, i.e. they calculate where the ray actually hits an object
+			whose bounding box it enters. Derive from this class to pass the narrow-phase to OctTree::queryRay.
+		*/
+		template <typename T>
+		class RayVisitor {
+		public:
+
+			/**
+				\brief Destructor
+			*/
+			virtual ~RayVisitor() {};
+
+			/**
+				\brief Called once per object whose bounding box is entered by the ray, ordered by ascending entry distance.
+				\param[in] id Unique identifier of the object.
+				\param[in] distance Distance along the ray at which its bounding box is entered, 0 if it contains the origin.
+				\returns Distance along the ray at which the object is hit, POS_INF if it is missed.
+			*/
+			virtual const double visit(const T& id, const double& distance) = 0;
+		};
+
 		/**
 			\brief Objects of this class contain a tree structure called OctTree, that divides real vector space (R^3)
 			into equally spaced sub-spaces (aka. octants).
 			A node in this tree may contain complete 3D-objects, parts of it or 3D-points.
 			New objects may be inserted by using their bounding-box (for 3D objects) or their coordinates (for 3D-points).
 			If an object that lies outside of a tree's outer boundaries is inserted, the tree will be expanded until the obect fits.
-			Expanding the tree means, that the root diameter is doubled (up to 10 times) and child nodes are re-inserted.
+			Objects may be removed or moved later on, which only touches the leaves the object occupies and prunes empty branches.
+			Optionally leaves may be given a capacity, i.e. leaves are only split once they contain too many objects
+			and merged again once their siblings contain few objects, instead of always subdividing down to the minimal diameter.
+			Expanding the tree means, that a new root of twice the diameter is added on top of the old one (up to 10 times),
+			which grows towards the inserted object and keeps the old root as one of its octants.
+			Resizable trees drop empty roots with a single child again once objects are removed or moved, and compact()
+			rebuilds the tree around the current objects, so that the tree's depth follows the extent of its content.
 			The OctTree's main function is to do a nearest neigbor search for query-points, i.e. find the nearest collection of
 			objects/points in this tree to the given query-point. This may be used to implement an efficient and
 			fast collision checking algorithm.
-			\note Only leaf-nodes may contain objects in this OctTree implementation, but one object may occupy more than one
+			\note In a regular OctTree only leaf-nodes may contain objects, but one object may occupy more than one
 			leaf-node if its boundaries overlap with other leafs.
+			In a loose OctTree each node's bounds are enlarged by the looseness factor and every object is stored exactly once,
+			namely in the deepest node whose enlarged bounds contain the object, i.e. inner nodes may contain objects as well.
+			Nodes are allocated from a NodeArena owned by the tree, which releases all nodes at once when the tree is dropped.
 		*/
 		template <typename T>
-		class OctTree {
+		class OctTree : public SpatialTree<T> {
 		public:
 
 			/**
@@ -58,35 +139,71 @@ namespace collision {
 				\param[in] lower Initial lower spatial bounds of this tree's root.
 				\param[in] upper Initial upper spatial bounds of this tree's root.
 				\param[in] minDiameter Minimal allowed symmetric width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
 				\returns Returns a smart pointer to the new object on the heap.
 				\note This is the only way to "make" an OctTree-object, i.e. Constructor is private!
 			*/
-			static TreePtr<T> create(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter);
+			static TreePtr<T> create(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter, const double& looseness = 1.0);
 
 			/**
 				\brief Call to instantiate a new OctTree-object.
 				\param[in] diameter Initial symmetric spatial bounds of this tree's root.
 				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
 				\returns Returns a smart pointer to the new object on the heap.
 				\note This is the only way to "make" an OctTree-object, i.e. Constructor is private!
 			*/
-			static TreePtr<T> create(const Bounds& diameter, const Bounds& minDiameter);
+			static TreePtr<T> create(const Bounds& diameter, const Bounds& minDiameter, const double& looseness = 1.0);
 
 			/**
 				\brief Call to instantiate a new OctTree-object.
 				\param[in] treeDiameter Initial symmetric allowed width/heigth/length of this tree's root.
 				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
 				\returns Returns a smart pointer to the new object on the heap.
 				\note This is the only way to "make" an OctTree-object, i.e. Constructor is private!
 			*/
-			static TreePtr<T> create(const double& treeDiameter, const double& minCellDiameter);
+			static TreePtr<T> create(const double& treeDiameter, const double& minCellDiameter, const double& looseness = 1.0);
+
+			/**
+				\brief Call to instantiate a new OctTree-object from many objects at once (bulk-load).
+				The root's bounds are the tightest cube around all given objects' bounding boxes.
+				\param[in] objects Unique identifiers and bounding boxes of the inserted objects.
+				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
+				\returns Returns a smart pointer to the new object on the heap.
+			*/
+			static TreePtr<T> createFromObjects(const ObjectArray<T>& objects, const Bounds& minDiameter, const double& looseness = 1.0);
 
 			/**
 				\brief Set the resize allowed flag for this tree.
 				\param[in] resizeOn If true, this tree is allowed to expand itself to accomodate 
-				for new objects outside of the inital root sub-space.
+				for new objects outside of the inital root sub-space and to shrink itself once objects were removed.
 			*/
-			void setAllowResize(const bool resizeOn);
+			virtual void setAllowResize(const bool resizeOn);
+
+			/**
+				\brief Set the capacity of this tree's leaves.
+				\param[in] leafCapacity A leaf is split once it would contain more than this number of ids, 0 disables splitting by occupancy,
+				i.e. leaves are always subdivided down to the minimal diameter.
+				\param[in] mergeThreshold Sibling leaves are merged into their parent once they contain less than this number of distinct ids.
+				\note Has to be set before any objects are inserted, the minimal diameter and the maximal depth are still respected.
+			*/
+			void setLeafCapacity(const unsigned int& leafCapacity, const unsigned int& mergeThreshold);
+
+			/**
+				\brief Set the maximal depth of this tree's leaves.
+				\param[in] maxDepth Nodes at this depth are never split, where root has a depth of zero.
+			*/
+			void setMaxDepth(const unsigned int& maxDepth);
+
+			/**
+				\brief Set the number of threads used to bulk-load objects into this tree.
+				The branches below the root's octants are built as independent tasks, each in its own node arena,
+				and merged into this tree afterwards, i.e. the result is exactly the same tree as built by a single thread.
+				\param[in] buildThreads Number of threads, 1 builds the tree on the calling thread and 0 uses all hardware threads.
+			*/
+			void setBuildThreads(const unsigned int& buildThreads);
 
 
 			/**
@@ -95,7 +212,58 @@ namespace collision {
 				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
 				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
 			*/
-			void insertObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+			virtual void insertObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Insert many objects with their unique identifiers and bounding boxes into this tree at once (bulk-load).
+				The tree is grown just like for single insertions to fit all objects, then the leaves of all objects are sorted by their
+				Morton codes and the tree is built in a single pass, i.e. without recursive splitting of bounding boxes.
+				\param[in] objects Unique identifiers and bounding boxes of the inserted objects.
+				\note Results in the same tree as inserting the objects one by one, regardless of the number of build threads.
+				Loose trees and trees with a leaf capacity insert the objects one by one after resizing.
+			*/
+			virtual void insertObjects(const ObjectArray<T>& objects);
+
+			/**
+				\brief Remove an object with its unique identifier from all leaves it occupies and prune empty branches.
+				\param[in] id unique identifier of the removed object.
+				\returns True if the object was part of this tree.
+			*/
+			virtual const bool removeObject(const T& id);
+
+			/**
+				\brief Move an object with its unique identifier to a new bounding box, i.e. insert it into the
+				leaves of the new bounding box and remove it from all other leaves it occupied before.
+				\param[in] id unique identifier of the updated object.
+				\param[in] lowerBound Coordinates of the object's new BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's new BBox upper bound in real vector space.
+				\note Objects that are not part of this tree are simply inserted, objects whose bounding box did not change are not touched.
+			*/
+			virtual void updateObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Rebuild this tree with the smallest root bounds that enclose all objects of this tree,
+				where the new root is aligned to the current leaves, i.e. leaves keep their bounds and only empty levels are dropped.
+				\note All nodes are released and the objects are re-inserted with their stored bounding boxes,
+				i.e. previously returned nodes must not be used afterwards. Empty trees are not changed.
+			*/
+			void compact();
+
+			/**
+				\brief Check if an object with the given unique identifier is part of this tree.
+				\param[in] id unique identifier of an object.
+				\returns True if the object occupies any leaf of this tree.
+			*/
+			virtual const bool containsObject(const T& id) const;
+
+			/**
+				\brief Get the bounding box an object was inserted with.
+				\param[in] id unique identifier of an object.
+				\param[out] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[out] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\returns True if the object is part of this tree, the bounds are not changed otherwise.
+			*/
+			virtual const bool getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const;
 
 			/**
 				\brief Get the node with the bounding box that has the nearest distance to the query-point.
@@ -107,9 +275,23 @@ namespace collision {
 			*/
 			NodePtr<T> getNearest(const double& x, const double& y, const double& z);
 
+			/**
+				\brief Get the node with the bounding box that has the nearest distance to the query-point,
+				using the scratch memory of the given query context instead of allocating a new one.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Closest node of the tree that is not empty.
+				\note If the tree is empty root is returned. Queries with distinct contexts may run concurrently.
+			*/
+			NodePtr<T> getNearest(const double& x, const double& y, const double& z, OctTreeQuery<T>& query) const;
+
 			/**
 				\brief Get the node with the bounding box that has the nearest distance to the query-point.
 				But ignore any nodes that only contain ids that should be ignored.
+				The cost of the ignore filter depends on the size of the ignore set only once per query,
+				sub-trees that only contain ignored ids are skipped entirely.
 				\param[in] x X-Coordinate of the given query-point
 				\param[in] y Y-Coordinate of the given query-point
 				\param[in] z Z-Coordinate of the given query-point
@@ -119,16 +301,254 @@ namespace collision {
 			*/
 			NodePtr<T> getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs);
 
+			/**
+				\brief Get the node with the bounding box that has the nearest distance to the query-point.
+				But ignore any nodes that only contain ids that should be ignored.
+				Uses the scratch memory of the given query context instead of allocating a new one.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest node.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Closest node of the tree that is not empty.
+				\note If the tree is empty root is returned. Queries with distinct contexts may run concurrently.
+			*/
+			NodePtr<T> getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, OctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the ids of all nodes whose bounding boxes share the nearest distance to the query-point,
+				e.g. all nodes whose (loose) bounds contain the query-point.
+				But ignore any nodes that only contain ids that should be ignored.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest nodes.
+				\returns Union of the ids of the closest nodes, empty if the tree is empty.
+				\note In a loose OctTree objects overlapping the query-point may reside in several nodes along different paths,
+				hence this is the query to use for collision candidates.
+			*/
+			virtual const IdSet<T> getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs);
+
+			/**
+				\brief Get the ids of all nodes whose bounding boxes share the nearest distance to the query-point,
+				using the scratch memory of the given query context.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest nodes.
+				\param[out] results Buffer the sorted union of the ids of the closest nodes is appended to, i.e. it is not cleared.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Number of ids appended to the buffer, 0 if the tree is empty.
+				\note Neither the query nor a reused buffer allocate, once they grew to the size of the largest query.
+			*/
+			const size_t getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, std::vector<T>& results, OctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the k objects whose bounding boxes are nearest to the query-point.
+				Nodes are visited in the order of their distance, while the k nearest objects found so far are kept in a bounded max-heap,
+				i.e. all nodes farther away than the current k-th distance are pruned.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] k Maximal number of returned objects.
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest objects.
+				\returns Ids and bounding box distances of at most k objects, sorted by ascending distance (and id for equal distances).
+			*/
+			const NeighborArray<T> getKNearest(const double& x, const double& y, const double& z, const unsigned int& k, const IdSet<T>& ignoreIDs);
+
+			/**
+				\brief Get the k objects whose bounding boxes are nearest to the query-point, using the scratch memory of the given query context.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] k Maximal number of returned objects.
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest objects.
+				\param[out] results Buffer the ids and bounding box distances of at most k objects are appended to,
+				sorted by ascending distance (and id for equal distances), i.e. it is not cleared.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Number of objects appended to the buffer.
+				\note Neither the query nor a reused buffer allocate, once they grew to the size of the largest query.
+			*/
+			const size_t getKNearest(const double& x, const double& y, const double& z, const unsigned int& k, const IdSet<T>& ignoreIDs, NeighborArray<T>& results, OctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes are within the given distance of the query-point.
+				Only nodes that intersect the query-sphere are visited.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] radius Maximal distance of an object's bounding box to the query-point.
+				\param[out] results Buffer the ids are appended to, each id at most once and in ascending order.
+				\returns Number of ids appended to the buffer.
+				\note The buffer is not cleared, i.e. it may be reused for many queries to avoid allocations.
+			*/
+			const size_t queryRadius(const double& x, const double& y, const double& z, const double& radius, std::vector<T>& results) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes overlap the given axis aligned box.
+				Only nodes that intersect the query-box are visited.
+				\param[in] lowerBound Coordinates of the query-box's lower bound in real vector space.
+				\param[in] upperBound Coordinates of the query-box's upper bound in real vector space.
+				\param[out] results Buffer the ids are appended to, each id at most once and in ascending order.
+				\returns Number of ids appended to the buffer.
+				\note The buffer is not cleared, i.e. it may be reused for many queries to avoid allocations.
+			*/
+			const size_t queryBox(const Bounds& lowerBound, const Bounds& upperBound, std::vector<T>& results) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes are hit by the given ray, ordered front to back.
+				Nodes are visited in the order the ray enters their (loose) bounds, nodes entered beyond the maximal distance are not visited.
+				\param[in] origin Coordinates of the ray's origin in real vector space.
+				\param[in] direction Direction of the ray, does not need to be normalized.
+				\param[in] maxDistance Maximal distance along the ray at which bounding boxes are entered.
+				\param[out] results Buffer the ids and the distances at which the ray enters their bounding boxes are appended to,
+				each id at most once and ordered by ascending distance. The distance is 0 for boxes containing the origin.
+				\returns Number of ids appended to the buffer.
+				\note The buffer is not cleared, i.e. it may be reused for many queries to avoid allocations.
+				Throws if the direction has zero length.
+			*/
+			const size_t queryRay(const Bounds& origin, const Bounds& direction, const double& maxDistance, NeighborArray<T>& results);
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes are hit by the given ray, ordered front to back,
+				using the scratch memory of the given query context.
+				\param[in] origin Coordinates of the ray's origin in real vector space.
+				\param[in] direction Direction of the ray, does not need to be normalized.
+				\param[in] maxDistance Maximal distance along the ray at which bounding boxes are entered.
+				\param[out] results Buffer the ids and the distances at which the ray enters their bounding boxes are appended to,
+				each id at most once and ordered by ascending distance. The distance is 0 for boxes containing the origin.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Number of ids appended to the buffer.
+				\note Neither the query nor a reused buffer allocate, once they grew to the size of the largest query.
+				Throws if the direction has zero length.
+			*/
+			const size_t queryRay(const Bounds& origin, const Bounds& direction, const double& maxDistance, NeighborArray<T>& results, OctTreeQuery<T>& query) const;
+
+			/**
+				\brief Pass the objects whose bounding boxes are hit by the given ray to a narrow-phase, ordered front to back,
+				until no object may be hit closer than the nearest hit so far.
+				Nodes and objects share one order by the distance at which the ray enters their (loose) bounds,
+				i.e. the traversal stops as soon as the next node or object is entered beyond the nearest hit.
+				\param[in] origin Coordinates of the ray's origin in real vector space.
+				\param[in] direction Direction of the ray, does not need to be normalized.
+				\param[in] maxDistance Maximal distance along the ray at which bounding boxes are entered.
+				\param[in] ignoreIDs Set of IDs that are not passed to the narrow-phase, sub-trees containing only ignored ids are skipped.
+				\param[in] visitor Narrow-phase called once per object, with the object's id and entry distance.
+				\param[in] query Query context, e.g. one per thread, that is reused across queries.
+				\returns Distance of the nearest hit returned by the narrow-phase, POS_INF if no object was hit.
+				\note Throws if the direction has zero length.
+			*/
+			const double queryRay(const Bounds& origin, const Bounds& direction, const double& maxDistance, const IdSet<T>& ignoreIDs,
+				RayVisitor<T>& visitor, OctTreeQuery<T>& query) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes overlap the given oriented box.
+				Nodes and bounding boxes are tested with the separating axis theorem, i.e. an elongated rotated box
+				only visits the nodes along its own extent instead of all nodes within its axis aligned bounding box.
+				\param[in] box Oriented query-box.
+				\param[out] results Buffer the ids are appended to, each id at most once and in ascending order.
+				\returns Number of ids appended to the buffer.
+				\note The buffer is not cleared, i.e. it may be reused for many queries to avoid allocations.
+			*/
+			const size_t queryOBB(const OrientedBox& box, std::vector<T>& results) const;
+
+			/**
+				\brief Get the ids of all objects whose bounding boxes overlap the convex polytope bounded by the given planes, e.g. a view frustum.
+				A node or bounding box is rejected if it lies completely outside one of the planes. The test is conservative,
+				i.e. boxes close to an edge or corner of the polytope may be reported although they do not overlap it.
+				\param[in] planes Planes bounding the polytope, with normals pointing outwards.
+				\param[out] results Buffer the ids are appended to, each id at most once and in ascending order.
+				\returns Number of ids appended to the buffer.
+				\note The buffer is not cleared, i.e. it may be reused for many queries to avoid allocations.
+			*/
+			const size_t queryPolytope(const std::vector<Plane>& planes, std::vector<T>& results) const;
+
+			/**
+				\brief Get all pairs of objects of this and another tree whose bounding boxes are within the given distance of each other.
+				Both trees are traversed simultaneously, i.e. pairs of nodes whose (loose) bounds are farther apart than the margin are pruned
+				together with their sub-trees, and only objects of the remaining node pairs are compared.
+				\param[in] other Tree whose objects are paired with the objects of this tree.
+				\param[in] margin Maximal distance of two bounding boxes, 0 for touching or overlapping boxes only.
+				\param[out] results Buffer the pairs are appended to, the first id of each pair belongs to this tree,
+				each pair at most once and in ascending order.
+				\returns Number of pairs appended to the buffer.
+				\note The buffer is not cleared, i.e. it may be reused for many queries to avoid allocations.
+			*/
+			const size_t queryOverlaps(const OctTree<T>& other, const double& margin, std::vector<std::pair<T, T>>& results) const;
+
+			/**
+				\brief Check if this tree is a loose OctTree.
+				\returns True if the looseness of this tree is greater than 1.0.
+			*/
+			const bool isLoose() const;
+
 			/**
 				\brief Get all nodes of this tree.
 				\returns Array of this tree's nodes.
 			*/
 			const NodeArray<T>& getNodes() const;
 
+			/**
+				\brief Get the allocation statistics of this tree's node arena.
+				\returns Number of allocated nodes, slabs and reserved bytes.
+			*/
+			const AllocationStats& getAllocationStats() const;
+
+			/**
+				\brief Collect statistics about the shape and memory usage of this tree,
+				i.e. node, leaf and id counts, the depth and occupancy histograms and the number of resizes.
+				\returns Statistics of this tree's current state.
+				\note Walks all nodes and objects of the tree, i.e. this is meant for tuning and not for hot paths.
+			*/
+			virtual const TreeStats getStats() const;
+
+			/**
+				\brief Get the bounds of this tree's nodes, e.g. to render the tree.
+				\param[out] bounds Buffer the lower and upper bounds of the nodes are appended to.
+				\param[in] includeEmpty If false, nodes that do not contain any ids are skipped.
+				\returns Number of bounds appended to the buffer.
+			*/
+			virtual const size_t getNodeBounds(std::vector<std::pair<Bounds, Bounds>>& bounds, const bool includeEmpty) const;
+
+			/**
+				\brief Append a snapshot of this tree to a buffer, i.e. a versioned binary layout of its nodes, ids and objects,
+				which only contains indices and offsets instead of pointers. A snapshot is opened without deserialization by MappedOctTree.
+				\param[out] buffer Buffer the snapshot is appended to, it is padded to a multiple of eight bytes first.
+				\returns Offset of the snapshot in the buffer.
+			*/
+			const size_t writeSnapshot(std::vector<char>& buffer) const;
+
+			/**
+				\brief Write a snapshot of this tree to a file, which may be memory mapped as MappedOctTree afterwards.
+				\param[in] path Path of the written file, an existing file is overwritten.
+				\note Throws if the file cannot be written.
+			*/
+			void save(const std::string& path) const;
+
+			/**
+				\brief Freeze the current state of this tree into an immutable snapshot in memory.
+				The frozen tree answers queries from plain indices, i.e. without locks and without touching the reference counts
+				of nodes, hence any number of threads may query it concurrently while this tree is modified or rebuilt.
+				\returns Read-only tree holding the snapshot, which does not change when this tree changes.
+			*/
+			MappedTreePtr<T> freeze() const;
+
 		private:
 
-			/* Array of this tree's nodes. */
-			NodeArray<T> nodes;
+			/* Block allocator all of this tree's nodes are constructed in. */
+			ArenaPtr<T> arena;
+
+			/* Array of this tree's nodes, rebuilt lazily after nodes were pruned. */
+			mutable NodeArray<T> nodes;
+
+			/* Flag if the node array has to be rebuilt, since nodes were pruned. */
+			mutable bool nodesOutdated;
+
+			/* Leaves occupied by each object of this tree, mapped to the object's id. */
+			std::unordered_map<T, NodeArray<T>> objectNodes;
+
+			/* Lower and upper bounds of each object of this tree, required to push objects down when a leaf is split. */
+			std::unordered_map<T, std::pair<Bounds, Bounds>> objectBounds;
 
 			/* This tree's root-node. */
 			NodePtr<T> root;
@@ -136,31 +556,55 @@ namespace collision {
 			/* Minimal symmetric diameter of this tree's leaf-nodes. */
 			Bounds minDiameter;
 
+			/* Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree. */
+			double looseness;
+
+			/* Number of ids a leaf may contain before it is split, 0 if leaves are always split down to the minimal diameter. */
+			unsigned int leafCapacity;
+
+			/* Sibling leaves are merged into their parent once they contain less than this number of distinct ids. */
+			unsigned int mergeThreshold;
+
+			/* Maximal depth of this tree's leaves. */
+			unsigned int maxDepth;
+
+			/* Number of threads used to bulk-load objects, 1 for a serial build. */
+			unsigned int buildThreads;
+
+			/* Query context used by queries that are not given a context of their own. */
+			QueryPtr<T> defaultQuery;
+
 			/* Flag if this tree is allowed to expand itself to accomodate 
 				for new objects outside of the inital root sub-space. */
 			bool allowResize;
 
+			/* Number of times the root was replaced, i.e. by growing, shrinking or compacting this tree. */
+			size_t resizeCount;
+
 			/**
 				\brief Construct a new OctTree-object.
 				\param[in] lower Initial lower spatial bounds of this tree's root.
 				\param[in] upper Initial upper spatial bounds of this tree's root.
 				\param[in] minDiameter Minimal allowed symmetric width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
 			*/
-			OctTree(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter);
+			OctTree(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter, const double& looseness);
 
 			/**
 				\brief Construct a new OctTree-object.
 				\param[in] diameter Initial symmetric spatial bounds of this tree's root.
 				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
 			*/
-			OctTree(const Bounds& diameter, const Bounds& minDiameter);
+			OctTree(const Bounds& diameter, const Bounds& minDiameter, const double& looseness);
 
 			/**
 				\brief Construct a new OctTree-object.
 				\param[in] treeDiameter Initial symmetric allowed width/heigth/length of this tree's root.
 				\param[in] minDiameter Minimal symmetric allowed width/heigth/length of a leaf-node (i.e. resolution).
+				\param[in] looseness Factor by which node bounds are enlarged for insertion, 1.0 for a regular OctTree and values greater than 1.0 (usually 2.0) for a loose OctTree.
 			*/
-			OctTree(const double& treeDiameter, const double& minCellDiameter);
+			OctTree(const double& treeDiameter, const double& minCellDiameter, const double& looseness);
 
 			/**
 				\brief Create a new child-node that covers a sub-octant of its parent-node.
@@ -172,20 +616,120 @@ namespace collision {
 			void makeNewOctant(NodePtr<T> parent, const Bounds& lowerBound, const Bounds& upperBound, const Octant& octant);
 
 			/**
-				\brief Resize this tree to the new given root-bounds
-				\param[in] lower Lower spatial bounds of the new tree.
-				\param[in] upper Upper spatial bounds of the new tree.
+				\brief Build the branch below a node from leaf entries sorted by their Morton codes, as part of a bulk-load.
+				Only touches the given node and its descendants, hence branches of distinct nodes may be built concurrently.
+				\param[in] branch Node the branch starts at.
+				\param[in] branchDepth Depth of the given node, where root has a depth of zero.
+				\param[in] leafDepth Depth of the leaves, the Morton codes are calculated for.
+				\param[in] entries Morton codes of leaves paired with the ids they receive, sorted by Morton code.
+				\param[in] first Index of the first entry that belongs to this branch.
+				\param[in] last Index behind the last entry that belongs to this branch.
+				\param[in] nodeArena Arena the new nodes of this branch are constructed in.
+				\param[out] leaves Leaves occupied by each inserted object, mapped to the object's id.
+				\note New nodes are not added to the node array, which has to be marked as outdated.
+			*/
+			void buildBranch(NodePtr<T> branch, const unsigned int& branchDepth, const unsigned int& leafDepth, const std::vector<std::pair<std::uint64_t, T>>& entries,
+				const size_t& first, const size_t& last, ArenaPtr<T> nodeArena, std::unordered_map<T, NodeArray<T>>& leaves);
+
+			/**
+				\brief Collect the pairs of one object and all objects in the sub-tree of a node, whose bounding boxes are within the given distance,
+				as part of a dual-tree traversal.
+				\param[in] id unique identifier of the object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\param[in] node Node of the given tree, whose sub-tree is searched.
+				\param[in] tree Tree the node belongs to.
+				\param[in] margin Maximal distance of two bounding boxes.
+				\param[in] swapped True if the object belongs to the other tree of the traversal, i.e. its id is the second id of each pair.
+				\param[out] results Buffer the pairs are appended to.
+			*/
+			void collectOverlaps(const T& id, const Bounds& lowerBound, const Bounds& upperBound, const OctTreeNode<T>* node, const OctTree<T>& tree,
+				const double& margin, const bool swapped, std::vector<std::pair<T, T>>& results) const;
+
+			/**
+				\brief Mark the nodes of all ignored ids and their ancestors in the given query context,
+				so that nodes and whole sub-trees containing only ignored ids are skipped without any lookups in the ignore set.
+				\param[in] ignoreIDs Set of IDs that should be ignored by the current query.
+				\param[in] query Query context of the current query.
+			*/
+			void markIgnoredIds(const IdSet<T>& ignoreIDs, OctTreeQuery<T>& query) const;
+
+			/**
+				\brief Grow this tree towards the given bounds until its root contains them.
+				\param[in] lowerBound Lower spatial bounds that should fit into the tree.
+				\param[in] upperBound Upper spatial bounds that should fit into the tree.
 			*/
 			void resize(const Bounds& lowerBound, const Bounds& upperBound);
 
+			/**
+				\brief Replace the root by its only child, as long as the root does not contain any ids itself.
+			*/
+			void shrink();
+
 			/**
 				\brief Recursively insert a new object with its unique identifier and bounding box into this tree.
 				\param[in] node Callee responsible for this recursion layer.
 				\param[in] id unique identifier of the inserted object.
 				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
 				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\param[in] depth Depth of the callee, where root has a depth of zero.
+			*/
+			bool insertObject(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound, const unsigned int& depth);
+
+			/**
+				\brief Split the bounding box of an object up into the involved child-octants of a node and recursively insert the parts.
+				\param[in] node Node whose children receive the object.
+				\param[in] id unique identifier of the inserted object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\param[in] depth Depth of the given node, where root has a depth of zero.
+			*/
+			void insertIntoChildren(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound, const unsigned int& depth);
+
+			/**
+				\brief Remember the bounding box of an object, inserting an object twice extends its bounding box.
+				\param[in] id unique identifier of the inserted object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+			*/
+			void storeObjectBounds(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+				\brief Calculate the depth at which nodes reach the recursion anchor, i.e. the minimal diameter or the maximal depth.
+				\returns Leaf depth, where root has a depth of zero.
+			*/
+			const unsigned int calcLeafDepth() const;
+
+			/**
+				\brief Insert a new object into the deepest node below the given node, whose loose bounds contain the object's bounding box.
+				\param[in] node Node at which the descent starts.
+				\param[in] id unique identifier of the inserted object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\param[in] depth Depth of the given node, where root has a depth of zero.
+				\param[in] forceDescent If true, the object is not kept in the given node due to its leaf capacity.
+			*/
+			void insertLooseObject(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound, const unsigned int& depth, const bool forceDescent);
+
+			/**
+				\brief Split a full leaf, i.e. push all of its ids down into (new) child-nodes.
+				\param[in] node Leaf that should be split.
+				\param[in] depth Depth of the given leaf, where root has a depth of zero.
+			*/
+			void split(NodePtr<T> node, const unsigned int& depth);
+
+			/**
+				\brief Merge sibling leaves into their parent, as long as they contain less ids than the merge threshold.
+				\param[in] node Node at which merging starts, leaves start at their parent.
+			*/
+			void collapse(NodePtr<T> node);
+
+			/**
+				\brief Remove the given node and all of its ancestors, as long as they are empty leaves (root is never removed).
+				\param[in] node Node at which pruning starts.
+				\returns First node that was not removed.
 			*/
-			bool insertObject(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+			NodePtr<T> prune(NodePtr<T> node);
 		};
 	}
 }
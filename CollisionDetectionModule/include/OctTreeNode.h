@@ -1,8 +1,12 @@
 #pragma once
 #include <vector>
+#include <array>
 #include <memory>
+#include <cstddef>
+#include <cmath>
 #include <unordered_set>
 #include "..\include\Bounds.h"
+#include "..\include\IdStorage.h"
 
 namespace collision {
 	namespace octtree {
@@ -22,6 +26,44 @@ namespace collision {
 		/* Maximum number of resize iterations an OctTree is allowed to undergo. */
 		static const unsigned int MAX_RESIZE_STEPS = 10;
 
+		/* Default maximum depth of an OctTree's leaves, where root has a depth of zero. */
+		static const unsigned int MAX_TREE_DEPTH = 32;
+
+#ifdef OCTTREE_FLOAT_BOUNDS
+		/* Scalar type of node geometry, define OCTTREE_FLOAT_BOUNDS to store node bounds in single precision. */
+		typedef float NodeScalar;
+#else
+		/* Scalar type of node geometry, define OCTTREE_FLOAT_BOUNDS to store node bounds in single precision. */
+		typedef double NodeScalar;
+#endif
+
+		/**
+		\brief Helper class to store the lower or upper bounds of a node in the precision of NodeScalar.
+		Bounds are converted from and to double, i.e. all calculations with node bounds are still done in double.
+		*/
+		class NodeBounds {
+		public:
+
+			/* Karthesian coordinates of the lower or upper bound.*/
+			NodeScalar x, y, z;
+
+			/**
+			\brief Default-Constructor
+			*/
+			NodeBounds() {};
+
+			/**
+			\brief Construct a NodeBounds-object from bounds in double precision.
+			\param[in] bounds Lower or upper bounds of a node.
+			*/
+			NodeBounds(const Bounds& bounds) : x(static_cast<NodeScalar>(bounds.x)), y(static_cast<NodeScalar>(bounds.y)), z(static_cast<NodeScalar>(bounds.z)) {};
+
+			/**
+			\brief Convert these bounds back to double precision.
+			*/
+			operator Bounds() const { return Bounds(x, y, z); };
+		};
+
 		namespace octant {
 
 			/**
@@ -41,13 +83,22 @@ namespace collision {
 		template <typename T>
 		class OctTreeNode;
 
+		// Forward declaration to deal with circular dependencies.
+		template <typename T>
+		class NodeArena;
+
+		// Forward declaration to deal with circular dependencies.
+		template <typename T>
+		class OctTree;
+
 		// Aliases for used namespaces
 		template <typename T>
 		using NodePtr = shared_ptr<OctTreeNode<T>>;
 		template <typename T>
 		using WeakNodePtr = weak_ptr<OctTreeNode<T>>;
 		template <typename T>
-		using Octants = std::vector<WeakNodePtr<T>>;
+		using Octants = std::array<OctTreeNode<T>*, 8>;
+		using ChildDistances = std::array<double, 8>;
 		template <typename T>
 		using IdSet = std::unordered_set<T>;
 
@@ -55,7 +106,8 @@ namespace collision {
 		\brief Objects of this class are used to represent nodes in an OctTree
 		and therefore carry information (e.g. IDs) about shapes/bodies/entities that may reside
 		inside the subspace a node governs over.
-		Nodes know their center's coordinates, octant, boundaries, parent- and child-nodes.
+		Nodes know their boundaries, parent- and child-nodes, the center's coordinates and the diameter are derived from the boundaries.
+		Links to parent- and child-nodes are non-owning, i.e. all nodes of a tree have to be kept alive by the tree (see NodeArena).
 		*/
 		template <typename T>
 		class OctTreeNode {
@@ -106,6 +158,19 @@ namespace collision {
 			*/
 			NodePtr<T> getChild(const Octant& octant);
 
+			/**
+			\brief Unlink the given child node from this node.
+			\param[in] child Smart pointer to a child of this node.
+			\note This node becomes a leaf, if the removed child was its last child.
+			*/
+			void removeChild(const NodePtr<T>& child);
+
+			/**
+			\brief Get the parent node of this node.
+			\returns Parent node or nullptr if this node is root.
+			*/
+			NodePtr<T> getParent();
+
 			/**
 			\brief Set the parent node of this node.
 			\param[in] parent Smart pointer to a node that will become the parent of this node.
@@ -123,31 +188,31 @@ namespace collision {
 			\brief Get the x-coordinate of this nodes origin.
 			\returns x-coordinate
 			*/
-			const double& getX() const;
+			const double getX() const;
 
 			/**
 			\brief Get the y-coordinate of this nodes origin.
 			\returns y-coordinate
 			*/
-			const double& getY() const;
+			const double getY() const;
 
 			/**
 			\brief Get the z-coordinate of this nodes origin.
 			\returns z-coordinate
 			*/
-			const double& getZ() const;
+			const double getZ() const;
 
 			/**
 			\brief Get the lower spatial boundaries of this node.
 			\returns Coordinates of the lower bound in real vector space.
 			*/
-			const Bounds& getLowerBounds() const;
+			const Bounds getLowerBounds() const;
 
 			/**
 			\brief Get the upper spatial boundaries of this node.
 			\returns Coordinates of the upper bound in real vector space.
 			*/
-			const Bounds& getUpperBounds() const;
+			const Bounds getUpperBounds() const;
 
 			/**
 			\brief Get the diameter of upper an lower bounds.
@@ -245,16 +310,66 @@ namespace collision {
 			const double calcMinDistance(const double& x, const double& y, const double& z) const;
 
 			/**
-			\brief Add unique identifiers of shapes/bodies/entities that may reside in this node.
+			\brief Calculate the minimum distance of a given query-point to this node's enlarged (loose) bounding-box.
+			\param[in] x X-Coordinate of the given query-point
+			\param[in] y Y-Coordinate of the given query-point
+			\param[in] z Z-Coordinate of the given query-point
+			\param[in] looseness Factor by which this node's width/height/length are enlarged, 1.0 for the regular bounds.
+			\returns Distance of the query-point to the loose BBox surface, 0 if inside the loose BBbox.
+			*/
+			const double calcMinDistance(const double& x, const double& y, const double& z, const double& looseness) const;
+
+			/**
+			\brief Calculate the minimum distances of a given query-point to the (loose) bounding-boxes of all child-nodes at once.
+			Children split this node at its center, hence their bounds are derived from this node's bounds without touching the children.
+			\param[in] x X-Coordinate of the given query-point
+			\param[in] y Y-Coordinate of the given query-point
+			\param[in] z Z-Coordinate of the given query-point
+			\param[in] looseness Factor by which the children's width/height/length are enlarged, 1.0 for the regular bounds.
+			\param[out] distances Distances indexed by octant, equal to calcMinDistance of each child, undefined for null octants.
+			\note A child that was the root before the tree grew keeps its own bounds, which may differ from the derived bounds by rounding.
+			*/
+			void calcChildDistances(const double& x, const double& y, const double& z, const double& looseness, ChildDistances& distances) const;
+
+			/**
+			\brief Add unique identifiers of shapes/bodies/entities that may reside in this node, together with their bounding spheres.
+			If the id is already part of this node, only its bounding sphere is replaced.
+			\param[in] id unique identifier of an entity
+			\param[in] lowerBound Lower bounds of the entity's bounding-box.
+			\param[in] upperBound Upper bounds of the entity's bounding-box.
+			*/
+			void addId(const T& id, const Bounds& lowerBound, const Bounds& upperBound);
+
+			/**
+			\brief Remove the unique identifier of a shape/body/entity from this node.
 			\param[in] id unique identifier of an entity
+			\returns True if the id was found and removed.
 			*/
-			void addId(const T& id);
+			const bool removeId(const T& id);
 
 			/**
 			\brief Get the unique identifiers of shapes/bodies/entities that reside in this node.
-			\returns set of id unique identifiers of entity in this node
+			\returns view on the sorted unique identifiers of entities in this node, valid until ids are added or removed
+			*/
+			const IdSpan<T> getIds() const;
+
+			/**
+			\brief Get the bounding spheres of the shapes/bodies/entities that reside in this node.
+			\returns Pointer to the first sphere, the spheres are aligned with getIds() and valid until ids are added or removed.
 			*/
-			const IdSet<T>& getIds() const;
+			const ObjectSphere* getSpheres() const;
+
+			/**
+			\brief Get the number of ids in this node and all of its descendants, where ids in several nodes are counted once per node.
+			\returns Number of ids in the sub-tree of this node.
+			*/
+			const unsigned int& getSubtreeIdCount() const;
+
+			/**
+			\brief Get the index of this node in its arena, which is unique among all nodes of the arena.
+			\returns Dense index of this node, used to store per-query information about nodes outside of the tree.
+			*/
+			const size_t& getIndex() const;
 
 			/**
 			\brief Packs the node's internal information into a formatted readable string.
@@ -264,7 +379,10 @@ namespace collision {
 		protected:
 
 			/* This nodes parent-node */
-			WeakNodePtr<T> parent;
+			OctTreeNode<T>* parent;
+
+			/* Weak reference to this node, used to hand out smart pointers to linked nodes. */
+			WeakNodePtr<T> self;
 
 			/* This nodes child-nodes, aka. sub-octants. */
 			Octants<T> octants;
@@ -278,23 +396,34 @@ namespace collision {
 			/* Flag if this node is a leaf, i.e. does not have child-nodes. */
 			bool leaf;
 
+			/* Number of ids in this node and all of its descendants, stored next to the flags to fill their padding. */
+			unsigned int subtreeIds;
+
 			/* Lower and upper spatial bounds of this node, aka. bounding-box. */
-			Bounds lower, upper;
+			NodeBounds lower, upper;
 
-			/* Coordinates of this nodes origin/center. */
-			double x, y, z;
+			/* Sorted ids of any shapes/bodies/entities this node contains, together with their bounding spheres. */
+			IdStorage<T> ids;
 
-			/* Diameter of this node's bounds in x, y and z direction, aka. width, height, length. */
-			double width, height, length;
+			/* Dense index of this node in its arena. */
+			size_t index;
 
-			/* Id container of any shapes/bodies/entities this node contains. */
-			IdSet<T> ids;
+			/**
+			\brief Add a change of the number of ids to this node's sub-tree count and to the counts of all its ancestors.
+			\param[in] delta Number of added (positive) or removed (negative) ids.
+			*/
+			void countSubtreeIds(const std::ptrdiff_t& delta);
 
 			/**
 			\brief Default-Constructor
 			*/
 			OctTreeNode();
 
+			// The arena constructs nodes in place and sets their self reference.
+			friend class NodeArena<T>;
+
+			// The tree detaches branches while they are built concurrently and adds their id counts afterwards.
+			friend class OctTree<T>;
 		};
 
 	}
@@ -0,0 +1,122 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "..\include\OctTreeNode.h"
+#include "..\include\OctTree.h"
+
+namespace collision {
+	namespace octtree {
+
+		/**
+			\brief Objects of this class carry the scratch memory of OctTree queries, i.e. the heap of nodes ordered by their distance
+			to the query-point, the per-node marks of ignored ids and the heap of the k nearest objects. Memory is only allocated when a query needs more space than
+			any query before, hence a query context that is reused across many queries does not allocate at all.
+			Each node's distance is calculated exactly once, when the node is pushed onto the heap.
+			\note A query context may be used with any number of trees, but only by one thread at a time,
+			i.e. keep one query context per thread to run queries on the same tree concurrently.
+		*/
+		template <typename T>
+		class OctTreeQuery {
+		public:
+
+			/**
+				\brief Call to instantiate a new OctTreeQuery-object.
+				\returns Returns a smart pointer to the new object on the heap.
+				\note This is the only way to "make" an OctTreeQuery-object, i.e. Constructor is private!
+			*/
+			static QueryPtr<T> create();
+
+			/**
+				\brief Reserve scratch memory for queries on trees with the given number of nodes.
+				\param[in] nodeCount Number of nodes, e.g. the index count of a tree's node arena.
+			*/
+			void reserve(const size_t& nodeCount);
+
+		private:
+
+			/* Heap of nodes paired with their distance to the query-point, the nearest node is on top. */
+			std::vector<std::pair<double, OctTreeNode<T>*>> heap;
+
+			/* Stamp of the current query, marks of nodes with another stamp belong to previous queries. */
+			size_t stamp;
+
+			/* Stamp of the query that marked ignored ids of a node, indexed by node index. */
+			std::vector<size_t> stamps;
+
+			/* Number of ids in a node that are ignored by the current query, indexed by node index. */
+			std::vector<size_t> ignoredIds;
+
+			/* Number of ids in the sub-tree of a node that are ignored by the current query, indexed by node index. */
+			std::vector<size_t> ignoredSubtreeIds;
+
+			/* Max-heap of the k nearest objects found so far by a k-nearest-neighbor query, or min-heap of the objects entered by a ray. */
+			NeighborArray<T> neighbors;
+
+			/* Ids collected by queries whose results are converted afterwards, e.g. into an IdSet,
+				or the sorted ids a ray query already visited. */
+			std::vector<T> ids;
+
+			/**
+				\brief Construct a new OctTreeQuery-object.
+			*/
+			OctTreeQuery();
+
+			/**
+				\brief Start a new query, i.e. empty the heap and discard all marks of previous queries.
+				\param[in] nodeCount Upper bound of the node indices the query may visit.
+			*/
+			void begin(const size_t& nodeCount);
+
+			/**
+				\brief Push a node onto the heap.
+				\param[in] node Node that is pushed.
+				\param[in] distance Distance of the node to the query-point.
+			*/
+			void push(OctTreeNode<T>* node, const double& distance);
+
+			/**
+				\brief Remove the nearest node from the heap.
+				\returns Nearest node paired with its distance to the query-point.
+			*/
+			const std::pair<double, OctTreeNode<T>*> pop();
+
+			/**
+				\brief Get the nearest node of the heap without removing it.
+				\returns Nearest node paired with its distance to the query-point.
+			*/
+			const std::pair<double, OctTreeNode<T>*>& top() const;
+
+			/**
+				\brief Check if the heap is empty.
+				\returns True if no node is left on the heap.
+			*/
+			const bool isEmpty() const;
+
+			/**
+				\brief Mark one id in the sub-tree of a node as ignored.
+				\param[in] index Index of the node.
+				\param[in] own True if the id resides in the node itself, false if it resides in a descendant.
+			*/
+			void markIgnoredId(const size_t& index, const bool own);
+
+			/**
+				\brief Check if a node contains ids that are not ignored by the current query.
+				\param[in] node Node that is checked.
+				\returns True if at least one id of the node is not ignored.
+			*/
+			const bool hasUnignoredIds(const OctTreeNode<T>* node) const;
+
+			/**
+				\brief Check if all ids in the sub-tree of a node are ignored by the current query, i.e. the sub-tree may be skipped.
+				\param[in] node Node that is checked.
+				\returns True if all ids in the sub-tree of the node are ignored.
+			*/
+			const bool isSubtreeIgnored(const OctTreeNode<T>* node) const;
+
+			// Trees run their queries on the scratch memory of this context.
+			friend class OctTree<T>;
+		};
+	}
+}
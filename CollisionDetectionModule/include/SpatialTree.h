@@ -0,0 +1,183 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <unordered_set>
+#include "..\include\Bounds.h"
+
+namespace collision {
+	namespace octtree {
+
+		// Forward declaration to remove unnecessary includes.
+		template <typename T>
+		class SpatialTree;
+
+		// Aliases for used namespaces
+		using std::shared_ptr;
+
+		template <typename T>
+		using SpatialTreePtr = shared_ptr<SpatialTree<T>>;
+		template <typename T>
+		using IdSet = std::unordered_set<T>;
+
+		/**
+			\brief Check the looseness of a tree, i.e. the factor by which node bounds are enlarged.
+			\param[in] looseness Looseness of a tree, 1.0 for a regular OctTree.
+			\note Throws if the looseness is smaller than 1.0, which would shrink nodes below the sub-space they cover.
+		*/
+		inline void validateLooseness(const double& looseness) {
+			if (looseness < 1.0) throw std::runtime_error("Looseness of an OctTree must not be smaller than 1.0.");
+		}
+
+		/**
+			\brief Objects of this class carry statistics about the shape and memory usage of an OctTree or a LinearOctTree,
+			e.g. to compare the impact of different minimal leaf or initial root diameters.
+		*/
+		class TreeStats {
+		public:
+
+			/* Number of nodes, i.e. inner nodes and leaves. */
+			size_t nodeCount;
+
+			/* Number of leaves. */
+			size_t leafCount;
+
+			/* Number of nodes (inner nodes and leaves) that do not contain any ids. */
+			size_t emptyNodeCount;
+
+			/* Fraction of nodes that do not contain any ids, 0 for a tree without nodes. */
+			double emptyNodeFraction;
+
+			/* Number of nodes at each depth, where root has a depth of zero. */
+			std::vector<size_t> nodesPerDepth;
+
+			/* Number of leaves with each number of ids, i.e. entry i counts the leaves that contain i ids. */
+			std::vector<size_t> leavesPerIdCount;
+
+			/* Number of distinct objects in the tree. */
+			size_t objectCount;
+
+			/* Number of ids stored in all nodes, i.e. objects spanning several leaves are counted once per leaf. */
+			size_t idEntryCount;
+
+			/* Number of id entries divided by the number of distinct objects, 0 for an empty tree. */
+			double duplicationFactor;
+
+			/* Number of times the root was replaced, i.e. by growing, shrinking or compacting the tree. */
+			size_t resizeCount;
+
+			/* Bytes reserved for nodes by the tree's arena. */
+			size_t nodeBytes;
+
+			/* Bytes of id and sphere buffers that spilled from nodes to the heap. */
+			size_t idBytes;
+
+			/* Approximate bytes used to map objects to their leaves and bounding boxes. */
+			size_t objectBytes;
+
+			/* Sum of node, id and object bytes. */
+			size_t totalBytes;
+
+			/**
+				\brief Default-Constructor
+			*/
+			TreeStats() : nodeCount(0), leafCount(0), emptyNodeCount(0), emptyNodeFraction(0.0), objectCount(0), idEntryCount(0), duplicationFactor(0.0),
+				resizeCount(0), nodeBytes(0), idBytes(0), objectBytes(0), totalBytes(0) {};
+		};
+
+		/**
+			\brief Objects of this class are the common interface of the pointer-based OctTree and the pointer-free LinearOctTree,
+			i.e. everything a collision detector needs to keep a tree in sync with its cluster and to find collision candidates.
+			Both tree types may be used interchangeably through this interface.
+		*/
+		template <typename T>
+		class SpatialTree {
+		public:
+
+			/**
+				\brief Destructor
+			*/
+			virtual ~SpatialTree() {};
+
+			/**
+				\brief Set the resize allowed flag for this tree.
+				\param[in] resizeOn If true, this tree is allowed to expand itself to accomodate
+				for new objects outside of the inital root sub-space.
+			*/
+			virtual void setAllowResize(const bool resizeOn) = 0;
+
+			/**
+				\brief Insert a new object with its unique identifier and bounding box into this tree.
+				\param[in] id unique identifier of the inserted object.
+				\param[in] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's BBox upper bound in real vector space.
+			*/
+			virtual void insertObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound) = 0;
+
+			/**
+				\brief Insert many objects with their unique identifiers and bounding boxes into this tree at once (bulk-load).
+				\param[in] objects Unique identifiers and bounding boxes of the inserted objects.
+			*/
+			virtual void insertObjects(const ObjectArray<T>& objects) = 0;
+
+			/**
+				\brief Remove an object with its unique identifier from all leaves it occupies and prune empty branches.
+				\param[in] id unique identifier of the removed object.
+				\returns True if the object was part of this tree.
+			*/
+			virtual const bool removeObject(const T& id) = 0;
+
+			/**
+				\brief Move an object with its unique identifier to a new bounding box.
+				\param[in] id unique identifier of the updated object.
+				\param[in] lowerBound Coordinates of the object's new BBox lower bound in real vector space.
+				\param[in] upperBound Coordinates of the object's new BBox upper bound in real vector space.
+				\note Objects that are not part of this tree are simply inserted.
+			*/
+			virtual void updateObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound) = 0;
+
+			/**
+				\brief Check if an object with the given unique identifier is part of this tree.
+				\param[in] id unique identifier of the object.
+				\returns True if the object occupies any node of this tree.
+			*/
+			virtual const bool containsObject(const T& id) const = 0;
+
+			/**
+				\brief Get the bounding box an object was inserted with.
+				\param[in] id unique identifier of the object.
+				\param[out] lowerBound Coordinates of the object's BBox lower bound in real vector space.
+				\param[out] upperBound Coordinates of the object's BBox upper bound in real vector space.
+				\returns True if the object is part of this tree, the bounds are not changed otherwise.
+			*/
+			virtual const bool getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const = 0;
+
+			/**
+				\brief Get the ids of all nodes whose bounding boxes share the nearest distance to the query-point,
+				but ignore any nodes that only contain ids that should be ignored.
+				\param[in] x X-Coordinate of the given query-point
+				\param[in] y Y-Coordinate of the given query-point
+				\param[in] z Z-Coordinate of the given query-point
+				\param[in] ignoreIDs Set of IDs that should be ignored while finding the nearest nodes.
+				\returns Union of the ids of the closest nodes without the ignored ids, empty if the tree is empty.
+			*/
+			virtual const IdSet<T> getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) = 0;
+
+			/**
+				\brief Collect statistics about the shape and memory usage of this tree.
+				\returns Statistics of this tree's current state.
+				\note Walks all nodes and objects of the tree, i.e. this is meant for tuning and not for hot paths.
+			*/
+			virtual const TreeStats getStats() const = 0;
+
+			/**
+				\brief Get the bounds of this tree's nodes, e.g. to render the tree.
+				\param[out] bounds Buffer the lower and upper bounds of the nodes are appended to.
+				\param[in] includeEmpty If false, nodes that do not contain any ids are skipped.
+				\returns Number of bounds appended to the buffer.
+			*/
+			virtual const size_t getNodeBounds(std::vector<std::pair<Bounds, Bounds>>& bounds, const bool includeEmpty) const = 0;
+		};
+	}
+}
@@ -2,6 +2,13 @@
 #include "..\include\CollisionDetection.h"
 #include "..\include\OctTree.h"
 #include "..\include\OctTreeNode.h"
+#include "..\include\OctTreeQuery.h"
+#include "..\include\LinearOctTree.h"
+#include "..\include\MappedOctTree.h"
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <limits>
 #include <AgentCluster.h>
 #include <Agent.h>
 #include <Shape.h>
@@ -12,6 +19,7 @@ namespace collision {
 	using simobj::AgentCluster;
 	using simobj::SimObjPtr;
 	using octtree::OctTree;
+	using octtree::LinearOctTree;
 	using octtree::Bounds;
 	using simobj::shapes::BoundingBox;
 	using Eigen::Vector3d;
@@ -26,9 +34,61 @@ namespace collision {
 	using Eigen::ParametrizedLine;
 	using Eigen::Hyperplane;
 
+	/* Magic number at the beginning of every tree file written by CollisionDetection::saveTrees, reads "OCTM" in a little endian file. */
+	static const std::uint32_t TREE_FILE_MAGIC = 0x4D54434F;
+
+	/**
+		\brief Header of a tree file, which is followed by one entry per tree.
+	*/
+	class TreeFileHeader {
+	public:
+
+		/* TREE_FILE_MAGIC and the snapshot version of the file. */
+		std::uint32_t magic, version;
+
+		/* Number of trees in the file. */
+		std::uint64_t treeCount;
+	};
+
+	/**
+		\brief Entry of a tree file, i.e. the cluster id of a tree and the offset of its snapshot in the file.
+	*/
+	class TreeFileEntry {
+	public:
+
+		/* Unique identifier of the tree's cluster. */
+		std::uint32_t clusterId, reserved;
+
+		/* Offset of the tree's snapshot in bytes. */
+		std::uint64_t offset;
+	};
+
 	CollisionDetection::CollisionDetection(const double& initialTreeDiameter, const double& minimalCellDiameter, const bool rescalingOn) :
 	initialTreeDiameter(initialTreeDiameter), minimalCellDiameter(minimalCellDiameter), allowRescaling(rescalingOn) {
 		trees = TreeMap();
+		linearTrees = LinearTreeMap();
+		mappedTrees = MappedTreeMap();
+		mappedQuery = octtree::MappedOctTreeQuery<unsigned int>::create();
+		rayQuery = octtree::OctTreeQuery<unsigned int>::create();
+		mappedCandidates = std::vector<unsigned int>();
+		candidateStats = CandidateStats();
+		syncStates = SyncMap();
+		frozenTrees = new FrozenTreeMap();
+		frozenEpoch = 1;
+		for (size_t i = 0; i < MAX_FROZEN_READERS; i++) readerEpochs[i] = 0;
+		retiredTrees = std::vector<std::pair<unsigned long, const FrozenTreeMap*>>();
+		pendingRebuilds = RebuildMap();
+		useLinearTrees = false;
+		treeLooseness = 1.0;
+		leafCapacity = 0;
+		mergeThreshold = 0;
+		maxTreeDepth = octtree::MAX_TREE_DEPTH;
+		treeBuildThreads = 1;
+	}
+
+	CollisionDetection::~CollisionDetection() {
+		delete frozenTrees.load();
+		for (auto retired : retiredTrees) delete retired.second;
 	}
 
 	void CollisionDetection::setInitialTreeDiameter(const double& initialTreeDiameter) {
@@ -43,49 +103,526 @@ namespace collision {
 		this->allowRescaling = rescalingOn;
 	}
 
+	void CollisionDetection::setUseLinearTrees(const bool linearTreesOn) {
+		this->useLinearTrees = linearTreesOn;
+	}
+
+	void CollisionDetection::setTreeLooseness(const double& looseness) {
+		octtree::validateLooseness(looseness);
+		this->treeLooseness = looseness;
+	}
+
+	void CollisionDetection::setLeafCapacity(const unsigned int& leafCapacity, const unsigned int& mergeThreshold) {
+		if (leafCapacity > 0 && mergeThreshold > leafCapacity) throw std::runtime_error("Merge threshold of an OctTree must not exceed its leaf capacity.");
+		this->leafCapacity = leafCapacity;
+		this->mergeThreshold = mergeThreshold;
+	}
+
+	void CollisionDetection::setMaximalTreeDepth(const unsigned int& maxTreeDepth) {
+		this->maxTreeDepth = maxTreeDepth;
+	}
+
+	void CollisionDetection::setTreeBuildThreads(const unsigned int& treeBuildThreads) {
+		this->treeBuildThreads = treeBuildThreads;
+	}
+
 	const bool CollisionDetection::isClusterInTree(const unsigned int& id) const {
-		return trees.find(id) != trees.end();
+		return trees.find(id) != trees.end() || linearTrees.find(id) != linearTrees.end();
 	}
 
 	void CollisionDetection::makeTreeFromCluster(SimObjPtr cluster) {
 		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
-		TreePtr tree = OctTree<unsigned int>::create(Bounds(initialTreeDiameter, initialTreeDiameter, initialTreeDiameter), Bounds(minimalCellDiameter, minimalCellDiameter, minimalCellDiameter));
+		if (useLinearTrees) {
+			LinearTreePtr tree = LinearOctTree<unsigned int>::create(Bounds(initialTreeDiameter, initialTreeDiameter, initialTreeDiameter), Bounds(minimalCellDiameter, minimalCellDiameter, minimalCellDiameter));
+			tree->setAllowResize(allowRescaling);
+			linearTrees.insert(std::make_pair(clsPtr->getId(), tree));
+			tree->insertObjects(calcAgentObjects(cluster));
+			storeSyncState(cluster);
+			return;
+		}
+		TreePtr tree = OctTree<unsigned int>::create(Bounds(initialTreeDiameter, initialTreeDiameter, initialTreeDiameter), Bounds(minimalCellDiameter, minimalCellDiameter, minimalCellDiameter), treeLooseness);
 		tree->setAllowResize(allowRescaling);
+		tree->setLeafCapacity(leafCapacity, mergeThreshold);
+		tree->setMaxDepth(maxTreeDepth);
+		tree->setBuildThreads(treeBuildThreads);
 		trees.insert(std::make_pair(clsPtr->getId(), tree));
+		// the bulk-load grows the root once for all agents before inserting them, a tight root as built by createFromObjects
+		// would move the leaves of every cluster to its own lattice and change which agents share a leaf
+		tree->insertObjects(calcAgentObjects(cluster));
+		storeSyncState(cluster);
+		if (getFrozenTree(clsPtr->getId()) != nullptr) publishFrozenTree(clsPtr->getId(), trees.at(clsPtr->getId())->freeze());
+	}
+
+	void CollisionDetection::addAgentToTree(SimObjPtr agent) {
+		shared_ptr<Agent> agtPtr = std::static_pointer_cast<Agent>(agent);
+		if(!isClusterInTree(agtPtr->getAgentCluster()->getId())) throw std::runtime_error("Given agent cannot be inserted into an OctTree because its Cluster is not registerd with the collision detector or does not exist.");
+		Bounds lb, ub;
+		calcAgentBounds(agent, lb, ub);
+		getTree(agtPtr->getAgentCluster()->getId())->insertObject(agtPtr->getId(), lb, ub);
+	}
+
+	const bool CollisionDetection::removeAgentFromTree(SimObjPtr agent) {
+		shared_ptr<Agent> agtPtr = std::static_pointer_cast<Agent>(agent);
+		if (!isClusterInTree(agtPtr->getAgentCluster()->getId())) throw std::runtime_error("Given agent cannot be removed from an OctTree because its Cluster is not registerd with the collision detector or does not exist.");
+		return getTree(agtPtr->getAgentCluster()->getId())->removeObject(agtPtr->getId());
+	}
+
+	void CollisionDetection::updateAgentInTree(SimObjPtr agent) {
+		shared_ptr<Agent> agtPtr = std::static_pointer_cast<Agent>(agent);
+		if (!isClusterInTree(agtPtr->getAgentCluster()->getId())) throw std::runtime_error("Given agent cannot be updated in an OctTree because its Cluster is not registerd with the collision detector or does not exist.");
+		Bounds lb, ub;
+		calcAgentBounds(agent, lb, ub);
+		getTree(agtPtr->getAgentCluster()->getId())->updateObject(agtPtr->getId(), lb, ub);
+	}
+
+	const size_t CollisionDetection::sync(const unsigned int& clusterId) {
+		auto state = syncStates.find(clusterId);
+		if (!isClusterInTree(clusterId) || state == syncStates.end()) throw std::runtime_error("Given cluster cannot be synchronized with its OctTree because it is not registerd with the collision detector.");
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(state->second.cluster.lock());
+		if (clsPtr == nullptr) throw std::runtime_error("Given cluster cannot be synchronized with its OctTree because it does not exist anymore.");
+		SpatialTreePtr tree = getTree(clusterId);
+		std::unordered_map<unsigned int, unsigned long>& agentVersions = state->second.agentVersions;
+		bool clusterChanged = clsPtr->getVersion() != state->second.clusterVersion;
+		state->second.clusterVersion = clsPtr->getVersion();
+		size_t synced = 0;
 		for (auto agent : clsPtr->getAllAgents()) {
-			shared_ptr<Agent> agtPtr = std::static_pointer_cast<Agent>(agent.second);
-			const BoundingBox& bbx = agtPtr->getShape()->getBoundingBox();
-			const Vector3d& position = agtPtr->getPosition(ReferenceFrame::Global);
-			double halfMaxDim = std::max(bbx.width, std::max(bbx.height, bbx.length)) / 2.0;
-			Bounds lb(position.x() - halfMaxDim, position.y() - halfMaxDim, position.z() - halfMaxDim);
-			Bounds ub(position.x() + halfMaxDim, position.y() + halfMaxDim, position.z() + halfMaxDim);
-			tree->insertObject(agtPtr->getId(), lb, ub);
+			auto version = agentVersions.find(agent.second->getId());
+			if (version == agentVersions.end()) {
+				agentVersions[agent.second->getId()] = agent.second->getVersion();
+				addAgentToTree(agent.second);
+				synced++;
+				continue;
+			}
+			if (!clusterChanged && version->second == agent.second->getVersion()) continue;
+			version->second = agent.second->getVersion();
+			Bounds lb, ub, oldLb, oldUb;
+			calcAgentBounds(agent.second, lb, ub);
+			tree->getObjectBounds(agent.second->getId(), oldLb, oldUb);
+			if (lb.x == oldLb.x && lb.y == oldLb.y && lb.z == oldLb.z && ub.x == oldUb.x && ub.y == oldUb.y && ub.z == oldUb.z) continue;
+			tree->updateObject(agent.second->getId(), lb, ub);
+			synced++;
+		}
+		// agents that left the cluster are still remembered
+		if (agentVersions.size() > clsPtr->getAllAgents().size()) {
+			for (auto version = agentVersions.begin(); version != agentVersions.end();) {
+				if (clsPtr->isAgentInCluster(version->first)) {
+					version++;
+					continue;
+				}
+				tree->removeObject(version->first);
+				version = agentVersions.erase(version);
+				synced++;
+			}
 		}
+		if (synced > 0 && trees.find(clusterId) != trees.end() && getFrozenTree(clusterId) != nullptr) publishFrozenTree(clusterId, trees.at(clusterId)->freeze());
+		return synced;
 	}
 
-	void CollisionDetection::addAgentToTree(SimObjPtr agent) {
+	MappedTreePtr CollisionDetection::freezeTree(const unsigned int& clusterId) {
+		if (trees.find(clusterId) == trees.end()) throw std::runtime_error("Given cluster cannot be frozen because it has no OctTree.");
+		MappedTreePtr tree = trees.at(clusterId)->freeze();
+		publishFrozenTree(clusterId, tree);
+		return tree;
+	}
+
+	MappedTreePtr CollisionDetection::getFrozenTree(const unsigned int& clusterId) const {
+		unsigned long version = 0;
+		return getFrozenTree(clusterId, version);
+	}
+
+	MappedTreePtr CollisionDetection::getFrozenTree(const unsigned int& clusterId, unsigned long& version) const {
+		PinnedFrozenTrees published = getFrozenTrees();
+		auto tree = published->find(clusterId);
+		version = (tree != published->end()) ? tree->second.version : 0;
+		return (tree != published->end()) ? tree->second.tree : nullptr;
+	}
+
+	const unsigned long CollisionDetection::getTreeVersion(const unsigned int& clusterId) const {
+		unsigned long version = 0;
+		getFrozenTree(clusterId, version);
+		return version;
+	}
+
+	void CollisionDetection::rebuildTreeAsync(const unsigned int& clusterId) {
+		auto state = syncStates.find(clusterId);
+		if (trees.find(clusterId) == trees.end() || state == syncStates.end()) throw std::runtime_error("Given cluster cannot be rebuilt because it has no OctTree.");
+		if (pendingRebuilds.find(clusterId) != pendingRebuilds.end()) throw std::runtime_error("Given cluster is already being rebuilt.");
+		SimObjPtr cluster = state->second.cluster.lock();
+		if (cluster == nullptr) throw std::runtime_error("Given cluster cannot be rebuilt because it does not exist anymore.");
+		// queries of other threads use the previous tree until the new one is published
+		if (getFrozenTree(clusterId) == nullptr) freezeTree(clusterId);
+		// agents are only read here, the worker just inserts their bounds
+		shared_ptr<PendingRebuild> rebuild = std::make_shared<PendingRebuild>();
+		rebuild->done = false;
+		rebuild->tree = OctTree<unsigned int>::create(Bounds(initialTreeDiameter, initialTreeDiameter, initialTreeDiameter), Bounds(minimalCellDiameter, minimalCellDiameter, minimalCellDiameter), treeLooseness);
+		rebuild->tree->setAllowResize(allowRescaling);
+		rebuild->tree->setLeafCapacity(leafCapacity, mergeThreshold);
+		rebuild->tree->setMaxDepth(maxTreeDepth);
+		rebuild->tree->setBuildThreads(treeBuildThreads);
+		octtree::ObjectArray<unsigned int> objects = calcAgentObjects(cluster);
+		// the previous tree keeps its versions, the new tree is synchronized with the agents that change during the rebuild
+		SyncState previous = state->second;
+		storeSyncState(cluster);
+		rebuild->state = syncStates.at(clusterId);
+		syncStates.at(clusterId) = previous;
+		PendingRebuild* pending = rebuild.get();
+		rebuild->worker = std::thread([pending, objects]() {
+			try {
+				pending->tree->insertObjects(objects);
+			}
+			catch (...) {
+				pending->error = std::current_exception();
+			}
+			pending->done = true;
+		});
+		pendingRebuilds.insert(std::make_pair(clusterId, rebuild));
+	}
+
+	const size_t CollisionDetection::completeRebuilds(const bool wait) {
+		size_t completed = 0;
+		for (auto rebuild = pendingRebuilds.begin(); rebuild != pendingRebuilds.end();) {
+			if (!wait && !rebuild->second->done) {
+				rebuild++;
+				continue;
+			}
+			rebuild->second->worker.join();
+			unsigned int clusterId = rebuild->first;
+			shared_ptr<PendingRebuild> finished = rebuild->second;
+			rebuild = pendingRebuilds.erase(rebuild);
+			if (finished->error != nullptr) std::rethrow_exception(finished->error);
+			trees[clusterId] = finished->tree;
+			syncStates[clusterId] = finished->state;
+			// the new tree is only published once it caught up with the agents, sync publishes it if any agent changed
+			if (sync(clusterId) == 0) publishFrozenTree(clusterId, finished->tree->freeze());
+			completed++;
+		}
+		return completed;
+	}
+
+	PendingRebuild::~PendingRebuild() {
+		if (worker.joinable()) worker.join();
+	}
+
+	PinnedFrozenTrees CollisionDetection::getFrozenTrees() const {
+		// the epoch is announced before the map is loaded, i.e. a map retired after the announced epoch is not deleted,
+		// and a map loaded after a publisher missed the announcement is never the retired one
+		for (size_t i = 0;; i++) {
+			if (i == MAX_FROZEN_READERS) {
+				std::this_thread::yield();
+				i = 0;
+			}
+			unsigned long free = 0;
+			if (readerEpochs[i].compare_exchange_strong(free, frozenEpoch.load())) return PinnedFrozenTrees(&readerEpochs[i], frozenTrees.load());
+		}
+	}
+
+	const unsigned long CollisionDetection::publishFrozenTree(const unsigned int& clusterId, MappedTreePtr tree) {
+		const FrozenTreeMap* published = frozenTrees.load();
+		FrozenTreeMap* updated = new FrozenTreeMap(*published);
+		FrozenTree frozen;
+		frozen.tree = tree;
+		auto previous = updated->find(clusterId);
+		frozen.version = (previous != updated->end()) ? previous->second.version + 1 : 1;
+		(*updated)[clusterId] = frozen;
+		frozenTrees.store(updated);
+		// readers announcing the new epoch load the updated map
+		retiredTrees.push_back(std::make_pair(++frozenEpoch, published));
+		reclaimFrozenTrees();
+		return frozen.version;
+	}
+
+	void CollisionDetection::reclaimFrozenTrees() {
+		unsigned long oldest = std::numeric_limits<unsigned long>::max();
+		for (size_t i = 0; i < MAX_FROZEN_READERS; i++) {
+			unsigned long epoch = readerEpochs[i].load();
+			if (epoch != 0) oldest = std::min(oldest, epoch);
+		}
+		auto reclaimable = std::partition(retiredTrees.begin(), retiredTrees.end(),
+			[oldest](const std::pair<unsigned long, const FrozenTreeMap*>& retired) { return retired.first > oldest; });
+		for (auto retired = reclaimable; retired != retiredTrees.end(); retired++) delete retired->second;
+		retiredTrees.erase(reclaimable, retiredTrees.end());
+	}
+
+	PinnedFrozenTrees::PinnedFrozenTrees(PinnedFrozenTrees&& other) : slot(other.slot), map(other.map) {
+		other.slot = nullptr;
+		other.map = nullptr;
+	}
+
+	PinnedFrozenTrees::~PinnedFrozenTrees() {
+		if (slot != nullptr) slot->store(0);
+	}
+
+	void CollisionDetection::storeSyncState(SimObjPtr cluster) {
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
+		SyncState state;
+		state.cluster = cluster;
+		state.clusterVersion = clsPtr->getVersion();
+		state.agentVersions.reserve(clsPtr->getAllAgents().size());
+		for (auto agent : clsPtr->getAllAgents()) {
+			state.agentVersions[agent.second->getId()] = agent.second->getVersion();
+		}
+		syncStates[clsPtr->getId()] = state;
+	}
+
+	const octtree::ObjectArray<unsigned int> CollisionDetection::calcAgentObjects(SimObjPtr cluster) const {
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
+		octtree::ObjectArray<unsigned int> objects;
+		objects.reserve(clsPtr->getAllAgents().size());
+		for (auto agent : clsPtr->getAllAgents()) {
+			Bounds lb, ub;
+			calcAgentBounds(agent.second, lb, ub);
+			objects.push_back(octtree::ObjectEntry<unsigned int>(agent.second->getId(), lb, ub));
+		}
+		return objects;
+	}
+
+	void CollisionDetection::calcAgentBounds(SimObjPtr agent, Bounds& lowerBound, Bounds& upperBound) const {
 		shared_ptr<Agent> agtPtr = std::static_pointer_cast<Agent>(agent);
-		if(trees.find(agtPtr->getAgentCluster()->getId()) == trees.end()) throw std::runtime_error("Given agent cannot be inserted into an OctTree because its Cluster is not registerd with the collision detector or does not exist.");
-		TreePtr tree = trees[(agtPtr->getAgentCluster()->getId())];
 		const BoundingBox& bbx = agtPtr->getShape()->getBoundingBox();
 		const Vector3d& position = agtPtr->getPosition(ReferenceFrame::Global);
 		double halfMaxDim = std::max(bbx.width, std::max(bbx.height, bbx.length)) / 2.0;
-		Bounds lb(position.x() - halfMaxDim, position.y() - halfMaxDim, position.z() - halfMaxDim);
-		Bounds ub(position.x() + halfMaxDim, position.y() + halfMaxDim, position.z() + halfMaxDim);
-		tree->insertObject(agtPtr->getId(), lb, ub);
+		Vector3d half = Vector3d::Constant(halfMaxDim);
+		// spheres fit the cube in any orientation, other shapes get the axis aligned box around their rotated
+		// bounding-box, which is at least the cube of the largest dimension the trees were tuned with
+		if (agtPtr->getShape()->getType() != ShapeType::Sphere) {
+			Eigen::Matrix3d rotation = agtPtr->getOrientation(ReferenceFrame::Global).toRotationMatrix();
+			half = half.cwiseMax(rotation.cwiseAbs() * Vector3d(bbx.width / 2.0, bbx.height / 2.0, bbx.length / 2.0));
+		}
+		lowerBound = Bounds(position.x() - half.x(), position.y() - half.y(), position.z() - half.z());
+		upperBound = Bounds(position.x() + half.x(), position.y() + half.y(), position.z() + half.z());
 	}
 
-	TreePtr CollisionDetection::getTree(const unsigned int& id) {
+	SpatialTreePtr CollisionDetection::getTree(const unsigned int& id) {
+		if (linearTrees.find(id) != linearTrees.end()) return linearTrees.at(id);
+		if (trees.find(id) == trees.end()) throw std::runtime_error("Given cluster has no tree, i.e. it was not added to the collision detector.");
 		return trees.at(id);
 	}
 
+	TreePtr CollisionDetection::getOctTree(const unsigned int& id) {
+		if (trees.find(id) == trees.end()) throw std::runtime_error("Given cluster has no OctTree, i.e. it was not added to the collision detector or has a linear OctTree.");
+		return trees.at(id);
+	}
+
+	LinearTreePtr CollisionDetection::getLinearTree(const unsigned int& id) {
+		if (linearTrees.find(id) == linearTrees.end()) throw std::runtime_error("Given cluster has no linear OctTree, i.e. it was not added to the collision detector or has an OctTree.");
+		return linearTrees.at(id);
+	}
+
+	MappedTreePtr CollisionDetection::getMappedTree(const unsigned int& id) {
+		if (mappedTrees.find(id) == mappedTrees.end()) throw std::runtime_error("Given cluster has no loaded tree, i.e. no tree of the cluster was loaded from a file.");
+		return mappedTrees.at(id);
+	}
+
+	void CollisionDetection::saveTrees(const std::string& path) const {
+		std::vector<std::pair<unsigned int, TreePtr>> sorted(trees.begin(), trees.end());
+		std::sort(sorted.begin(), sorted.end(), [](const std::pair<unsigned int, TreePtr>& lhs, const std::pair<unsigned int, TreePtr>& rhs) { return lhs.first < rhs.first; });
+		// the header is followed by a table of cluster ids and snapshot offsets and the snapshots themselves
+		size_t tableSize = sizeof(TreeFileHeader) + sorted.size() * sizeof(TreeFileEntry);
+		std::vector<char> buffer(tableSize, 0);
+		TreeFileHeader header;
+		std::memset(&header, 0, sizeof(TreeFileHeader));
+		header.magic = TREE_FILE_MAGIC;
+		header.version = octtree::SNAPSHOT_VERSION;
+		header.treeCount = sorted.size();
+		std::memcpy(buffer.data(), &header, sizeof(TreeFileHeader));
+		for (size_t i = 0; i < sorted.size(); i++) {
+			TreeFileEntry entry;
+			std::memset(&entry, 0, sizeof(TreeFileEntry));
+			entry.clusterId = sorted[i].first;
+			entry.offset = sorted[i].second->writeSnapshot(buffer);
+			std::memcpy(buffer.data() + sizeof(TreeFileHeader) + i * sizeof(TreeFileEntry), &entry, sizeof(TreeFileEntry));
+		}
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Tree file " + path + " could not be opened for writing.");
+		file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		if (!file) throw std::runtime_error("Tree file " + path + " could not be written.");
+	}
+
+	void CollisionDetection::loadTrees(const std::string& path) {
+		octtree::SnapshotPtr file = octtree::SnapshotFile::create(path);
+		if (file->getSize() < sizeof(TreeFileHeader)) throw std::runtime_error("Given file is not a tree file.");
+		const TreeFileHeader* header = reinterpret_cast<const TreeFileHeader*>(file->getData());
+		if (header->magic != TREE_FILE_MAGIC) throw std::runtime_error("Given file is not a tree file.");
+		if (header->version != octtree::SNAPSHOT_VERSION) throw std::runtime_error("Given tree file has an unsupported version.");
+		if (header->treeCount > (file->getSize() - sizeof(TreeFileHeader)) / sizeof(TreeFileEntry)) throw std::runtime_error("Given tree file is truncated or corrupted.");
+		const TreeFileEntry* entries = reinterpret_cast<const TreeFileEntry*>(file->getData() + sizeof(TreeFileHeader));
+		MappedTreeMap loaded;
+		for (size_t i = 0; i < header->treeCount; i++) {
+			loaded.insert(std::make_pair(entries[i].clusterId, MappedOctTree<unsigned int>::create(file, static_cast<size_t>(entries[i].offset))));
+		}
+		mappedTrees = loaded;
+	}
+
 	const bool CollisionDetection::checkForCollision(SimObjPtr cluster, const IDSet& ignoreIDs, SimObjPtr candidate, SimObjPtr& nearest, double& nearestDistance) {
 		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
 		shared_ptr<Agent> candidatePtr = std::static_pointer_cast<Agent>(candidate);
-		TreePtr tree = trees.at(clsPtr->getId());
 		const Vector3d& position = candidatePtr->getPosition(ReferenceFrame::Global);
+		if (linearTrees.find(clsPtr->getId()) != linearTrees.end()) {
+			IdSet<unsigned int> candidates = getTree(clsPtr->getId())->getNearestIds(position.x(), position.y(), position.z(), ignoreIDs);
+			return checkCandidates(cluster, ignoreIDs, candidate, candidates, nearest, nearestDistance);
+		}
+		if (trees.find(clsPtr->getId()) == trees.end() && mappedTrees.find(clsPtr->getId()) != mappedTrees.end()) {
+			MappedTreePtr tree = mappedTrees.at(clsPtr->getId());
+			if (tree->isLoose()) {
+				mappedCandidates.clear();
+				tree->getNearestIds(position.x(), position.y(), position.z(), ignoreIDs, mappedCandidates, *mappedQuery);
+				return checkCandidates(cluster, ignoreIDs, candidate, mappedCandidates, nearest, nearestDistance);
+			}
+			return checkCandidates(cluster, ignoreIDs, candidate, tree->getNearest(position.x(), position.y(), position.z(), ignoreIDs, *mappedQuery), nearest, nearestDistance);
+		}
+		TreePtr tree = trees.at(clsPtr->getId());
+		if (tree->isLoose()) {
+			IdSet<unsigned int> candidates = tree->getNearestIds(position.x(), position.y(), position.z(), ignoreIDs);
+			return checkCandidates(cluster, ignoreIDs, candidate, candidates, nearest, nearestDistance);
+		}
 		NodePtr<unsigned int> octant = tree->getNearest(position.x(), position.y(), position.z(), ignoreIDs);
-		IdSet<unsigned int> candidates = octant->getIds();
+		return checkCandidates(cluster, ignoreIDs, candidate, octant->getIds(), nearest, nearestDistance, octant->getSpheres());
+	}
+
+	const bool CollisionDetection::checkClusterCollision(SimObjPtr clusterA, SimObjPtr clusterB, SimObjPtr& nearestA, SimObjPtr& nearestB, double& nearestDistance, const double& margin) {
+		shared_ptr<AgentCluster> clsPtrA = std::static_pointer_cast<AgentCluster>(clusterA);
+		shared_ptr<AgentCluster> clsPtrB = std::static_pointer_cast<AgentCluster>(clusterB);
+		if (trees.find(clsPtrA->getId()) == trees.end() || trees.find(clsPtrB->getId()) == trees.end()) throw std::runtime_error("Given clusters cannot be checked for collisions because at least one of them has no OctTree.");
+		nearestA = nullptr;
+		nearestB = nullptr;
+		nearestDistance = octtree::POS_INF;
+		std::vector<std::pair<unsigned int, unsigned int>> candidates;
+		trees.at(clsPtrA->getId())->queryOverlaps(*trees.at(clsPtrB->getId()), margin, candidates);
+		for (auto& candidate : candidates) {
+			SimObjPtr agentA = clsPtrA->getAgent(candidate.first);
+			SimObjPtr agentB = clsPtrB->getAgent(candidate.second);
+			double tempDistance = calcBodyToBodyDistance(agentA, agentB);
+			if (tempDistance < nearestDistance) {
+				nearestDistance = tempDistance;
+				nearestA = agentA;
+				nearestB = agentB;
+			}
+			if (tempDistance < 0) return true;
+		}
+		return false;
+	}
+
+	const bool CollisionDetection::raycast(SimObjPtr cluster, const IDSet& ignoreIDs, const Bounds& origin, const Bounds& direction, const double& maxDistance,
+		SimObjPtr& hit, double& hitDistance) {
+		return raycast(cluster, ignoreIDs, origin, direction, maxDistance, *rayQuery, hit, hitDistance);
+	}
+
+	const bool CollisionDetection::raycast(SimObjPtr cluster, const IDSet& ignoreIDs, const Bounds& origin, const Bounds& direction, const double& maxDistance,
+		octtree::OctTreeQuery<unsigned int>& query, SimObjPtr& hit, double& hitDistance) const {
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
+		if (trees.find(clsPtr->getId()) == trees.end()) throw std::runtime_error("Given cluster cannot be ray-casted because it has no OctTree.");
+		return castRay(cluster, *trees.at(clsPtr->getId()), ignoreIDs, origin, direction, maxDistance, query, hit, hitDistance);
+	}
+
+	const size_t CollisionDetection::raycast(SimObjPtr cluster, const IDSet& ignoreIDs, const std::vector<Bounds>& origins, const std::vector<Bounds>& directions,
+		const double& maxDistance, std::vector<SimObjPtr>& hits, std::vector<double>& hitDistances) {
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
+		if (trees.find(clsPtr->getId()) == trees.end()) throw std::runtime_error("Given cluster cannot be ray-casted because it has no OctTree.");
+		if (origins.size() != directions.size()) throw std::runtime_error("Number of ray origins and directions must be equal.");
+		const OctTree<unsigned int>& tree = *trees.at(clsPtr->getId());
+		hits.assign(origins.size(), nullptr);
+		hitDistances.assign(origins.size(), octtree::POS_INF);
+		size_t hitCount = 0;
+		for (size_t i = 0; i < origins.size(); i++) {
+			if (castRay(cluster, tree, ignoreIDs, origins[i], directions[i], maxDistance, *rayQuery, hits[i], hitDistances[i])) hitCount++;
+		}
+		return hitCount;
+	}
+
+	/**
+		\brief Narrow-phase of ray casts, which hits the agents of a cluster in their global pose and remembers the nearest hit.
+	*/
+	class CollisionDetection::AgentRayVisitor : public octtree::RayVisitor<unsigned int> {
+	public:
+
+		/* Agent hit first by the ray, nullptr if no agent is hit. */
+		SimObjPtr hit;
+
+		/* Distance along the ray to the first hit, POS_INF if no agent is hit. */
+		double hitDistance;
+
+		/**
+			\brief Constructor
+			\param[in] detector Collision detector calculating the distances along the ray.
+			\param[in] cluster Cluster the agents belong to.
+			\param[in] origin Coordinates of the ray's origin in real vector space.
+			\param[in] direction Normalized direction of the ray.
+			\param[in] maxDistance Maximal distance along the ray at which agents are hit.
+		*/
+		AgentRayVisitor(const CollisionDetection& detector, shared_ptr<AgentCluster> cluster, const Bounds& origin, const Bounds& direction, const double& maxDistance)
+			: hit(nullptr), hitDistance(octtree::POS_INF), detector(detector), cluster(cluster), origin(origin), direction(direction), maxDistance(maxDistance) {};
+
+		/**
+			\brief Hit-test an agent whose bounding box is entered by the ray.
+			\param[in] id Unique identifier of the agent.
+			\param[in] distance Distance along the ray at which its bounding box is entered.
+			\returns Distance along the ray at which the agent is hit, POS_INF if it is missed or hit beyond the maximal distance.
+		*/
+		virtual const double visit(const unsigned int& id, const double& distance) {
+			SimObjPtr agent = cluster->getAgent(id);
+			double tempDistance = detector.calcRayToBodyDistance(origin, direction, agent);
+			if (tempDistance > maxDistance) return octtree::POS_INF;
+			if (tempDistance < hitDistance) {
+				hitDistance = tempDistance;
+				hit = agent;
+			}
+			return tempDistance;
+		}
+
+	private:
+
+		/* Collision detector calculating the distances along the ray. */
+		const CollisionDetection& detector;
+
+		/* Cluster the agents belong to. */
+		shared_ptr<AgentCluster> cluster;
+
+		/* Origin and normalized direction of the ray. */
+		Bounds origin, direction;
+
+		/* Maximal distance along the ray at which agents are hit. */
+		double maxDistance;
+	};
+
+	const bool CollisionDetection::castRay(SimObjPtr cluster, const OctTree<unsigned int>& tree, const IDSet& ignoreIDs, const Bounds& origin, const Bounds& direction,
+		const double& maxDistance, octtree::OctTreeQuery<unsigned int>& query, SimObjPtr& hit, double& hitDistance) const {
+		double length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		if (length == 0.0) throw std::runtime_error("Ray direction must not have zero length.");
+		AgentRayVisitor visitor(*this, std::static_pointer_cast<AgentCluster>(cluster), origin, Bounds(direction.x / length, direction.y / length, direction.z / length), maxDistance);
+		tree.queryRay(origin, direction, maxDistance, ignoreIDs, visitor, query);
+		hit = visitor.hit;
+		hitDistance = visitor.hitDistance;
+		return hit != nullptr;
+	}
+
+	const size_t CollisionDetection::getOverlapCandidates(SimObjPtr cluster, SimObjPtr candidate, std::vector<unsigned int>& ids, const double& margin) {
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
+		shared_ptr<Agent> candidatePtr = std::static_pointer_cast<Agent>(candidate);
+		if (trees.find(clsPtr->getId()) == trees.end()) throw std::runtime_error("Given cluster cannot be queried because it has no OctTree.");
+		const BoundingBox& bbx = candidatePtr->getShape()->getBoundingBox();
+		const Vector3d& position = candidatePtr->getPosition(ReferenceFrame::Global);
+		Eigen::Matrix3d rotation = candidatePtr->getOrientation(ReferenceFrame::Global).toRotationMatrix();
+		octtree::OrientedBox box(Bounds(position.x(), position.y(), position.z()),
+			Bounds(bbx.width / 2.0 + margin, bbx.height / 2.0 + margin, bbx.length / 2.0 + margin),
+			Bounds(rotation(0, 0), rotation(1, 0), rotation(2, 0)),
+			Bounds(rotation(0, 1), rotation(1, 1), rotation(2, 1)),
+			Bounds(rotation(0, 2), rotation(1, 2), rotation(2, 2)));
+		return trees.at(clsPtr->getId())->queryOBB(box, ids);
+	}
+
+	const CandidateStats& CollisionDetection::getCandidateStats() const {
+		return candidateStats;
+	}
+
+	void CollisionDetection::resetCandidateStats() {
+		candidateStats = CandidateStats();
+	}
+
+	template <typename IdContainer>
+	const bool CollisionDetection::checkCandidates(SimObjPtr cluster, const IDSet& ignoreIDs, SimObjPtr candidate, const IdContainer& candidates, SimObjPtr& nearest, double& nearestDistance,
+		const octtree::ObjectSphere* spheres) {
+		shared_ptr<AgentCluster> clsPtr = std::static_pointer_cast<AgentCluster>(cluster);
+		shared_ptr<Agent> candidatePtr = std::static_pointer_cast<Agent>(candidate);
 		nearest = nullptr;
 		nearestDistance = octtree::POS_INF;
 		bool collision = false;
@@ -93,9 +630,23 @@ namespace collision {
 		if (candidates.size() == 0) {
 			return collision;
 		}
+		// the query agent's sphere is built like the spheres of the tree, i.e. from half the diagonal of its shape's bounding-box,
+		// which encloses the shape in any orientation
+		const Vector3d& position = candidatePtr->getPosition(ReferenceFrame::Global);
+		const BoundingBox& bbx = candidatePtr->getShape()->getBoundingBox();
+		double radius = octtree::ObjectSphere::calcRadius(bbx.width, bbx.height, bbx.length);
+		size_t index = 0;
 		for (auto id : candidates) {
+			const octtree::ObjectSphere* sphere = (spheres != nullptr) ? spheres + index++ : nullptr;
+			if (ignoreIDs.find(id) != ignoreIDs.end()) continue;
+			candidateStats.candidateCount++;
+			// the spheres' distance is a lower bound of the agents' distance, so farther candidates cannot become the nearest one
+			if (sphere != nullptr && sphere->calcMinDistance(position.x(), position.y(), position.z(), radius) > nearestDistance) {
+				candidateStats.rejectedCount++;
+				continue;
+			}
+			candidateStats.lookupCount++;
 			shared_ptr<Agent> candidatePtr2 = std::static_pointer_cast<Agent>(clsPtr->getAgent(id));
-			if (ignoreIDs.find(candidatePtr2->getId()) != ignoreIDs.end()) continue;
 			double tempDistance = calcBodyToBodyDistance(candidatePtr, candidatePtr2);
 			if (tempDistance < 0) {
 				collision = true;
@@ -137,6 +688,80 @@ namespace collision {
 		}
 	}
 
+	/**
+		\brief Calculate the distance at which a ray hits the unit sphere around the origin.
+		\param[in] origin Origin of the ray.
+		\param[in] direction Direction of the ray, its length is the unit of the returned distance.
+		\returns Distance along the ray to the hit, 0 if the origin lies inside the sphere and POS_INF if the sphere is missed.
+	*/
+	static double calcRayToUnitSphereDistance(const Vector3d& origin, const Vector3d& direction) {
+		double a = direction.squaredNorm();
+		double b = 2.0 * origin.dot(direction);
+		double c = origin.squaredNorm() - 1.0;
+		if (c <= 0.0) return 0.0;
+		double discriminant = b * b - 4.0 * a * c;
+		if (discriminant < 0.0) return octtree::POS_INF;
+		// the origin is outside, i.e. both intersections are either in front of or behind it
+		double t = (-b - std::sqrt(discriminant)) / (2.0 * a);
+		return (t >= 0.0) ? t : octtree::POS_INF;
+	}
+
+	/**
+		\brief Calculate the distance at which a ray hits a capped cylinder centered at the origin, whose axis is the z-axis.
+		\param[in] origin Origin of the ray.
+		\param[in] direction Normalized direction of the ray.
+		\param[in] radius Radius of the cylinder.
+		\param[in] halfLength Half of the length of the cylinder.
+		\returns Distance along the ray to the hit, 0 if the origin lies inside the cylinder and POS_INF if the cylinder is missed.
+	*/
+	static double calcRayToCylinderDistance(const Vector3d& origin, const Vector3d& direction, const double& radius, const double& halfLength) {
+		double radius2 = radius * radius;
+		if (origin.x() * origin.x() + origin.y() * origin.y() <= radius2 && std::fabs(origin.z()) <= halfLength) return 0.0;
+		double distance = octtree::POS_INF;
+		// mantle
+		double a = direction.x() * direction.x() + direction.y() * direction.y();
+		double b = 2.0 * (origin.x() * direction.x() + origin.y() * direction.y());
+		double c = origin.x() * origin.x() + origin.y() * origin.y() - radius2;
+		double discriminant = b * b - 4.0 * a * c;
+		if (a > 0.0 && discriminant >= 0.0) {
+			double t = (-b - std::sqrt(discriminant)) / (2.0 * a);
+			if (t >= 0.0 && std::fabs(origin.z() + t * direction.z()) <= halfLength) distance = t;
+		}
+		// caps
+		if (direction.z() != 0.0) {
+			for (double cap : { -halfLength, halfLength }) {
+				double t = (cap - origin.z()) / direction.z();
+				if (t < 0.0 || t >= distance) continue;
+				Vector3d point = origin + t * direction;
+				if (point.x() * point.x() + point.y() * point.y() <= radius2) distance = t;
+			}
+		}
+		return distance;
+	}
+
+	const double CollisionDetection::calcRayToBodyDistance(const Bounds& origin, const Bounds& direction, SimObjPtr body) const {
+		shared_ptr<Agent> bodyPtr = std::static_pointer_cast<Agent>(body);
+		ShapePtr shape = bodyPtr->getShape();
+		// the ray is transformed into the agent's local frame
+		Eigen::Matrix3d toLocal = bodyPtr->getOrientation(ReferenceFrame::Global).toRotationMatrix().transpose();
+		Vector3d localOrigin = toLocal * (Vector3d(origin.x, origin.y, origin.z) - bodyPtr->getPosition(ReferenceFrame::Global));
+		Vector3d localDirection = toLocal * Vector3d(direction.x, direction.y, direction.z);
+		if (shape->getType() == ShapeType::Sphere) {
+			double radius = std::static_pointer_cast<Sphere>(shape)->getRadius();
+			return calcRayToUnitSphereDistance(localOrigin / radius, localDirection / radius);
+		}
+		else if (shape->getType() == ShapeType::Cylinder) {
+			shared_ptr<Cylinder> cylinder = std::static_pointer_cast<Cylinder>(shape);
+			return calcRayToCylinderDistance(localOrigin, localDirection, cylinder->getRadius(), cylinder->getLength() / 2.0);
+		}
+		else {
+			// scaling by the radii maps the ellipsoid onto the unit sphere and keeps distances along the ray
+			shared_ptr<Ellipsoid> ellipsoid = std::static_pointer_cast<Ellipsoid>(shape);
+			Vector3d scale(1.0 / ellipsoid->getRadiusX(), 1.0 / ellipsoid->getRadiusY(), 1.0 / ellipsoid->getRadiusZ());
+			return calcRayToUnitSphereDistance(localOrigin.cwiseProduct(scale), localDirection.cwiseProduct(scale));
+		}
+	}
+
 	const double CollisionDetection::calcSphereToSphereDistance(SimObjPtr sphere1, SimObjPtr sphere2) const {
 		double distance = octtree::POS_INF;
 		shared_ptr<Agent> agnt1 = std::static_pointer_cast<Agent>(sphere1);
@@ -337,4 +962,4 @@ namespace collision {
 		
 		return distance;
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "..\include\IdStorage.h"
+#include <algorithm>
+
+namespace collision {
+	namespace octtree {
+
+		template <typename T>
+		const T* IdSpan<T>::begin() const {
+			return first;
+		}
+
+		template <typename T>
+		const T* IdSpan<T>::end() const {
+			return last;
+		}
+
+		template <typename T>
+		const size_t IdSpan<T>::size() const {
+			return static_cast<size_t>(last - first);
+		}
+
+		template <typename T>
+		const bool IdSpan<T>::empty() const {
+			return first == last;
+		}
+
+		template <typename T>
+		const T* IdSpan<T>::find(const T& id) const {
+			const T* found = std::lower_bound(first, last, id);
+			return (found != last && *found == id) ? found : last;
+		}
+
+		template <typename T>
+		const bool IdSpan<T>::operator==(const IdSpan<T>& other) const {
+			return size() == other.size() && std::equal(first, last, other.first);
+		}
+
+		template <typename T>
+		const bool IdSpan<T>::operator!=(const IdSpan<T>& other) const {
+			return !(*this == other);
+		}
+
+		template <typename T>
+		IdSpan<T>::operator std::unordered_set<T>() const {
+			return std::unordered_set<T>(first, last);
+		}
+
+		template <typename T>
+		IdStorage<T>::IdStorage() {
+			count = 0;
+			capacity = INLINE_ID_COUNT;
+			spheres = nullptr;
+		}
+
+		template <typename T>
+		IdStorage<T>::IdStorage(const IdStorage<T>& other) {
+			count = 0;
+			capacity = INLINE_ID_COUNT;
+			spheres = nullptr;
+			*this = other;
+		}
+
+		template <typename T>
+		IdStorage<T>::IdStorage(IdStorage<T>&& other) {
+			count = 0;
+			capacity = INLINE_ID_COUNT;
+			spheres = nullptr;
+			*this = std::move(other);
+		}
+
+		template <typename T>
+		IdStorage<T>& IdStorage<T>::operator=(const IdStorage<T>& other) {
+			if (this == &other) return *this;
+			count = 0;
+			if (other.count > capacity) grow(other.capacity);
+			else if (other.count > 0 && spheres == nullptr) grow(capacity);
+			std::copy(other.data(), other.data() + other.count, data());
+			if (other.count > 0) std::copy(other.spheres, other.spheres + other.count, spheres);
+			count = other.count;
+			return *this;
+		}
+
+		template <typename T>
+		IdStorage<T>& IdStorage<T>::operator=(IdStorage<T>&& other) {
+			if (this == &other) return *this;
+			release();
+			if (other.capacity > INLINE_ID_COUNT) heapIds = other.heapIds;
+			else std::copy(other.inlineIds, other.inlineIds + other.count, inlineIds);
+			spheres = other.spheres;
+			capacity = other.capacity;
+			count = other.count;
+			other.spheres = nullptr;
+			other.capacity = INLINE_ID_COUNT;
+			other.count = 0;
+			return *this;
+		}
+
+		template <typename T>
+		IdStorage<T>::~IdStorage() {
+			release();
+		}
+
+		template <typename T>
+		const bool IdStorage<T>::insert(const T& id, const ObjectSphere& sphere) {
+			// the spheres are allocated with the first id, the buffers grow once they are full
+			if (spheres == nullptr) grow(capacity);
+			if (count == capacity) grow(2 * capacity);
+			T* ids = data();
+			T* position = std::lower_bound(ids, ids + count, id);
+			size_t offset = static_cast<size_t>(position - ids);
+			if (position != ids + count && *position == id) {
+				spheres[offset] = sphere;
+				return false;
+			}
+			std::copy_backward(ids + offset, ids + count, ids + count + 1);
+			std::copy_backward(spheres + offset, spheres + count, spheres + count + 1);
+			ids[offset] = id;
+			spheres[offset] = sphere;
+			count++;
+			return true;
+		}
+
+		template <typename T>
+		const bool IdStorage<T>::erase(const T& id) {
+			T* ids = data();
+			T* position = std::lower_bound(ids, ids + count, id);
+			if (position == ids + count || *position != id) return false;
+			size_t offset = static_cast<size_t>(position - ids);
+			std::copy(position + 1, ids + count, position);
+			std::copy(spheres + offset + 1, spheres + count, spheres + offset);
+			count--;
+			return true;
+		}
+
+		template <typename T>
+		void IdStorage<T>::clear() {
+			count = 0;
+		}
+
+		template <typename T>
+		const size_t IdStorage<T>::size() const {
+			return count;
+		}
+
+		template <typename T>
+		const size_t IdStorage<T>::getHeapBytes() const {
+			size_t idBytes = (capacity > INLINE_ID_COUNT) ? capacity * sizeof(T) : 0;
+			return (spheres != nullptr) ? idBytes + capacity * sizeof(ObjectSphere) : idBytes;
+		}
+
+		template <typename T>
+		const IdSpan<T> IdStorage<T>::getSpan() const {
+			return IdSpan<T>(data(), data() + count);
+		}
+
+		template <typename T>
+		const ObjectSphere* IdStorage<T>::getSpheres() const {
+			return spheres;
+		}
+
+		template <typename T>
+		T* IdStorage<T>::data() {
+			return (capacity > INLINE_ID_COUNT) ? heapIds : inlineIds;
+		}
+
+		template <typename T>
+		const T* IdStorage<T>::data() const {
+			return (capacity > INLINE_ID_COUNT) ? heapIds : inlineIds;
+		}
+
+		template <typename T>
+		void IdStorage<T>::grow(const unsigned int& grownCapacity) {
+			if (grownCapacity > capacity) {
+				T* grownIds = new T[grownCapacity];
+				std::copy(data(), data() + count, grownIds);
+				if (capacity > INLINE_ID_COUNT) delete[] heapIds;
+				heapIds = grownIds;
+			}
+			ObjectSphere* grownSpheres = new ObjectSphere[grownCapacity];
+			if (spheres != nullptr) std::copy(spheres, spheres + count, grownSpheres);
+			delete[] spheres;
+			spheres = grownSpheres;
+			capacity = grownCapacity;
+		}
+
+		template <typename T>
+		void IdStorage<T>::release() {
+			if (capacity > INLINE_ID_COUNT) delete[] heapIds;
+			delete[] spheres;
+			spheres = nullptr;
+			capacity = INLINE_ID_COUNT;
+		}
+
+		template class IdSpan<unsigned int>;
+		template class IdSpan<double>;
+		template class IdStorage<unsigned int>;
+		template class IdStorage<double>;
+	}
+}
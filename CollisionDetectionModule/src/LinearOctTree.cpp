@@ -0,0 +1,409 @@
+#include "..\include\LinearOctTree.h"
+#include "..\include\OctTreeNode.h"
+#include <queue>
+#include <cmath>
+#include <algorithm>
+
+namespace collision {
+	namespace octtree {
+
+		/**
+			\brief Spread the lower 21 bits of the given value, such that two zero bits lie between every bit.
+			\param[in] value Integer cell coordinate.
+			\returns Spread bits, ready to be interleaved into a Morton key.
+		*/
+		static std::uint64_t spreadBits(const std::uint32_t& value) {
+			std::uint64_t v = value & 0x1fffff;
+			v = (v | (v << 32)) & 0x1f00000000ffffULL;
+			v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+			v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+			v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+			v = (v | (v << 2)) & 0x1249249249249249ULL;
+			return v;
+		}
+
+		/**
+			\brief Inverse of spreadBits, i.e. collect every third bit of the given value.
+			\param[in] value Interleaved Morton code shifted to the axis of interest.
+			\returns Integer cell coordinate.
+		*/
+		static std::uint32_t compactBits(const std::uint64_t& value) {
+			std::uint64_t v = value & 0x1249249249249249ULL;
+			v = (v | (v >> 2)) & 0x10c30c30c30c30c3ULL;
+			v = (v | (v >> 4)) & 0x100f00f00f00f00fULL;
+			v = (v | (v >> 8)) & 0x1f0000ff0000ffULL;
+			v = (v | (v >> 16)) & 0x1f00000000ffffULL;
+			v = (v | (v >> 32)) & 0x1fffff;
+			return static_cast<std::uint32_t>(v);
+		}
+
+		template <typename T>
+		LinearOctTree<T>::LinearOctTree(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter) {
+			this->minDiameter = minDiameter;
+			objects = unordered_map<T, LinearObject>();
+			allowResize = false;
+			resizeCount = 0;
+			reset(lower, upper);
+		}
+
+		template <typename T>
+		LinearTreePtr<T> LinearOctTree<T>::create(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter) {
+			return LinearTreePtr<T>(new LinearOctTree<T>(lower, upper, minDiameter));
+		}
+
+		template <typename T>
+		LinearTreePtr<T> LinearOctTree<T>::create(const Bounds& diameter, const Bounds& minDiameter) {
+			return LinearTreePtr<T>(new LinearOctTree<T>(Bounds(-diameter.x / 2, -diameter.y / 2, -diameter.z / 2), Bounds(diameter.x / 2, diameter.y / 2, diameter.z / 2), minDiameter));
+		}
+
+		template <typename T>
+		LinearTreePtr<T> LinearOctTree<T>::create(const double& treeDiameter, const double& minCellDiameter) {
+			return LinearTreePtr<T>(new LinearOctTree<T>(Bounds(-treeDiameter / 2, -treeDiameter / 2, -treeDiameter / 2), Bounds(treeDiameter / 2, treeDiameter / 2, treeDiameter / 2), Bounds(minCellDiameter, minCellDiameter, minCellDiameter)));
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::setAllowResize(const bool resizeOn) {
+			this->allowResize = resizeOn;
+		}
+
+		template <typename T>
+		const Bounds& LinearOctTree<T>::getLowerBounds() const {
+			return lower;
+		}
+
+		template <typename T>
+		const Bounds& LinearOctTree<T>::getUpperBounds() const {
+			return upper;
+		}
+
+		template <typename T>
+		const unsigned int& LinearOctTree<T>::getLeafDepth() const {
+			return leafDepth;
+		}
+
+		template <typename T>
+		const size_t LinearOctTree<T>::getNodeCount() const {
+			return nodes.size();
+		}
+
+		template <typename T>
+		const MortonKey LinearOctTree<T>::encodeKey(const std::uint32_t& cx, const std::uint32_t& cy, const std::uint32_t& cz, const unsigned int& depth) {
+			MortonKey code = spreadBits(cx) | (spreadBits(cy) << 1) | (spreadBits(cz) << 2);
+			return (ROOT_KEY << (3 * depth)) | code;
+		}
+
+		template <typename T>
+		const unsigned int LinearOctTree<T>::calcDepthOfKey(const MortonKey& key) {
+			unsigned int depth = 0;
+			MortonKey k = key;
+			while (k > ROOT_KEY) {
+				k >>= 3;
+				depth++;
+			}
+			return depth;
+		}
+
+		template <typename T>
+		const Bounds LinearOctTree<T>::calcLowerBoundsOfKey(const MortonKey& key) const {
+			unsigned int depth = calcDepthOfKey(key);
+			MortonKey code = key ^ (ROOT_KEY << (3 * depth));
+			double scale = std::ldexp(1.0, -static_cast<int>(depth));
+			return Bounds(lower.x + compactBits(code) * (upper.x - lower.x) * scale,
+				lower.y + compactBits(code >> 1) * (upper.y - lower.y) * scale,
+				lower.z + compactBits(code >> 2) * (upper.z - lower.z) * scale);
+		}
+
+		template <typename T>
+		const Bounds LinearOctTree<T>::calcUpperBoundsOfKey(const MortonKey& key) const {
+			unsigned int depth = calcDepthOfKey(key);
+			MortonKey code = key ^ (ROOT_KEY << (3 * depth));
+			double scale = std::ldexp(1.0, -static_cast<int>(depth));
+			return Bounds(lower.x + (compactBits(code) + 1) * (upper.x - lower.x) * scale,
+				lower.y + (compactBits(code >> 1) + 1) * (upper.y - lower.y) * scale,
+				lower.z + (compactBits(code >> 2) + 1) * (upper.z - lower.z) * scale);
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::insertObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			removeObject(id);
+			objects.insert(std::make_pair(id, LinearObject(id, lowerBound, upperBound)));
+			bool inBounds = lowerBound.x >= lower.x && lowerBound.y >= lower.y && lowerBound.z >= lower.z &&
+				upperBound.x <= upper.x && upperBound.y <= upper.y && upperBound.z <= upper.z;
+			if (allowResize && !inBounds) {
+				//resize, which re-inserts every object including the new one
+				resize(lowerBound, upperBound);
+				return;
+			}
+			insertIntoLeaves(id, lowerBound, upperBound);
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::insertObjects(const ObjectArray<T>& objects) {
+			if (objects.empty()) return;
+			Bounds lb = objects.front().lower;
+			Bounds ub = objects.front().upper;
+			for (auto& object : objects) {
+				lb = Bounds(std::min(lb.x, object.lower.x), std::min(lb.y, object.lower.y), std::min(lb.z, object.lower.z));
+				ub = Bounds(std::max(ub.x, object.upper.x), std::max(ub.y, object.upper.y), std::max(ub.z, object.upper.z));
+			}
+			bool inBounds = lb.x >= lower.x && lb.y >= lower.y && lb.z >= lower.z &&
+				ub.x <= upper.x && ub.y <= upper.y && ub.z <= upper.z;
+			if (allowResize && !inBounds) {
+				//resize once for all objects
+				resize(lb, ub);
+			}
+			for (auto& object : objects) {
+				removeObject(object.id);
+				this->objects.insert(std::make_pair(object.id, LinearObject(object.id, object.lower, object.upper)));
+				insertIntoLeaves(object.id, object.lower, object.upper);
+			}
+		}
+
+		template <typename T>
+		const bool LinearOctTree<T>::removeObject(const T& id) {
+			auto entry = objects.find(id);
+			if (entry == objects.end()) return false;
+			removeFromLeaves(id, entry->second.lower, entry->second.upper);
+			objects.erase(entry);
+			return true;
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::updateObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			insertObject(id, lowerBound, upperBound);
+		}
+
+		template <typename T>
+		const IdArray<T>& LinearOctTree<T>::getNearest(const double& x, const double& y, const double& z) const {
+			return getNearest(x, y, z, IdSet<T>());
+		}
+
+		template <typename T>
+		const IdArray<T>& LinearOctTree<T>::getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) const {
+			typedef std::pair<double, MortonKey> QueueEntry;
+			std::priority_queue<QueueEntry, vector<QueueEntry>, std::greater<QueueEntry>> queue;
+			queue.push(QueueEntry(calcMinDistance(ROOT_KEY, x, y, z), ROOT_KEY));
+			while (!queue.empty()) {
+				MortonKey key = queue.top().second;
+				queue.pop();
+				const LinearNode& current = nodes.at(key);
+				if (current.children == 0) {
+					if (ignoreIDs.size() < 1) return current.ids;
+					for (auto id : current.ids) {
+						if (ignoreIDs.find(id) == ignoreIDs.end()) return current.ids;
+					}
+					continue;
+				}
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if (!(current.children & (1 << oct))) continue;
+					MortonKey child = (key << 3) | oct;
+					queue.push(QueueEntry(calcMinDistance(child, x, y, z), child));
+				}
+			}
+			return nodes.at(ROOT_KEY).ids;
+		}
+
+		template <typename T>
+		const bool LinearOctTree<T>::containsObject(const T& id) const {
+			return objects.find(id) != objects.end();
+		}
+
+		template <typename T>
+		const bool LinearOctTree<T>::getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const {
+			auto entry = objects.find(id);
+			if (entry == objects.end()) return false;
+			lowerBound = entry->second.lower;
+			upperBound = entry->second.upper;
+			return true;
+		}
+
+		template <typename T>
+		const IdSet<T> LinearOctTree<T>::getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) {
+			typedef std::pair<double, MortonKey> QueueEntry;
+			std::priority_queue<QueueEntry, vector<QueueEntry>, std::greater<QueueEntry>> queue;
+			IdSet<T> nearestIds;
+			double nearestDistance = POS_INF;
+			queue.push(QueueEntry(calcMinDistance(ROOT_KEY, x, y, z), ROOT_KEY));
+			while (!queue.empty()) {
+				QueueEntry current = queue.top();
+				queue.pop();
+				// children are never closer than their parent, so no closer leaf may follow
+				if (current.first > nearestDistance) break;
+				const LinearNode& node = nodes.at(current.second);
+				if (node.children == 0) {
+					for (auto id : node.ids) {
+						if (ignoreIDs.find(id) != ignoreIDs.end()) continue;
+						nearestIds.insert(id);
+						nearestDistance = current.first;
+					}
+					continue;
+				}
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if (!(node.children & (1 << oct))) continue;
+					MortonKey child = (current.second << 3) | oct;
+					queue.push(QueueEntry(calcMinDistance(child, x, y, z), child));
+				}
+			}
+			return nearestIds;
+		}
+
+		template <typename T>
+		const TreeStats LinearOctTree<T>::getStats() const {
+			TreeStats stats;
+			for (auto& node : nodes) {
+				unsigned int depth = calcDepthOfKey(node.first);
+				size_t idCount = node.second.ids.size();
+				stats.nodeCount++;
+				stats.idEntryCount += idCount;
+				stats.idBytes += node.second.ids.capacity() * sizeof(T);
+				if (idCount == 0) stats.emptyNodeCount++;
+				if (stats.nodesPerDepth.size() <= depth) stats.nodesPerDepth.resize(depth + 1, 0);
+				stats.nodesPerDepth[depth]++;
+				if (node.second.children != 0) continue;
+				stats.leafCount++;
+				if (stats.leavesPerIdCount.size() <= idCount) stats.leavesPerIdCount.resize(idCount + 1, 0);
+				stats.leavesPerIdCount[idCount]++;
+			}
+			stats.emptyNodeFraction = static_cast<double>(stats.emptyNodeCount) / static_cast<double>(stats.nodeCount);
+			stats.objectCount = objects.size();
+			stats.duplicationFactor = (stats.objectCount > 0) ? static_cast<double>(stats.idEntryCount) / static_cast<double>(stats.objectCount) : 0.0;
+			stats.resizeCount = resizeCount;
+			// hash map entries are counted with one pointer for the bucket list, allocator overhead is not included
+			stats.nodeBytes = nodes.bucket_count() * sizeof(void*) + nodes.size() * (sizeof(std::pair<const MortonKey, LinearNode>) + sizeof(void*));
+			stats.objectBytes = objects.bucket_count() * sizeof(void*) + objects.size() * (sizeof(std::pair<const T, LinearObject>) + sizeof(void*));
+			stats.totalBytes = stats.nodeBytes + stats.idBytes + stats.objectBytes;
+			return stats;
+		}
+
+		template <typename T>
+		const size_t LinearOctTree<T>::getNodeBounds(std::vector<std::pair<Bounds, Bounds>>& bounds, const bool includeEmpty) const {
+			size_t first = bounds.size();
+			for (auto& node : nodes) {
+				if (node.second.ids.empty() && !includeEmpty) continue;
+				bounds.push_back(std::make_pair(calcLowerBoundsOfKey(node.first), calcUpperBoundsOfKey(node.first)));
+			}
+			return bounds.size() - first;
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::reset(const Bounds& lowerBound, const Bounds& upperBound) {
+			lower = lowerBound;
+			upper = upperBound;
+			Bounds diameter(upper.x - lower.x, upper.y - lower.y, upper.z - lower.z);
+			leafDepth = 0;
+			// same recursion anchor as OctTree, i.e. a node is a leaf as soon as one of its diameters is small enough
+			while (diameter.x > minDiameter.x && diameter.y > minDiameter.y && diameter.z > minDiameter.z && leafDepth < MAX_LINEAR_DEPTH) {
+				diameter = Bounds(diameter.x / 2.0, diameter.y / 2.0, diameter.z / 2.0);
+				leafDepth++;
+			}
+			leafDiameter = diameter;
+			nodes = unordered_map<MortonKey, LinearNode>();
+			nodes[ROOT_KEY] = LinearNode();
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::resize(const Bounds& lowerBound, const Bounds& upperBound) {
+			unsigned int steps = 0;
+			Bounds rlb = lower;
+			Bounds rub = upper;
+			while (steps < MAX_RESIZE_STEPS && (lowerBound.x < rlb.x || lowerBound.y < rlb.y || lowerBound.z < rlb.z ||
+				upperBound.x > rub.x || upperBound.y > rub.y || upperBound.z > rub.z)) {
+				steps++;
+				// grow towards the side that lacks more space, like OctTree, so that roots off the origin grow as well
+				Bounds extent(rub.x - rlb.x, rub.y - rlb.y, rub.z - rlb.z);
+				bool downX = rlb.x - lowerBound.x > upperBound.x - rub.x;
+				bool downY = rlb.y - lowerBound.y > upperBound.y - rub.y;
+				bool downZ = rlb.z - lowerBound.z > upperBound.z - rub.z;
+				rlb = Bounds(downX ? rlb.x - extent.x : rlb.x, downY ? rlb.y - extent.y : rlb.y, downZ ? rlb.z - extent.z : rlb.z);
+				rub = Bounds(downX ? rub.x : rub.x + extent.x, downY ? rub.y : rub.y + extent.y, downZ ? rub.z : rub.z + extent.z);
+			}
+			// keys depend on the root bounds, hence every object has to be re-inserted
+			reset(rlb, rub);
+			resizeCount++;
+			for (auto& object : objects) {
+				insertIntoLeaves(object.second.id, object.second.lower, object.second.upper);
+			}
+		}
+
+		template <typename T>
+		const std::uint32_t LinearOctTree<T>::calcCell(const double& value, const double& rootLower, const double& cellDiameter) const {
+			double maxCell = std::ldexp(1.0, static_cast<int>(leafDepth)) - 1.0;
+			double cell = std::floor((value - rootLower) / cellDiameter);
+			cell = std::min(std::max(cell, 0.0), maxCell);
+			return static_cast<std::uint32_t>(cell);
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::insertIntoLeaves(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			std::uint32_t minX = calcCell(lowerBound.x, lower.x, leafDiameter.x);
+			std::uint32_t minY = calcCell(lowerBound.y, lower.y, leafDiameter.y);
+			std::uint32_t minZ = calcCell(lowerBound.z, lower.z, leafDiameter.z);
+			std::uint32_t maxX = calcCell(upperBound.x, lower.x, leafDiameter.x);
+			std::uint32_t maxY = calcCell(upperBound.y, lower.y, leafDiameter.y);
+			std::uint32_t maxZ = calcCell(upperBound.z, lower.z, leafDiameter.z);
+
+			for (std::uint32_t cz = minZ; cz <= maxZ; cz++) {
+				for (std::uint32_t cy = minY; cy <= maxY; cy++) {
+					for (std::uint32_t cx = minX; cx <= maxX; cx++) {
+						MortonKey key = encodeKey(cx, cy, cz, leafDepth);
+						LinearNode& leaf = nodes[key];
+						if (std::find(leaf.ids.begin(), leaf.ids.end(), id) == leaf.ids.end()) leaf.ids.push_back(id);
+						// link the leaf with its ancestors, stop as soon as the path already exists
+						while (key > ROOT_KEY) {
+							unsigned char octant = static_cast<unsigned char>(1 << (key & 7));
+							key >>= 3;
+							LinearNode& parent = nodes[key];
+							if (parent.children & octant) break;
+							parent.children |= octant;
+						}
+					}
+				}
+			}
+		}
+
+		template <typename T>
+		void LinearOctTree<T>::removeFromLeaves(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			std::uint32_t minX = calcCell(lowerBound.x, lower.x, leafDiameter.x);
+			std::uint32_t minY = calcCell(lowerBound.y, lower.y, leafDiameter.y);
+			std::uint32_t minZ = calcCell(lowerBound.z, lower.z, leafDiameter.z);
+			std::uint32_t maxX = calcCell(upperBound.x, lower.x, leafDiameter.x);
+			std::uint32_t maxY = calcCell(upperBound.y, lower.y, leafDiameter.y);
+			std::uint32_t maxZ = calcCell(upperBound.z, lower.z, leafDiameter.z);
+
+			for (std::uint32_t cz = minZ; cz <= maxZ; cz++) {
+				for (std::uint32_t cy = minY; cy <= maxY; cy++) {
+					for (std::uint32_t cx = minX; cx <= maxX; cx++) {
+						MortonKey key = encodeKey(cx, cy, cz, leafDepth);
+						auto leaf = nodes.find(key);
+						if (leaf == nodes.end()) continue;
+						IdArray<T>& ids = leaf->second.ids;
+						ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+						if (!ids.empty() || key == ROOT_KEY) continue;
+						// unlink the empty leaf from its ancestors, stop as soon as an ancestor is still in use
+						while (key > ROOT_KEY) {
+							unsigned char octant = static_cast<unsigned char>(1 << (key & 7));
+							nodes.erase(key);
+							key >>= 3;
+							LinearNode& parent = nodes[key];
+							parent.children &= ~octant;
+							if (parent.children != 0 || !parent.ids.empty()) break;
+						}
+					}
+				}
+			}
+		}
+
+		template <typename T>
+		const double LinearOctTree<T>::calcMinDistance(const MortonKey& key, const double& x, const double& y, const double& z) const {
+			Bounds lb = calcLowerBoundsOfKey(key);
+			Bounds ub = calcUpperBoundsOfKey(key);
+			double dx = std::max(std::max(lb.x - x, 0.0), x - ub.x);
+			double dy = std::max(std::max(lb.y - y, 0.0), y - ub.y);
+			double dz = std::max(std::max(lb.z - z, 0.0), z - ub.z);
+			return std::sqrt(dx*dx + dy * dy + dz * dz);
+		}
+
+		template class LinearOctTree<double>;
+		template class LinearOctTree<unsigned int>;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,470 @@
+#include "..\include\MappedOctTree.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace collision {
+	namespace octtree {
+
+		/**
+			\brief Order of the heap entries, such that the entry with the smallest distance is on top.
+			Only distances are compared, i.e. equally distant nodes are popped in the same order as by OctTreeQuery.
+		*/
+		static bool isFarther(const std::pair<double, std::uint32_t>& lhs, const std::pair<double, std::uint32_t>& rhs) {
+			return lhs.first > rhs.first;
+		}
+
+		/**
+			\brief Count the existing children of a node.
+			\param[in] childMask Bit i is set if the child of octant i exists.
+			\returns Number of set bits.
+		*/
+		static std::uint32_t countChildren(const std::uint8_t& childMask) {
+			std::uint32_t count = 0;
+			for (unsigned int oct = 0; oct < 8; oct++) count += (childMask >> oct) & 1;
+			return count;
+		}
+
+		/**
+			\brief Check if a section of a snapshot lies within the snapshot.
+			\param[in] offset Offset of the section in bytes.
+			\param[in] count Number of elements in the section.
+			\param[in] elementSize Size of an element in bytes.
+			\param[in] size Size of the snapshot in bytes.
+			\returns True if the section is aligned and does not exceed the snapshot.
+		*/
+		static bool isSectionValid(const std::uint64_t& offset, const std::uint64_t& count, const std::uint64_t& elementSize, const std::uint64_t& size) {
+			return offset % 8 == 0 && offset <= size && count <= (size - offset) / elementSize;
+		}
+
+		SnapshotFile::SnapshotFile(const std::string& path) {
+			data = nullptr;
+			size = 0;
+			mapping = nullptr;
+#ifdef _WIN32
+			HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (handle == INVALID_HANDLE_VALUE) throw std::runtime_error("Snapshot file " + path + " could not be opened.");
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+				CloseHandle(handle);
+				throw std::runtime_error("Snapshot file " + path + " is empty.");
+			}
+			size = static_cast<size_t>(fileSize.QuadPart);
+			mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+			// the mapping keeps the file open
+			CloseHandle(handle);
+			if (mapping == NULL) throw std::runtime_error("Snapshot file " + path + " could not be mapped.");
+			data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (data == nullptr) {
+				CloseHandle(mapping);
+				throw std::runtime_error("Snapshot file " + path + " could not be mapped.");
+			}
+#else
+			int handle = open(path.c_str(), O_RDONLY);
+			if (handle < 0) throw std::runtime_error("Snapshot file " + path + " could not be opened.");
+			struct stat status;
+			if (fstat(handle, &status) != 0 || status.st_size == 0) {
+				close(handle);
+				throw std::runtime_error("Snapshot file " + path + " is empty.");
+			}
+			size = static_cast<size_t>(status.st_size);
+			void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, handle, 0);
+			// the mapping keeps the file open
+			close(handle);
+			if (address == MAP_FAILED) throw std::runtime_error("Snapshot file " + path + " could not be mapped.");
+			data = static_cast<const char*>(address);
+#endif
+		}
+
+		SnapshotFile::SnapshotFile(std::vector<char>&& buffer) {
+			if (buffer.empty()) throw std::runtime_error("Snapshot buffer is empty.");
+			this->buffer = std::move(buffer);
+			data = this->buffer.data();
+			size = this->buffer.size();
+			mapping = nullptr;
+		}
+
+		SnapshotPtr SnapshotFile::create(const std::string& path) {
+			return SnapshotPtr(new SnapshotFile(path));
+		}
+
+		SnapshotPtr SnapshotFile::create(std::vector<char>&& buffer) {
+			return SnapshotPtr(new SnapshotFile(std::move(buffer)));
+		}
+
+		const char* SnapshotFile::getData() const {
+			return data;
+		}
+
+		const size_t& SnapshotFile::getSize() const {
+			return size;
+		}
+
+		SnapshotFile::~SnapshotFile() {
+			// snapshots in memory are released with the buffer
+			if (!buffer.empty()) return;
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+#else
+			munmap(const_cast<char*>(data), size);
+#endif
+		}
+
+		template <typename T>
+		MappedOctTreeQuery<T>::MappedOctTreeQuery() {
+			heap = std::vector<std::pair<double, std::uint32_t>>();
+			stamp = 0;
+			stamps = std::vector<size_t>();
+			ignoredIds = std::vector<std::uint32_t>();
+			ignoredSubtreeIds = std::vector<std::uint32_t>();
+			ids = std::vector<T>();
+		}
+
+		template <typename T>
+		MappedQueryPtr<T> MappedOctTreeQuery<T>::create() {
+			return MappedQueryPtr<T>(new MappedOctTreeQuery<T>());
+		}
+
+		template <typename T>
+		void MappedOctTreeQuery<T>::begin(const size_t& nodeCount) {
+			heap.clear();
+			stamp++;
+			if (stamps.size() < nodeCount) {
+				stamps.resize(nodeCount, 0);
+				ignoredIds.resize(nodeCount, 0);
+				ignoredSubtreeIds.resize(nodeCount, 0);
+			}
+		}
+
+		template <typename T>
+		void MappedOctTreeQuery<T>::push(const std::uint32_t& node, const double& distance) {
+			heap.push_back(std::make_pair(distance, node));
+			std::push_heap(heap.begin(), heap.end(), isFarther);
+		}
+
+		template <typename T>
+		const std::pair<double, std::uint32_t> MappedOctTreeQuery<T>::pop() {
+			std::pop_heap(heap.begin(), heap.end(), isFarther);
+			std::pair<double, std::uint32_t> nearest = heap.back();
+			heap.pop_back();
+			return nearest;
+		}
+
+		template <typename T>
+		void MappedOctTreeQuery<T>::markIgnoredId(const std::uint32_t& index, const bool own) {
+			if (stamps[index] != stamp) {
+				stamps[index] = stamp;
+				ignoredIds[index] = 0;
+				ignoredSubtreeIds[index] = 0;
+			}
+			if (own) ignoredIds[index]++;
+			ignoredSubtreeIds[index]++;
+		}
+
+		template <typename T>
+		const std::uint32_t MappedOctTreeQuery<T>::getIgnoredIds(const std::uint32_t& index) const {
+			return (stamps[index] == stamp) ? ignoredIds[index] : 0;
+		}
+
+		template <typename T>
+		const std::uint32_t MappedOctTreeQuery<T>::getIgnoredSubtreeIds(const std::uint32_t& index) const {
+			return (stamps[index] == stamp) ? ignoredSubtreeIds[index] : 0;
+		}
+
+		template <typename T>
+		MappedOctTree<T>::MappedOctTree(SnapshotPtr file, const size_t& offset) {
+			this->file = file;
+			if (offset % 8 != 0 || offset > file->getSize() || file->getSize() - offset < sizeof(SnapshotHeader)) throw std::runtime_error("There is no OctTree snapshot at the given offset.");
+			const char* base = file->getData() + offset;
+			header = reinterpret_cast<const SnapshotHeader*>(base);
+			if (header->magic != SNAPSHOT_MAGIC) throw std::runtime_error("Given data is not an OctTree snapshot.");
+			if (header->version != SNAPSHOT_VERSION) throw std::runtime_error("Given OctTree snapshot has an unsupported version.");
+			if (header->idSize != sizeof(T) || header->idIntegral != (std::numeric_limits<T>::is_integer ? 1u : 0u)) throw std::runtime_error("Given OctTree snapshot was taken from a tree with another id type.");
+			if (header->size > file->getSize() - offset || header->nodeCount == 0 ||
+				!isSectionValid(header->nodeOffset, header->nodeCount, sizeof(SnapshotNode), header->size) ||
+				!isSectionValid(header->objectOffset, header->objectCount, sizeof(SnapshotObject<T>), header->size) ||
+				!isSectionValid(header->idOffset, header->idCount, sizeof(T), header->size) ||
+				!isSectionValid(header->nodeRefOffset, header->nodeRefCount, sizeof(std::uint32_t), header->size)) {
+				throw std::runtime_error("Given OctTree snapshot is truncated or corrupted.");
+			}
+			nodes = reinterpret_cast<const SnapshotNode*>(base + header->nodeOffset);
+			objects = reinterpret_cast<const SnapshotObject<T>*>(base + header->objectOffset);
+			ids = reinterpret_cast<const T*>(base + header->idOffset);
+			nodeRefs = reinterpret_cast<const std::uint32_t*>(base + header->nodeRefOffset);
+			validate();
+		}
+
+		template <typename T>
+		MappedTreePtr<T> MappedOctTree<T>::create(const std::string& path) {
+			return MappedTreePtr<T>(new MappedOctTree<T>(SnapshotFile::create(path), 0));
+		}
+
+		template <typename T>
+		MappedTreePtr<T> MappedOctTree<T>::create(SnapshotPtr file, const size_t& offset) {
+			return MappedTreePtr<T>(new MappedOctTree<T>(file, offset));
+		}
+
+		template <typename T>
+		const IdSpan<T> MappedOctTree<T>::getNearest(const double& x, const double& y, const double& z) const {
+			return getNearest(x, y, z, *MappedOctTreeQuery<T>::create());
+		}
+
+		template <typename T>
+		const IdSpan<T> MappedOctTree<T>::getNearest(const double& x, const double& y, const double& z, MappedOctTreeQuery<T>& query) const {
+			query.begin(header->nodeCount);
+			query.push(0, calcMinDistance(nodes[0], x, y, z));
+			while (!query.heap.empty()) {
+				const SnapshotNode& current = nodes[query.pop().second];
+				if (current.idCount > 0) return getIds(current);
+				if (current.leaf) continue;
+				std::uint32_t child = current.firstChild;
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if ((current.childMask & (1 << oct)) == 0) continue;
+					query.push(child, calcMinDistance(nodes[child], x, y, z));
+					child++;
+				}
+			}
+			return getIds(nodes[0]);
+		}
+
+		template <typename T>
+		const IdSpan<T> MappedOctTree<T>::getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) const {
+			return getNearest(x, y, z, ignoreIDs, *MappedOctTreeQuery<T>::create());
+		}
+
+		template <typename T>
+		const IdSpan<T> MappedOctTree<T>::getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, MappedOctTreeQuery<T>& query) const {
+			if (ignoreIDs.size() < 1) return getNearest(x, y, z, query);
+			query.begin(header->nodeCount);
+			markIgnoredIds(ignoreIDs, query);
+			query.push(0, calcMinDistance(nodes[0], x, y, z));
+			while (!query.heap.empty()) {
+				std::uint32_t index = query.pop().second;
+				const SnapshotNode& current = nodes[index];
+				if (current.idCount > query.getIgnoredIds(index)) return getIds(current);
+				if (current.subtreeIdCount == query.getIgnoredSubtreeIds(index) || current.leaf) continue;
+				std::uint32_t child = current.firstChild;
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if ((current.childMask & (1 << oct)) == 0) continue;
+					query.push(child, calcMinDistance(nodes[child], x, y, z));
+					child++;
+				}
+			}
+			return getIds(nodes[0]);
+		}
+
+		template <typename T>
+		const IdSet<T> MappedOctTree<T>::getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) const {
+			MappedQueryPtr<T> query = MappedOctTreeQuery<T>::create();
+			getNearestIds(x, y, z, ignoreIDs, query->ids, *query);
+			return IdSet<T>(query->ids.begin(), query->ids.end());
+		}
+
+		template <typename T>
+		const size_t MappedOctTree<T>::getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, std::vector<T>& results, MappedOctTreeQuery<T>& query) const {
+			size_t first = results.size();
+			double nearestDistance = std::numeric_limits<double>::infinity();
+			query.begin(header->nodeCount);
+			markIgnoredIds(ignoreIDs, query);
+			query.push(0, calcMinDistance(nodes[0], x, y, z));
+			while (!query.heap.empty()) {
+				std::pair<double, std::uint32_t> current = query.pop();
+				const SnapshotNode& node = nodes[current.second];
+				// children are never closer than their parent, so no closer node may follow
+				if (current.first > nearestDistance) break;
+				if (node.idCount > query.getIgnoredIds(current.second)) {
+					for (auto id : getIds(node)) {
+						if (ignoreIDs.find(id) != ignoreIDs.end()) continue;
+						results.push_back(id);
+						nearestDistance = current.first;
+					}
+				}
+				if (node.leaf) continue;
+				std::uint32_t child = node.firstChild;
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if ((node.childMask & (1 << oct)) == 0) continue;
+					if (nodes[child].subtreeIdCount != query.getIgnoredSubtreeIds(child)) query.push(child, calcMinDistance(nodes[child], x, y, z));
+					child++;
+				}
+			}
+			// equally distant nodes along different paths may share objects
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const size_t MappedOctTree<T>::queryRadius(const double& x, const double& y, const double& z, const double& radius, std::vector<T>& results) const {
+			size_t first = results.size();
+			if (calcMinDistance(nodes[0], x, y, z) > radius) return 0;
+			std::vector<std::uint32_t> stack = { 0 };
+			while (!stack.empty()) {
+				const SnapshotNode& current = nodes[stack.back()];
+				stack.pop_back();
+				for (auto id : getIds(current)) {
+					const SnapshotObject<T>* object = findObject(id);
+					double dx = std::max(std::max(object->lower[0] - x, 0.0), x - object->upper[0]);
+					double dy = std::max(std::max(object->lower[1] - y, 0.0), y - object->upper[1]);
+					double dz = std::max(std::max(object->lower[2] - z, 0.0), z - object->upper[2]);
+					if (std::sqrt(dx * dx + dy * dy + dz * dz) <= radius) results.push_back(id);
+				}
+				if (current.leaf) continue;
+				// children are only visited, if they are within the radius
+				std::uint32_t child = current.firstChild;
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if ((current.childMask & (1 << oct)) == 0) continue;
+					if (calcMinDistance(nodes[child], x, y, z) <= radius) stack.push_back(child);
+					child++;
+				}
+			}
+			// objects spanning several leaves were found several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const size_t MappedOctTree<T>::queryBox(const Bounds& lowerBound, const Bounds& upperBound, std::vector<T>& results) const {
+			size_t first = results.size();
+			const double queryLower[3] = { lowerBound.x, lowerBound.y, lowerBound.z };
+			const double queryUpper[3] = { upperBound.x, upperBound.y, upperBound.z };
+			auto isOverlapping = [&queryLower, &queryUpper](const double* lower, const double* upper, const double& expand) {
+				for (unsigned int axis = 0; axis < 3; axis++) {
+					double e = expand * std::fabs(upper[axis] - lower[axis]) / 2.0;
+					if (lower[axis] - e > queryUpper[axis] || queryLower[axis] > upper[axis] + e) return false;
+				}
+				return true;
+			};
+			std::vector<std::uint32_t> stack = { 0 };
+			while (!stack.empty()) {
+				const SnapshotNode& current = nodes[stack.back()];
+				stack.pop_back();
+				if (!isOverlapping(current.lower, current.upper, header->looseness - 1.0)) continue;
+				for (auto id : getIds(current)) {
+					const SnapshotObject<T>* object = findObject(id);
+					if (isOverlapping(object->lower, object->upper, 0.0)) results.push_back(id);
+				}
+				std::uint32_t child = current.firstChild;
+				for (unsigned int oct = 0; oct < 8; oct++) {
+					if ((current.childMask & (1 << oct)) == 0) continue;
+					stack.push_back(child++);
+				}
+			}
+			// objects spanning several leaves were found several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const bool MappedOctTree<T>::containsObject(const T& id) const {
+			return findObject(id) != nullptr;
+		}
+
+		template <typename T>
+		const bool MappedOctTree<T>::getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const {
+			const SnapshotObject<T>* object = findObject(id);
+			if (object == nullptr) return false;
+			lowerBound = Bounds(object->lower[0], object->lower[1], object->lower[2]);
+			upperBound = Bounds(object->upper[0], object->upper[1], object->upper[2]);
+			return true;
+		}
+
+		template <typename T>
+		const bool MappedOctTree<T>::isLoose() const {
+			return header->looseness > 1.0;
+		}
+
+		template <typename T>
+		const Bounds MappedOctTree<T>::getLowerBounds() const {
+			return Bounds(nodes[0].lower[0], nodes[0].lower[1], nodes[0].lower[2]);
+		}
+
+		template <typename T>
+		const Bounds MappedOctTree<T>::getUpperBounds() const {
+			return Bounds(nodes[0].upper[0], nodes[0].upper[1], nodes[0].upper[2]);
+		}
+
+		template <typename T>
+		const size_t MappedOctTree<T>::getNodeCount() const {
+			return header->nodeCount;
+		}
+
+		template <typename T>
+		const size_t MappedOctTree<T>::getObjectCount() const {
+			return header->objectCount;
+		}
+
+		template <typename T>
+		const IdSpan<T> MappedOctTree<T>::getIds(const SnapshotNode& node) const {
+			return IdSpan<T>(ids + node.firstId, ids + node.firstId + node.idCount);
+		}
+
+		template <typename T>
+		const SnapshotObject<T>* MappedOctTree<T>::findObject(const T& id) const {
+			const SnapshotObject<T>* last = objects + header->objectCount;
+			const SnapshotObject<T>* object = std::lower_bound(objects, last, id, [](const SnapshotObject<T>& lhs, const T& rhs) { return lhs.id < rhs; });
+			return (object != last && object->id == id) ? object : nullptr;
+		}
+
+		template <typename T>
+		const double MappedOctTree<T>::calcMinDistance(const SnapshotNode& node, const double& x, const double& y, const double& z) const {
+			double scale = (header->looseness > 1.0) ? header->looseness - 1.0 : 0.0;
+			double ex = scale * std::fabs(node.upper[0] - node.lower[0]) / 2.0;
+			double ey = scale * std::fabs(node.upper[1] - node.lower[1]) / 2.0;
+			double ez = scale * std::fabs(node.upper[2] - node.lower[2]) / 2.0;
+			double dx = std::max(std::max(node.lower[0] - ex - x, 0.0), x - node.upper[0] - ex);
+			double dy = std::max(std::max(node.lower[1] - ey - y, 0.0), y - node.upper[1] - ey);
+			double dz = std::max(std::max(node.lower[2] - ez - z, 0.0), z - node.upper[2] - ez);
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		}
+
+		template <typename T>
+		void MappedOctTree<T>::validate() const {
+			for (std::uint32_t index = 0; index < header->nodeCount; index++) {
+				const SnapshotNode& node = nodes[index];
+				std::uint32_t childCount = countChildren(node.childMask);
+				// children follow their parent and parents precede their children, i.e. walking up or down never loops
+				bool valid = (index == 0) ? node.parent == NO_NODE : node.parent < index;
+				valid = valid && (childCount == 0 || (node.firstChild > index && node.firstChild < header->nodeCount && childCount <= header->nodeCount - node.firstChild));
+				valid = valid && node.firstId <= header->idCount && node.idCount <= header->idCount - node.firstId;
+				for (std::uint32_t child = 0; valid && child < childCount; child++) valid = nodes[node.firstChild + child].parent == index;
+				if (!valid) throw std::runtime_error("Given OctTree snapshot contains an invalid node.");
+			}
+			for (std::uint32_t index = 0; index < header->objectCount; index++) {
+				const SnapshotObject<T>& object = objects[index];
+				bool valid = object.firstNodeRef <= header->nodeRefCount && object.nodeRefCount <= header->nodeRefCount - object.firstNodeRef;
+				for (std::uint32_t ref = 0; valid && ref < object.nodeRefCount; ref++) valid = nodeRefs[object.firstNodeRef + ref] < header->nodeCount;
+				if (!valid) throw std::runtime_error("Given OctTree snapshot contains an invalid object.");
+			}
+		}
+
+		template <typename T>
+		void MappedOctTree<T>::markIgnoredIds(const IdSet<T>& ignoreIDs, MappedOctTreeQuery<T>& query) const {
+			for (auto& id : ignoreIDs) {
+				const SnapshotObject<T>* object = findObject(id);
+				if (object == nullptr) continue;
+				for (std::uint32_t ref = object->firstNodeRef; ref < object->firstNodeRef + object->nodeRefCount; ref++) {
+					query.markIgnoredId(nodeRefs[ref], true);
+					for (std::uint32_t node = nodes[nodeRefs[ref]].parent; node != NO_NODE; node = nodes[node].parent) query.markIgnoredId(node, false);
+				}
+			}
+		}
+
+		template class MappedOctTreeQuery<unsigned int>;
+		template class MappedOctTreeQuery<double>;
+		template class MappedOctTree<unsigned int>;
+		template class MappedOctTree<double>;
+	}
+}
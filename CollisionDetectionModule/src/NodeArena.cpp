@@ -0,0 +1,111 @@
+#include "..\include\NodeArena.h"
+#include <new>
+#include <stdexcept>
+
+namespace collision {
+	namespace octtree {
+
+		template <typename T>
+		NodeArena<T>::NodeArena(const size_t& slabSize) {
+			slabs = std::vector<OctTreeNode<T>*>();
+			this->slabSize = (slabSize > 0) ? slabSize : 1;
+			used = std::vector<size_t>();
+			indexCount = 0;
+			freeNodes = std::vector<OctTreeNode<T>*>();
+			stats = AllocationStats();
+		}
+
+		template <typename T>
+		ArenaPtr<T> NodeArena<T>::create(const size_t& slabSize) {
+			return ArenaPtr<T>(new NodeArena<T>(slabSize));
+		}
+
+		template <typename T>
+		NodePtr<T> NodeArena<T>::allocate() {
+			if (!freeNodes.empty()) {
+				OctTreeNode<T>* node = freeNodes.back();
+				freeNodes.pop_back();
+				stats.nodeCount++;
+				NodePtr<T> ptr(this->shared_from_this(), node);
+				node->self = ptr;
+				return ptr;
+			}
+			if (slabs.empty() || used.back() >= slabSize) {
+				size_t bytes = slabSize * sizeof(OctTreeNode<T>);
+				slabs.push_back(static_cast<OctTreeNode<T>*>(::operator new(bytes)));
+				used.push_back(0);
+				stats.slabCount++;
+				stats.reservedBytes += bytes;
+			}
+			OctTreeNode<T>* node = new (slabs.back() + used.back()) OctTreeNode<T>();
+			node->index = indexCount++;
+			used.back()++;
+			stats.nodeCount++;
+			NodePtr<T> ptr(this->shared_from_this(), node);
+			node->self = ptr;
+			return ptr;
+		}
+
+		template <typename T>
+		void NodeArena<T>::release(NodePtr<T> node) {
+			OctTreeNode<T>* raw = node.get();
+			size_t index = raw->index;
+			// the id and sphere buffers are kept, so that the next node constructed here reuses them
+			IdStorage<T> ids = std::move(raw->ids);
+			ids.clear();
+			*raw = OctTreeNode<T>();
+			raw->index = index;
+			raw->ids = std::move(ids);
+			freeNodes.push_back(raw);
+			stats.nodeCount--;
+		}
+
+		template <typename T>
+		void NodeArena<T>::adopt(ArenaPtr<T> other) {
+			if (other.get() == this) return;
+			if (other->slabSize != slabSize) throw std::runtime_error("Only NodeArenas with the same slab size may be merged.");
+			ArenaPtr<T> owner = this->shared_from_this();
+			for (size_t s = 0; s < other->slabs.size(); s++) {
+				for (size_t i = 0; i < other->used[s]; i++) {
+					other->slabs[s][i].self = NodePtr<T>(owner, other->slabs[s] + i);
+					other->slabs[s][i].index = indexCount++;
+				}
+			}
+			// adopted slabs go in front, so that the last slab keeps being filled
+			slabs.insert(slabs.begin(), other->slabs.begin(), other->slabs.end());
+			used.insert(used.begin(), other->used.begin(), other->used.end());
+			freeNodes.insert(freeNodes.end(), other->freeNodes.begin(), other->freeNodes.end());
+			stats.nodeCount += other->stats.nodeCount;
+			stats.slabCount += other->stats.slabCount;
+			stats.reservedBytes += other->stats.reservedBytes;
+			other->slabs.clear();
+			other->used.clear();
+			other->freeNodes.clear();
+			other->stats = AllocationStats();
+			other->indexCount = 0;
+		}
+
+		template <typename T>
+		const AllocationStats& NodeArena<T>::getStats() const {
+			return stats;
+		}
+
+		template <typename T>
+		const size_t& NodeArena<T>::getIndexCount() const {
+			return indexCount;
+		}
+
+		template <typename T>
+		NodeArena<T>::~NodeArena() {
+			for (size_t s = 0; s < slabs.size(); s++) {
+				for (size_t i = 0; i < used[s]; i++) {
+					slabs[s][i].~OctTreeNode<T>();
+				}
+				::operator delete(slabs[s]);
+			}
+		}
+
+		template class NodeArena<unsigned int>;
+		template class NodeArena<double>;
+	}
+}
@@ -1,53 +1,343 @@
 #include "..\include\OctTree.h"
 #include "..\include\OctTreeNode.h"
-#include <queue>
+#include "..\include\NodeArena.h"
+#include "..\include\OctTreeQuery.h"
+#include "..\include\LinearOctTree.h"
+#include "..\include\MappedOctTree.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 namespace collision {
 	namespace octtree {
+
+		/* Octant of the child with the given Morton code, where bit 0, 1 and 2 are set for the upper x-, y- and z-half. */
+		static const Octant MORTON_OCTANTS[8] = { Octant::seventh, Octant::eighth, Octant::sixth, Octant::fifth, Octant::third, Octant::fourth, Octant::second, Octant::first };
+
+		/* Depth of the branches a multi-threaded bulk-load builds as independent tasks, i.e. up to 64 tasks. */
+		static const unsigned int BUILD_BRANCH_DEPTH = 2;
+
+		/**
+			\brief Calculate the integer cell coordinate of a real coordinate at the given depth, by halving the root's interval
+			exactly like child-nodes are constructed, i.e. values on a center belong to the upper half.
+			\param[in] value Real coordinate, values outside the root's interval are clamped.
+			\param[in] lower Lower bound of the root in the same axis.
+			\param[in] upper Upper bound of the root in the same axis.
+			\param[in] depth Depth of the cell.
+			\returns Integer cell coordinate.
+		*/
+		static std::uint32_t calcCellOfValue(const double& value, const double& lower, const double& upper, const unsigned int& depth) {
+			std::uint32_t cell = 0;
+			double lo = lower;
+			double hi = upper;
+			for (unsigned int d = 0; d < depth; d++) {
+				double center = lo + (hi - lo) / 2.0;
+				cell <<= 1;
+				if (value >= center) {
+					cell |= 1;
+					lo = center;
+				}
+				else {
+					hi = center;
+				}
+			}
+			return cell;
+		}
 		
+		/**
+			\brief Calculate the euclidean distance of a point to an axis aligned bounding box.
+			\param[in] x X-Coordinate of the point.
+			\param[in] y Y-Coordinate of the point.
+			\param[in] z Z-Coordinate of the point.
+			\param[in] lower Lower bounds of the box.
+			\param[in] upper Upper bounds of the box.
+			\returns Distance of the point to the box, 0 if the point lies inside.
+		*/
+		static double calcBoxDistance(const double& x, const double& y, const double& z, const Bounds& lower, const Bounds& upper) {
+			double dx = std::max(std::max(lower.x - x, 0.0), x - upper.x);
+			double dy = std::max(std::max(lower.y - y, 0.0), y - upper.y);
+			double dz = std::max(std::max(lower.z - z, 0.0), z - upper.z);
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		}
+
+		/**
+			\brief Check if two axis aligned bounding boxes overlap, touching boxes overlap as well.
+			\param[in] lowerA Lower bounds of the first box.
+			\param[in] upperA Upper bounds of the first box.
+			\param[in] lowerB Lower bounds of the second box.
+			\param[in] upperB Upper bounds of the second box.
+			\returns True if the boxes overlap.
+		*/
+		static bool isBoxOverlapping(const Bounds& lowerA, const Bounds& upperA, const Bounds& lowerB, const Bounds& upperB) {
+			return lowerA.x <= upperB.x && lowerB.x <= upperA.x && lowerA.y <= upperB.y && lowerB.y <= upperA.y && lowerA.z <= upperB.z && lowerB.z <= upperA.z;
+		}
+
+		/**
+			\brief Calculate the euclidean distance of two axis aligned bounding boxes.
+			\param[in] lowerA Lower bounds of the first box.
+			\param[in] upperA Upper bounds of the first box.
+			\param[in] lowerB Lower bounds of the second box.
+			\param[in] upperB Upper bounds of the second box.
+			\returns Distance of the boxes, 0 if they touch or overlap.
+		*/
+		static double calcBoxToBoxDistance(const Bounds& lowerA, const Bounds& upperA, const Bounds& lowerB, const Bounds& upperB) {
+			double dx = std::max(std::max(lowerA.x - upperB.x, lowerB.x - upperA.x), 0.0);
+			double dy = std::max(std::max(lowerA.y - upperB.y, lowerB.y - upperA.y), 0.0);
+			double dz = std::max(std::max(lowerA.z - upperB.z, lowerB.z - upperA.z), 0.0);
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		}
+
+		/**
+			\brief Calculate the distance at which a ray enters an axis aligned bounding box (slab test).
+			\param[in] origin Origin of the ray.
+			\param[in] direction Normalized direction of the ray.
+			\param[in] lower Lower bounds of the box.
+			\param[in] upper Upper bounds of the box.
+			\returns Distance along the ray at which the box is entered, 0 if the origin is inside the box and POS_INF if the box is missed.
+		*/
+		static double calcRayToBoxDistance(const Bounds& origin, const Bounds& direction, const Bounds& lower, const Bounds& upper) {
+			double entry = 0.0;
+			double exit = POS_INF;
+			const double o[3] = { origin.x, origin.y, origin.z };
+			const double d[3] = { direction.x, direction.y, direction.z };
+			const double lb[3] = { lower.x, lower.y, lower.z };
+			const double ub[3] = { upper.x, upper.y, upper.z };
+			for (int axis = 0; axis < 3; axis++) {
+				if (d[axis] == 0.0) {
+					// a ray parallel to the slab misses it, unless the origin lies within
+					if (o[axis] < lb[axis] || o[axis] > ub[axis]) return POS_INF;
+					continue;
+				}
+				double t1 = (lb[axis] - o[axis]) / d[axis];
+				double t2 = (ub[axis] - o[axis]) / d[axis];
+				if (t1 > t2) std::swap(t1, t2);
+				entry = std::max(entry, t1);
+				exit = std::min(exit, t2);
+				if (entry > exit) return POS_INF;
+			}
+			return entry;
+		}
+
+		/**
+			\brief Check if an axis aligned and an oriented box overlap by testing the 15 potentially separating axes,
+			touching boxes overlap as well.
+			\param[in] lower Lower bounds of the axis aligned box.
+			\param[in] upper Upper bounds of the axis aligned box.
+			\param[in] box Oriented box.
+			\returns True if the boxes overlap.
+		*/
+		static bool isBoxOverlappingOBB(const Bounds& lower, const Bounds& upper, const OrientedBox& box) {
+			const double eps = 1e-12;
+			const double ae[3] = { (upper.x - lower.x) / 2.0, (upper.y - lower.y) / 2.0, (upper.z - lower.z) / 2.0 };
+			const double be[3] = { box.halfExtents.x, box.halfExtents.y, box.halfExtents.z };
+			const double t[3] = { box.center.x - (lower.x + upper.x) / 2.0, box.center.y - (lower.y + upper.y) / 2.0, box.center.z - (lower.z + upper.z) / 2.0 };
+			// r[i][j] is the i-th component of the box's j-th axis, eps accounts for nearly parallel edges in the cross product axes
+			double r[3][3], absR[3][3];
+			for (int j = 0; j < 3; j++) {
+				r[0][j] = box.axes[j].x;
+				r[1][j] = box.axes[j].y;
+				r[2][j] = box.axes[j].z;
+				for (int i = 0; i < 3; i++) absR[i][j] = std::fabs(r[i][j]) + eps;
+			}
+			// axes of the axis aligned box
+			for (int i = 0; i < 3; i++) {
+				if (std::fabs(t[i]) > ae[i] + be[0] * absR[i][0] + be[1] * absR[i][1] + be[2] * absR[i][2]) return false;
+			}
+			// axes of the oriented box
+			for (int j = 0; j < 3; j++) {
+				double tj = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+				if (std::fabs(tj) > ae[0] * absR[0][j] + ae[1] * absR[1][j] + ae[2] * absR[2][j] + be[j]) return false;
+			}
+			// cross products of the axes of both boxes
+			for (int i = 0; i < 3; i++) {
+				int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+				for (int j = 0; j < 3; j++) {
+					int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+					double ra = ae[i1] * absR[i2][j] + ae[i2] * absR[i1][j];
+					double rb = be[j1] * absR[i][j2] + be[j2] * absR[i][j1];
+					if (std::fabs(t[i2] * r[i1][j] - t[i1] * r[i2][j]) > ra + rb) return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+			\brief Check if an axis aligned box lies completely outside one of the given planes.
+			\param[in] lower Lower bounds of the box.
+			\param[in] upper Upper bounds of the box.
+			\param[in] planes Planes bounding a convex polytope, with normals pointing outwards.
+			\returns True if the box's corner closest to the inside of a plane is outside of it.
+		*/
+		static bool isBoxOutsidePlanes(const Bounds& lower, const Bounds& upper, const std::vector<Plane>& planes) {
+			for (auto& plane : planes) {
+				double x = (plane.normal.x >= 0.0) ? lower.x : upper.x;
+				double y = (plane.normal.y >= 0.0) ? lower.y : upper.y;
+				double z = (plane.normal.z >= 0.0) ? lower.z : upper.z;
+				if (plane.normal.x * x + plane.normal.y * y + plane.normal.z * z > plane.offset) return true;
+			}
+			return false;
+		}
+
+		/**
+			\brief Calculate the bounds of a node enlarged by the looseness of its tree.
+			\param[in] node Node whose bounds are enlarged.
+			\param[in] looseness Looseness of the node's tree.
+			\param[out] lowerBound Enlarged lower bounds of the node.
+			\param[out] upperBound Enlarged upper bounds of the node.
+		*/
+		template <typename T>
+		static void calcLooseBounds(const OctTreeNode<T>* node, const double& looseness, Bounds& lowerBound, Bounds& upperBound) {
+			Bounds extent = node->getDiameter();
+			double ex = (looseness - 1.0) * extent.x / 2.0;
+			double ey = (looseness - 1.0) * extent.y / 2.0;
+			double ez = (looseness - 1.0) * extent.z / 2.0;
+			Bounds lb = node->getLowerBounds();
+			Bounds ub = node->getUpperBounds();
+			lowerBound = Bounds(lb.x - ex, lb.y - ey, lb.z - ez);
+			upperBound = Bounds(ub.x + ex, ub.y + ey, ub.z + ez);
+		}
+
+		/**
+			\brief Narrow-phase of a ray query that collects all objects whose bounding boxes are entered, but never reports a hit,
+			i.e. the ray query visits all objects up to its maximal distance.
+		*/
+		template <typename T>
+		class RayCollector : public RayVisitor<T> {
+		public:
+
+			/**
+				\brief Constructor
+				\param[out] results Buffer the ids and entry distances are appended to.
+			*/
+			RayCollector(NeighborArray<T>& results) : results(results) {};
+
+			/**
+				\brief Append the object to the results.
+				\param[in] id Unique identifier of the object.
+				\param[in] distance Distance along the ray at which its bounding box is entered.
+				\returns POS_INF, i.e. no object is ever hit.
+			*/
+			virtual const double visit(const T& id, const double& distance) {
+				results.push_back(Neighbor<T>(id, distance));
+				return POS_INF;
+			}
+
+		private:
+
+			/* Buffer the ids and entry distances are appended to. */
+			NeighborArray<T>& results;
+		};
+
 		template <typename T>
-		OctTree<T>::OctTree(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter) {
+		OctTree<T>::OctTree(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter, const double& looseness) {
+			arena = NodeArena<T>::create();
 			nodes = NodeArray<T>();
+			nodesOutdated = false;
+			objectNodes = std::unordered_map<T, NodeArray<T>>();
+			objectBounds = std::unordered_map<T, std::pair<Bounds, Bounds>>();
+			leafCapacity = 0;
+			mergeThreshold = 0;
+			maxDepth = MAX_TREE_DEPTH;
+			buildThreads = 1;
+			defaultQuery = OctTreeQuery<T>::create();
 			this->minDiameter = minDiameter;
-			root = OctTreeNode<T>::createNode();
+			root = arena->allocate();
 			nodes.push_back(root);
 			root->setBounds(lower, upper);
 			allowResize = false;
+			resizeCount = 0;
+			validateLooseness(looseness);
+			this->looseness = looseness;
 		}
 
 		template <typename T>
-		OctTree<T>::OctTree(const Bounds& diameter, const Bounds& minDiameter) {
+		OctTree<T>::OctTree(const Bounds& diameter, const Bounds& minDiameter, const double& looseness) {
+			arena = NodeArena<T>::create();
 			nodes = NodeArray<T>();
+			nodesOutdated = false;
+			objectNodes = std::unordered_map<T, NodeArray<T>>();
+			objectBounds = std::unordered_map<T, std::pair<Bounds, Bounds>>();
+			leafCapacity = 0;
+			mergeThreshold = 0;
+			maxDepth = MAX_TREE_DEPTH;
+			buildThreads = 1;
+			defaultQuery = OctTreeQuery<T>::create();
 			this->minDiameter = minDiameter;
-			root = OctTreeNode<T>::createNode();
+			root = arena->allocate();
 			nodes.push_back(root);
 			root->setBounds(Bounds(-diameter.x / 2, -diameter.y / 2, -diameter.z / 2), Bounds(diameter.x / 2, diameter.y / 2, diameter.z / 2));
 			allowResize = false;
+			resizeCount = 0;
+			validateLooseness(looseness);
+			this->looseness = looseness;
 		}
 
 		template <typename T>
-		OctTree<T>::OctTree(const double& treeDiameter, const double& minCellDiameter) {
+		OctTree<T>::OctTree(const double& treeDiameter, const double& minCellDiameter, const double& looseness) {
+			arena = NodeArena<T>::create();
 			nodes = NodeArray<T>();
+			nodesOutdated = false;
+			objectNodes = std::unordered_map<T, NodeArray<T>>();
+			objectBounds = std::unordered_map<T, std::pair<Bounds, Bounds>>();
+			leafCapacity = 0;
+			mergeThreshold = 0;
+			maxDepth = MAX_TREE_DEPTH;
+			buildThreads = 1;
+			defaultQuery = OctTreeQuery<T>::create();
 			this->minDiameter = Bounds(minCellDiameter, minCellDiameter, minCellDiameter);
-			root = OctTreeNode<T>::createNode();
+			root = arena->allocate();
 			nodes.push_back(root);
 			root->setBounds(Bounds(-treeDiameter / 2, -treeDiameter / 2, -treeDiameter / 2), Bounds(treeDiameter / 2, treeDiameter / 2, treeDiameter / 2));
 			allowResize = false;
+			resizeCount = 0;
+			validateLooseness(looseness);
+			this->looseness = looseness;
+		}
+
+		template <typename T>
+		TreePtr<T> OctTree<T>::create(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter, const double& looseness) {
+			return TreePtr<T>(new OctTree<T>(lower, upper, minDiameter, looseness));
 		}
 
 		template <typename T>
-		TreePtr<T> OctTree<T>::create(const Bounds& lower, const Bounds& upper, const Bounds& minDiameter) {
-			return TreePtr<T>(new OctTree<T>(lower, upper, minDiameter));
+		TreePtr<T> OctTree<T>::create(const Bounds& diameter, const Bounds& minDiameter, const double& looseness) {
+			return TreePtr<T>(new OctTree<T>(diameter, minDiameter, looseness));
 		}
 
 		template <typename T>
-		TreePtr<T> OctTree<T>::create(const Bounds& diameter, const Bounds& minDiameter) {
-			return TreePtr<T>(new OctTree<T>(diameter, minDiameter));
+		TreePtr<T> OctTree<T>::create(const double& treeDiameter, const double& minCellDiameter, const double& looseness) {
+			return TreePtr<T>(new OctTree<T>(treeDiameter, minCellDiameter, looseness));
 		}
 
 		template <typename T>
-		TreePtr<T> OctTree<T>::create(const double& treeDiameter, const double& minCellDiameter) {
-			return TreePtr<T>(new OctTree<T>(treeDiameter, minCellDiameter));
+		TreePtr<T> OctTree<T>::createFromObjects(const ObjectArray<T>& objects, const Bounds& minDiameter, const double& looseness) {
+			Bounds lb(POS_INF, POS_INF, POS_INF);
+			Bounds ub(NEG_INF, NEG_INF, NEG_INF);
+			for (auto& object : objects) {
+				lb = Bounds(std::min(lb.x, object.lower.x), std::min(lb.y, object.lower.y), std::min(lb.z, object.lower.z));
+				ub = Bounds(std::max(ub.x, object.upper.x), std::max(ub.y, object.upper.y), std::max(ub.z, object.upper.z));
+			}
+			if (objects.empty()) {
+				lb = Bounds(-minDiameter.x / 2, -minDiameter.y / 2, -minDiameter.z / 2);
+				ub = Bounds(minDiameter.x / 2, minDiameter.y / 2, minDiameter.z / 2);
+			}
+			double halfDiameter = std::max(ub.x - lb.x, std::max(ub.y - lb.y, ub.z - lb.z)) / 2.0;
+			Bounds center(lb.x + (ub.x - lb.x) / 2.0, lb.y + (ub.y - lb.y) / 2.0, lb.z + (ub.z - lb.z) / 2.0);
+			TreePtr<T> tree(new OctTree<T>(Bounds(center.x - halfDiameter, center.y - halfDiameter, center.z - halfDiameter),
+				Bounds(center.x + halfDiameter, center.y + halfDiameter, center.z + halfDiameter), minDiameter, looseness));
+			tree->insertObjects(objects);
+			return tree;
+		}
+
+		template <typename T>
+		const bool OctTree<T>::isLoose() const {
+			return looseness > 1.0;
 		}
 
 		template <typename T>
@@ -55,11 +345,214 @@ namespace collision {
 			this->allowResize = resizeOn;
 		}
 
+		template <typename T>
+		void OctTree<T>::setLeafCapacity(const unsigned int& leafCapacity, const unsigned int& mergeThreshold) {
+			if (leafCapacity > 0 && mergeThreshold > leafCapacity) throw std::runtime_error("Merge threshold of an OctTree must not exceed its leaf capacity.");
+			this->leafCapacity = leafCapacity;
+			this->mergeThreshold = (leafCapacity > 0) ? mergeThreshold : 0;
+		}
+
+		template <typename T>
+		void OctTree<T>::setMaxDepth(const unsigned int& maxDepth) {
+			this->maxDepth = maxDepth;
+		}
+
+		template <typename T>
+		void OctTree<T>::setBuildThreads(const unsigned int& buildThreads) {
+			this->buildThreads = buildThreads;
+		}
+
 		template <typename T>
 		const NodeArray<T>& OctTree<T>::getNodes() const {
+			if (nodesOutdated) {
+				nodes.clear();
+				NodeArray<T> stack = { root };
+				while (!stack.empty()) {
+					NodePtr<T> current = stack.back();
+					stack.pop_back();
+					nodes.push_back(current);
+					for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+						if (current->isOctantNull(static_cast<Octant>(oct))) continue;
+						stack.push_back(current->getChild(static_cast<Octant>(oct)));
+					}
+				}
+				nodesOutdated = false;
+			}
 			return nodes;
 		}
 
+		template <typename T>
+		const AllocationStats& OctTree<T>::getAllocationStats() const {
+			return arena->getStats();
+		}
+
+		template <typename T>
+		const TreeStats OctTree<T>::getStats() const {
+			TreeStats stats;
+			std::vector<std::pair<const OctTreeNode<T>*, unsigned int>> stack = { std::make_pair(root.get(), 0u) };
+			while (!stack.empty()) {
+				const OctTreeNode<T>* current = stack.back().first;
+				unsigned int depth = stack.back().second;
+				stack.pop_back();
+				size_t idCount = current->getIds().size();
+				stats.nodeCount++;
+				stats.idEntryCount += idCount;
+				stats.idBytes += current->ids.getHeapBytes();
+				if (idCount == 0) stats.emptyNodeCount++;
+				if (stats.nodesPerDepth.size() <= depth) stats.nodesPerDepth.resize(depth + 1, 0);
+				stats.nodesPerDepth[depth]++;
+				if (current->isLeaf()) {
+					stats.leafCount++;
+					if (stats.leavesPerIdCount.size() <= idCount) stats.leavesPerIdCount.resize(idCount + 1, 0);
+					stats.leavesPerIdCount[idCount]++;
+					continue;
+				}
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (current->octants[oct] != nullptr) stack.push_back(std::make_pair(current->octants[oct], depth + 1));
+				}
+			}
+			stats.emptyNodeFraction = static_cast<double>(stats.emptyNodeCount) / static_cast<double>(stats.nodeCount);
+			stats.objectCount = objectNodes.size();
+			stats.duplicationFactor = (stats.objectCount > 0) ? static_cast<double>(stats.idEntryCount) / static_cast<double>(stats.objectCount) : 0.0;
+			stats.resizeCount = resizeCount;
+			stats.nodeBytes = arena->getStats().reservedBytes;
+			// hash map entries are counted with one pointer for the bucket list, allocator overhead is not included
+			stats.objectBytes = (objectNodes.bucket_count() + objectBounds.bucket_count()) * sizeof(void*);
+			stats.objectBytes += objectNodes.size() * (sizeof(std::pair<const T, NodeArray<T>>) + sizeof(void*));
+			stats.objectBytes += objectBounds.size() * (sizeof(std::pair<const T, std::pair<Bounds, Bounds>>) + sizeof(void*));
+			for (auto& occupied : objectNodes) stats.objectBytes += occupied.second.capacity() * sizeof(NodePtr<T>);
+			stats.totalBytes = stats.nodeBytes + stats.idBytes + stats.objectBytes;
+			return stats;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::getNodeBounds(std::vector<std::pair<Bounds, Bounds>>& bounds, const bool includeEmpty) const {
+			size_t first = bounds.size();
+			for (auto& node : getNodes()) {
+				if (node->isEmpty() && !includeEmpty) continue;
+				bounds.push_back(std::make_pair(node->getLowerBounds(), node->getUpperBounds()));
+			}
+			return bounds.size() - first;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::writeSnapshot(std::vector<char>& buffer) const {
+			// nodes are numbered breadth first, so that the children of a node are stored next to each other in octant order
+			std::vector<const OctTreeNode<T>*> order = { root.get() };
+			std::vector<std::uint32_t> snapshotIndex(arena->getIndexCount(), NO_NODE);
+			snapshotIndex[root->getIndex()] = 0;
+			size_t idCount = 0;
+			for (size_t i = 0; i < order.size(); i++) {
+				idCount += order[i]->getIds().size();
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					const OctTreeNode<T>* child = order[i]->octants[oct];
+					if (child == nullptr) continue;
+					snapshotIndex[child->getIndex()] = static_cast<std::uint32_t>(order.size());
+					order.push_back(child);
+				}
+			}
+			std::vector<T> objectIds;
+			objectIds.reserve(objectNodes.size());
+			size_t nodeRefCount = 0;
+			for (auto& occupied : objectNodes) {
+				objectIds.push_back(occupied.first);
+				nodeRefCount += occupied.second.size();
+			}
+			std::sort(objectIds.begin(), objectIds.end());
+
+			SnapshotHeader header;
+			std::memset(&header, 0, sizeof(SnapshotHeader));
+			header.magic = SNAPSHOT_MAGIC;
+			header.version = SNAPSHOT_VERSION;
+			header.idSize = sizeof(T);
+			header.idIntegral = std::numeric_limits<T>::is_integer ? 1 : 0;
+			header.nodeCount = static_cast<std::uint32_t>(order.size());
+			header.idCount = static_cast<std::uint32_t>(idCount);
+			header.objectCount = static_cast<std::uint32_t>(objectIds.size());
+			header.nodeRefCount = static_cast<std::uint32_t>(nodeRefCount);
+			header.looseness = looseness;
+			header.nodeOffset = alignSnapshotOffset(sizeof(SnapshotHeader));
+			header.objectOffset = alignSnapshotOffset(header.nodeOffset + header.nodeCount * sizeof(SnapshotNode));
+			header.idOffset = alignSnapshotOffset(header.objectOffset + header.objectCount * sizeof(SnapshotObject<T>));
+			header.nodeRefOffset = alignSnapshotOffset(header.idOffset + header.idCount * sizeof(T));
+			header.size = alignSnapshotOffset(header.nodeRefOffset + header.nodeRefCount * sizeof(std::uint32_t));
+
+			size_t offset = static_cast<size_t>(alignSnapshotOffset(buffer.size()));
+			buffer.resize(offset + static_cast<size_t>(header.size), 0);
+			char* base = buffer.data() + offset;
+			std::memcpy(base, &header, sizeof(SnapshotHeader));
+			std::uint32_t firstId = 0;
+			for (size_t i = 0; i < order.size(); i++) {
+				const OctTreeNode<T>* current = order[i];
+				SnapshotNode node;
+				std::memset(&node, 0, sizeof(SnapshotNode));
+				Bounds lb = current->getLowerBounds();
+				Bounds ub = current->getUpperBounds();
+				node.lower[0] = lb.x;
+				node.lower[1] = lb.y;
+				node.lower[2] = lb.z;
+				node.upper[0] = ub.x;
+				node.upper[1] = ub.y;
+				node.upper[2] = ub.z;
+				node.parent = (current->parent == nullptr) ? NO_NODE : snapshotIndex[current->parent->getIndex()];
+				node.firstChild = NO_NODE;
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					const OctTreeNode<T>* child = current->octants[oct];
+					if (child == nullptr) continue;
+					if (node.firstChild == NO_NODE) node.firstChild = snapshotIndex[child->getIndex()];
+					node.childMask |= static_cast<std::uint8_t>(1 << oct);
+				}
+				IdSpan<T> nodeIds = current->getIds();
+				node.firstId = firstId;
+				node.idCount = static_cast<std::uint32_t>(nodeIds.size());
+				node.subtreeIdCount = static_cast<std::uint32_t>(current->getSubtreeIdCount());
+				node.leaf = current->isLeaf() ? 1 : 0;
+				if (!nodeIds.empty()) std::memcpy(base + header.idOffset + firstId * sizeof(T), nodeIds.begin(), nodeIds.size() * sizeof(T));
+				firstId += node.idCount;
+				std::memcpy(base + header.nodeOffset + i * sizeof(SnapshotNode), &node, sizeof(SnapshotNode));
+			}
+			std::uint32_t firstNodeRef = 0;
+			for (size_t i = 0; i < objectIds.size(); i++) {
+				const std::pair<Bounds, Bounds>& bounds = objectBounds.at(objectIds[i]);
+				const NodeArray<T>& occupied = objectNodes.at(objectIds[i]);
+				SnapshotObject<T> object;
+				std::memset(&object, 0, sizeof(SnapshotObject<T>));
+				object.id = objectIds[i];
+				object.lower[0] = bounds.first.x;
+				object.lower[1] = bounds.first.y;
+				object.lower[2] = bounds.first.z;
+				object.upper[0] = bounds.second.x;
+				object.upper[1] = bounds.second.y;
+				object.upper[2] = bounds.second.z;
+				object.firstNodeRef = firstNodeRef;
+				object.nodeRefCount = static_cast<std::uint32_t>(occupied.size());
+				for (auto& node : occupied) {
+					std::uint32_t index = snapshotIndex[node->getIndex()];
+					std::memcpy(base + header.nodeRefOffset + firstNodeRef * sizeof(std::uint32_t), &index, sizeof(std::uint32_t));
+					firstNodeRef++;
+				}
+				std::memcpy(base + header.objectOffset + i * sizeof(SnapshotObject<T>), &object, sizeof(SnapshotObject<T>));
+			}
+			return offset;
+		}
+
+		template <typename T>
+		void OctTree<T>::save(const std::string& path) const {
+			std::vector<char> buffer;
+			writeSnapshot(buffer);
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (!file) throw std::runtime_error("OctTree snapshot file " + path + " could not be opened for writing.");
+			file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			if (!file) throw std::runtime_error("OctTree snapshot file " + path + " could not be written.");
+		}
+
+		template <typename T>
+		MappedTreePtr<T> OctTree<T>::freeze() const {
+			std::vector<char> buffer;
+			size_t offset = writeSnapshot(buffer);
+			return MappedOctTree<T>::create(SnapshotFile::create(std::move(buffer)), offset);
+		}
+
 		template <typename T>
 		void OctTree<T>::insertObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
 			
@@ -68,47 +561,289 @@ namespace collision {
 				resize(lowerBound, upperBound);
 			}
 			
-			insertObject(root, id, lowerBound, upperBound);
+			storeObjectBounds(id, lowerBound, upperBound);
+			if (isLoose()) {
+				insertLooseObject(root, id, lowerBound, upperBound, 0, false);
+				return;
+			}
+			insertObject(root, id, lowerBound, upperBound, 0);
 		}
 
-		class mycomparison
-		{
-			bool reverse;
-			double x, y, z;
-		public:
-			mycomparison(const double& x, const double& y, const double& z ,const bool& revparam = false) :
-				x(x), y(y), z(z)
-			{
-				reverse = revparam;
+		template <typename T>
+		void OctTree<T>::insertObjects(const ObjectArray<T>& objects) {
+			if (objects.empty()) return;
+			Bounds lb = objects.front().lower;
+			Bounds ub = objects.front().upper;
+			for (auto& object : objects) {
+				lb = Bounds(std::min(lb.x, object.lower.x), std::min(lb.y, object.lower.y), std::min(lb.z, object.lower.z));
+				ub = Bounds(std::max(ub.x, object.upper.x), std::max(ub.y, object.upper.y), std::max(ub.z, object.upper.z));
+				storeObjectBounds(object.id, object.lower, object.upper);
+			}
+			if (allowResize && !root->isInBounds(lb, ub)) {
+				//resize in order of insertion, since the direction of growth depends on the first object outside
+				for (auto& object : objects) {
+					if (!root->isInBounds(object.lower, object.upper)) resize(object.lower, object.upper);
+				}
 			}
 
-			template <typename T>
-			bool operator() (const NodePtr<T> lhs, const NodePtr<T> rhs) const
-			{
-			
-				double	lhsDist = lhs->calcMinDistance(x, y, z);
-				double	rhsDist = rhs->calcMinDistance(x, y, z);
-				
-				if (reverse) {
-					return (lhsDist>rhsDist);
+			unsigned int leafDepth = calcLeafDepth();
+			if (isLoose() || leafCapacity > 0 || leafDepth > MAX_LINEAR_DEPTH) {
+				for (auto& object : objects) {
+					if (isLoose()) insertLooseObject(root, object.id, object.lower, object.upper, 0, false);
+					else insertObject(root, object.id, object.lower, object.upper, 0);
 				}
-				else {
-					return (lhsDist<rhsDist);
-				}	
+				return;
 			}
-		};
+
+			// 1 find the Morton codes of all leaves each object overlaps
+			const Bounds& rlb = root->getLowerBounds();
+			const Bounds& rub = root->getUpperBounds();
+			vector<std::pair<MortonKey, T>> entries;
+			entries.reserve(objects.size());
+			for (auto& object : objects) {
+				std::uint32_t minX = calcCellOfValue(object.lower.x, rlb.x, rub.x, leafDepth);
+				std::uint32_t minY = calcCellOfValue(object.lower.y, rlb.y, rub.y, leafDepth);
+				std::uint32_t minZ = calcCellOfValue(object.lower.z, rlb.z, rub.z, leafDepth);
+				std::uint32_t maxX = calcCellOfValue(object.upper.x, rlb.x, rub.x, leafDepth);
+				std::uint32_t maxY = calcCellOfValue(object.upper.y, rlb.y, rub.y, leafDepth);
+				std::uint32_t maxZ = calcCellOfValue(object.upper.z, rlb.z, rub.z, leafDepth);
+				for (std::uint32_t cz = minZ; cz <= maxZ; cz++) {
+					for (std::uint32_t cy = minY; cy <= maxY; cy++) {
+						for (std::uint32_t cx = minX; cx <= maxX; cx++) {
+							entries.push_back(std::make_pair(LinearOctTree<T>::encodeKey(cx, cy, cz, leafDepth), object.id));
+						}
+					}
+				}
+			}
+			// 2 sort them, so that leaves sharing a branch follow each other, ids keep their order of insertion within a leaf
+			std::stable_sort(entries.begin(), entries.end(), [](const std::pair<MortonKey, T>& lhs, const std::pair<MortonKey, T>& rhs) { return lhs.first < rhs.first; });
+			// 3 build the tree in a single pass, only the part of the path that differs from the previous leaf is visited
+			nodesOutdated = true;
+			unsigned int threads = (buildThreads > 0) ? buildThreads : std::max(std::thread::hardware_concurrency(), 1u);
+			if (threads == 1 || leafDepth == 0) {
+				buildBranch(root, 0, leafDepth, entries, 0, entries.size(), arena, objectNodes);
+				return;
+			}
+
+			// 3.1 create the nodes down to the branch depth, each of them starts a branch of consecutive entries
+			unsigned int branchDepth = std::min(leafDepth, BUILD_BRANCH_DEPTH);
+			unsigned int shift = 3 * (leafDepth - branchDepth);
+			NodeArray<T> branches;
+			vector<size_t> firstEntries;
+			for (size_t i = 0; i < entries.size(); i++) {
+				if (i > 0 && (entries[i].first >> shift) == (entries[i - 1].first >> shift)) continue;
+				NodePtr<T> node = root;
+				for (unsigned int depth = 0; depth < branchDepth; depth++) {
+					Octant oct = MORTON_OCTANTS[(entries[i].first >> (3 * (leafDepth - depth - 1))) & 7];
+					if (node->isOctantNull(oct)) makeNewOctant(node, node->calcChildLowerBounds(oct), node->calcChildUpperBounds(oct), oct);
+					node = node->getChild(oct);
+				}
+				branches.push_back(node);
+				firstEntries.push_back(i);
+			}
+			firstEntries.push_back(entries.size());
+
+			// 3.2 build the branches on a pool of threads, each branch with its own arena and leaves,
+			// branches are detached from their parents meanwhile, so that id counts are only propagated within a branch
+			vector<OctTreeNode<T>*> parents(branches.size());
+			vector<size_t> idCounts(branches.size());
+			for (size_t b = 0; b < branches.size(); b++) {
+				parents[b] = branches[b]->parent;
+				idCounts[b] = branches[b]->subtreeIds;
+				branches[b]->parent = nullptr;
+			}
+			vector<ArenaPtr<T>> arenas(branches.size());
+			vector<std::unordered_map<T, NodeArray<T>>> leaves(branches.size());
+			std::atomic<size_t> nextBranch(0);
+			std::exception_ptr error;
+			std::atomic<bool> failed(false);
+			auto worker = [&]() {
+				for (size_t b = nextBranch++; b < branches.size() && !failed; b = nextBranch++) {
+					try {
+						arenas[b] = NodeArena<T>::create();
+						buildBranch(branches[b], branchDepth, leafDepth, entries, firstEntries[b], firstEntries[b + 1], arenas[b], leaves[b]);
+					}
+					catch (...) {
+						if (!failed.exchange(true)) error = std::current_exception();
+					}
+				}
+			};
+			vector<std::thread> pool;
+			for (unsigned int t = 1; t < std::min<size_t>(threads, branches.size()); t++) pool.push_back(std::thread(worker));
+			worker();
+			for (auto& thread : pool) thread.join();
+			for (size_t b = 0; b < branches.size(); b++) {
+				branches[b]->parent = parents[b];
+				parents[b]->countSubtreeIds(static_cast<std::ptrdiff_t>(branches[b]->subtreeIds) - static_cast<std::ptrdiff_t>(idCounts[b]));
+			}
+			if (failed) std::rethrow_exception(error);
+
+			// 3.3 merge the branches in the order of their Morton codes, i.e. exactly as a serial build would have
+			for (size_t b = 0; b < branches.size(); b++) {
+				arena->adopt(arenas[b]);
+				for (auto& entry : leaves[b]) {
+					NodeArray<T>& occupied = objectNodes[entry.first];
+					for (auto& leaf : entry.second) occupied.push_back(NodePtr<T>(arena, leaf.get()));
+				}
+			}
+		}
+
+		template <typename T>
+		void OctTree<T>::buildBranch(NodePtr<T> branch, const unsigned int& branchDepth, const unsigned int& leafDepth, const std::vector<std::pair<std::uint64_t, T>>& entries,
+			const size_t& first, const size_t& last, ArenaPtr<T> nodeArena, std::unordered_map<T, NodeArray<T>>& leaves) {
+			NodeArray<T> path(leafDepth + 1);
+			path[branchDepth] = branch;
+			MortonKey previous = 0;
+			for (size_t i = first; i < last; i++) {
+				MortonKey key = entries[i].first;
+				if (key != previous) {
+					unsigned int depth = branchDepth;
+					while (previous != 0 && depth < leafDepth && (previous >> (3 * (leafDepth - depth - 1))) == (key >> (3 * (leafDepth - depth - 1)))) depth++;
+					for (; depth < leafDepth; depth++) {
+						Octant oct = MORTON_OCTANTS[(key >> (3 * (leafDepth - depth - 1))) & 7];
+						NodePtr<T> node = path[depth];
+						if (node->isOctantNull(oct)) {
+							NodePtr<T> child = nodeArena->allocate();
+							child->setBounds(node->calcChildLowerBounds(oct), node->calcChildUpperBounds(oct));
+							child->setParent(node);
+							node->setChild(child, oct);
+						}
+						path[depth + 1] = node->getChild(oct);
+					}
+					previous = key;
+				}
+				NodePtr<T> leaf = path[leafDepth];
+				const T& id = entries[i].second;
+				if (leaf->getIds().find(id) == leaf->getIds().end()) leaves[id].push_back(leaf);
+				const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+				leaf->addId(id, bounds.first, bounds.second);
+			}
+		}
+
+		template <typename T>
+		const bool OctTree<T>::removeObject(const T& id) {
+			auto entry = objectNodes.find(id);
+			if (entry == objectNodes.end()) return false;
+			NodeArray<T> leaves = std::move(entry->second);
+			objectNodes.erase(entry);
+			objectBounds.erase(id);
+			NodeArray<T> remaining;
+			for (auto leaf : leaves) {
+				leaf->removeId(id);
+				remaining.push_back(prune(leaf));
+			}
+			// merge only after all leaves were updated, since merging moves ids between nodes
+			if (mergeThreshold > 0) {
+				for (auto node : remaining) collapse(node);
+			}
+			if (allowResize) shrink();
+			return true;
+		}
+
+		template <typename T>
+		void OctTree<T>::updateObject(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			auto entry = objectNodes.find(id);
+			if (entry == objectNodes.end()) {
+				insertObject(id, lowerBound, upperBound);
+				return;
+			}
+			const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+			if (bounds.first.x == lowerBound.x && bounds.first.y == lowerBound.y && bounds.first.z == lowerBound.z &&
+				bounds.second.x == upperBound.x && bounds.second.y == upperBound.y && bounds.second.z == upperBound.z) return;
+			NodeArray<T> oldLeaves = std::move(entry->second);
+			objectNodes.erase(entry);
+			objectBounds.erase(id);
+			// insert first, so that leaves which are still occupied are neither pruned nor re-created
+			insertObject(id, lowerBound, upperBound);
+			const NodeArray<T>& newLeaves = objectNodes[id];
+			NodeArray<T> remaining;
+			for (auto leaf : oldLeaves) {
+				if (std::find(newLeaves.begin(), newLeaves.end(), leaf) != newLeaves.end()) continue;
+				leaf->removeId(id);
+				remaining.push_back(prune(leaf));
+			}
+			if (mergeThreshold > 0) {
+				for (auto node : remaining) collapse(node);
+			}
+			if (allowResize) shrink();
+		}
+
+		template <typename T>
+		void OctTree<T>::compact() {
+			if (objectBounds.empty()) return;
+			ObjectArray<T> objects;
+			objects.reserve(objectBounds.size());
+			Bounds lb(POS_INF, POS_INF, POS_INF);
+			Bounds ub(NEG_INF, NEG_INF, NEG_INF);
+			for (auto& entry : objectBounds) {
+				const Bounds& lower = entry.second.first;
+				const Bounds& upper = entry.second.second;
+				lb = Bounds(std::min(lb.x, lower.x), std::min(lb.y, lower.y), std::min(lb.z, lower.z));
+				ub = Bounds(std::max(ub.x, upper.x), std::max(ub.y, upper.y), std::max(ub.z, upper.z));
+				objects.push_back(ObjectEntry<T>(entry.first, lower, upper));
+			}
+			// sorted, so that the rebuilt tree does not depend on the order of the hash map
+			std::sort(objects.begin(), objects.end(), [](const ObjectEntry<T>& lhs, const ObjectEntry<T>& rhs) { return lhs.id < rhs.id; });
+
+			// the new root is aligned to the current leaf cells, so that all leaves keep their bounds
+			const Bounds& rlb = root->getLowerBounds();
+			Bounds diameter = root->getDiameter();
+			double scale = std::ldexp(1.0, -static_cast<int>(calcLeafDepth()));
+			Bounds cell(diameter.x * scale, diameter.y * scale, diameter.z * scale);
+			Bounds lower(rlb.x + std::floor((lb.x - rlb.x) / cell.x) * cell.x, rlb.y + std::floor((lb.y - rlb.y) / cell.y) * cell.y, rlb.z + std::floor((lb.z - rlb.z) / cell.z) * cell.z);
+			Bounds upper(lower.x + cell.x, lower.y + cell.y, lower.z + cell.z);
+			unsigned int depth = 0;
+			while ((upper.x < ub.x || upper.y < ub.y || upper.z < ub.z) && depth < MAX_TREE_DEPTH) {
+				upper = Bounds(2.0 * upper.x - lower.x, 2.0 * upper.y - lower.y, 2.0 * upper.z - lower.z);
+				depth++;
+			}
+
+			NodeArray<T> oldNodes = getNodes();
+			for (auto node : oldNodes) arena->release(node);
+			oldNodes.clear();
+			objectNodes.clear();
+			objectBounds.clear();
+			root = arena->allocate();
+			root->setBounds(lower, upper);
+			nodes.clear();
+			nodes.push_back(root);
+			nodesOutdated = false;
+			resizeCount++;
+			insertObjects(objects);
+		}
+
+		template <typename T>
+		const bool OctTree<T>::containsObject(const T& id) const {
+			return objectNodes.find(id) != objectNodes.end();
+		}
+
+		template <typename T>
+		const bool OctTree<T>::getObjectBounds(const T& id, Bounds& lowerBound, Bounds& upperBound) const {
+			auto entry = objectBounds.find(id);
+			if (entry == objectBounds.end()) return false;
+			lowerBound = entry->second.first;
+			upperBound = entry->second.second;
+			return true;
+		}
 
 		template <typename T>
 		NodePtr<T> OctTree<T>::getNearest(const double& x, const double& y, const double& z) {
-			std::priority_queue<NodePtr<T>, std::vector<NodePtr<T>>, mycomparison> queue(mycomparison(x, y, z, true));
-			queue.push(root);
-			while (!queue.empty()) {
-				NodePtr<T> current = queue.top();
-				queue.pop();
-				if (current->isLeaf()) return current;
+			return getNearest(x, y, z, *defaultQuery);
+		}
+
+		template <typename T>
+		NodePtr<T> OctTree<T>::getNearest(const double& x, const double& y, const double& z, OctTreeQuery<T>& query) const {
+			query.begin(arena->getIndexCount());
+			ChildDistances distances;
+			query.push(root.get(), root->calcMinDistance(x, y, z, looseness));
+			while (!query.isEmpty()) {
+				OctTreeNode<T>* current = query.pop().second;
+				// in a regular tree only leaves carry ids, in a loose tree inner nodes may carry ids as well
+				if (!current->isEmpty()) return current->self.lock();
+				if (current->isLeaf()) continue;
+				current->calcChildDistances(x, y, z, looseness, distances);
 				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
-					if (current->isOctantNull(static_cast<Octant>(oct))) continue;
-					queue.push(current->getChild(static_cast<Octant>(oct)));
+					if (current->octants[oct] != nullptr) query.push(current->octants[oct], distances[oct]);
 				}
 			}
 			return root;
@@ -116,112 +851,630 @@ namespace collision {
 
 		template <typename T>
 		NodePtr<T> OctTree<T>::getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) {
-			if (ignoreIDs.size() < 1) return getNearest(x, y, z);
-			std::priority_queue<NodePtr<T>, std::vector<NodePtr<T>>, mycomparison> queue(mycomparison(x, y, z, true));
-			queue.push(root);
-			while (!queue.empty()) {
-				NodePtr<T> current = queue.top();
-				queue.pop();
-				bool ignore = false;
-				unsigned int found = 0;
-				for (auto id : ignoreIDs) {
-					if (current->getIds().find(id) != current->getIds().end()) found++;
-				}
-				if (found == current->getIds().size()) ignore = true;
-				if (current->isLeaf() && !ignore) return current;
+			return getNearest(x, y, z, ignoreIDs, *defaultQuery);
+		}
+
+		template <typename T>
+		NodePtr<T> OctTree<T>::getNearest(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, OctTreeQuery<T>& query) const {
+			if (ignoreIDs.size() < 1) return getNearest(x, y, z, query);
+			query.begin(arena->getIndexCount());
+			markIgnoredIds(ignoreIDs, query);
+			ChildDistances distances;
+			query.push(root.get(), root->calcMinDistance(x, y, z, looseness));
+			while (!query.isEmpty()) {
+				OctTreeNode<T>* current = query.pop().second;
+				if (query.hasUnignoredIds(current)) return current->self.lock();
+				// ignored sub-trees are skipped when popped, not when pushed, which keeps the order of equally distant nodes
+				if (query.isSubtreeIgnored(current) || current->isLeaf()) continue;
+				current->calcChildDistances(x, y, z, looseness, distances);
 				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
-					if (current->isOctantNull(static_cast<Octant>(oct))) continue;
-					queue.push(current->getChild(static_cast<Octant>(oct)));
+					if (current->octants[oct] != nullptr) query.push(current->octants[oct], distances[oct]);
 				}
 			}
 			return root;
 		}
 
 		template <typename T>
-		bool OctTree<T>::insertObject(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+		const IdSet<T> OctTree<T>::getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs) {
+			defaultQuery->ids.clear();
+			getNearestIds(x, y, z, ignoreIDs, defaultQuery->ids, *defaultQuery);
+			return IdSet<T>(defaultQuery->ids.begin(), defaultQuery->ids.end());
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::getNearestIds(const double& x, const double& y, const double& z, const IdSet<T>& ignoreIDs, std::vector<T>& results, OctTreeQuery<T>& query) const {
+			size_t first = results.size();
+			double nearestDistance = POS_INF;
+			query.begin(arena->getIndexCount());
+			markIgnoredIds(ignoreIDs, query);
+			ChildDistances distances;
+			query.push(root.get(), root->calcMinDistance(x, y, z, looseness));
+			while (!query.isEmpty()) {
+				std::pair<double, OctTreeNode<T>*> current = query.pop();
+				// children are never closer than their parent, so no closer node may follow
+				if (current.first > nearestDistance) break;
+				if (query.hasUnignoredIds(current.second)) {
+					for (auto id : current.second->getIds()) {
+						if (ignoreIDs.find(id) != ignoreIDs.end()) continue;
+						results.push_back(id);
+						nearestDistance = current.first;
+					}
+				}
+				if (current.second->isLeaf()) continue;
+				current.second->calcChildDistances(x, y, z, looseness, distances);
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					OctTreeNode<T>* child = current.second->octants[oct];
+					if (child != nullptr && !query.isSubtreeIgnored(child)) query.push(child, distances[oct]);
+				}
+			}
+			// equally distant nodes along different paths may share objects
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const NeighborArray<T> OctTree<T>::getKNearest(const double& x, const double& y, const double& z, const unsigned int& k, const IdSet<T>& ignoreIDs) {
+			NeighborArray<T> nearest;
+			getKNearest(x, y, z, k, ignoreIDs, nearest, *defaultQuery);
+			return nearest;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::getKNearest(const double& x, const double& y, const double& z, const unsigned int& k, const IdSet<T>& ignoreIDs, NeighborArray<T>& results, OctTreeQuery<T>& query) const {
+			auto closer = [](const Neighbor<T>& lhs, const Neighbor<T>& rhs) { return (lhs.distance != rhs.distance) ? lhs.distance < rhs.distance : lhs.id < rhs.id; };
+			if (k == 0) return 0;
+			// max-heap of the k nearest objects found so far, its top is the current k-th nearest object
+			NeighborArray<T>& nearest = query.neighbors;
+			nearest.clear();
+			query.begin(arena->getIndexCount());
+			markIgnoredIds(ignoreIDs, query);
+			ChildDistances distances;
+			query.push(root.get(), root->calcMinDistance(x, y, z, looseness));
+			while (!query.isEmpty()) {
+				std::pair<double, OctTreeNode<T>*> current = query.pop();
+				// nodes are popped by ascending distance, objects in this or following nodes are never closer than the node itself
+				if (nearest.size() == k && current.first > nearest.front().distance) break;
+				for (auto id : current.second->getIds()) {
+					if (ignoreIDs.find(id) != ignoreIDs.end()) continue;
+					const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+					Neighbor<T> candidate(id, calcBoxDistance(x, y, z, bounds.first, bounds.second));
+					// objects spanning several leaves are found several times, but always with the same distance,
+					// i.e. a duplicate is either still on the heap or was evicted by closer objects and is rejected below
+					bool found = false;
+					for (auto& neighbor : nearest) found = found || neighbor.id == id;
+					if (found) continue;
+					if (nearest.size() < k) {
+						nearest.push_back(candidate);
+						std::push_heap(nearest.begin(), nearest.end(), closer);
+					}
+					else if (closer(candidate, nearest.front())) {
+						std::pop_heap(nearest.begin(), nearest.end(), closer);
+						nearest.back() = candidate;
+						std::push_heap(nearest.begin(), nearest.end(), closer);
+					}
+				}
+				if (current.second->isLeaf()) continue;
+				current.second->calcChildDistances(x, y, z, looseness, distances);
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					OctTreeNode<T>* child = current.second->octants[oct];
+					if (child != nullptr && !query.isSubtreeIgnored(child)) query.push(child, distances[oct]);
+				}
+			}
+			std::sort_heap(nearest.begin(), nearest.end(), closer);
+			results.insert(results.end(), nearest.begin(), nearest.end());
+			return nearest.size();
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryRadius(const double& x, const double& y, const double& z, const double& radius, std::vector<T>& results) const {
+			size_t first = results.size();
+			if (root->calcMinDistance(x, y, z, looseness) > radius) return 0;
+			ChildDistances distances;
+			vector<OctTreeNode<T>*> stack = { root.get() };
+			while (!stack.empty()) {
+				OctTreeNode<T>* current = stack.back();
+				stack.pop_back();
+				for (auto id : current->getIds()) {
+					const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+					if (calcBoxDistance(x, y, z, bounds.first, bounds.second) <= radius) results.push_back(id);
+				}
+				if (current->isLeaf()) continue;
+				// children are only visited, if they are within the radius
+				current->calcChildDistances(x, y, z, looseness, distances);
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (current->octants[oct] != nullptr && distances[oct] <= radius) stack.push_back(current->octants[oct]);
+				}
+			}
+			// objects spanning several leaves were found several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryBox(const Bounds& lowerBound, const Bounds& upperBound, std::vector<T>& results) const {
+			size_t first = results.size();
+			std::vector<const OctTreeNode<T>*> stack = { root.get() };
+			Bounds lb, ub;
+			while (!stack.empty()) {
+				const OctTreeNode<T>* current = stack.back();
+				stack.pop_back();
+				if (current->getSubtreeIdCount() == 0) continue;
+				calcLooseBounds(current, looseness, lb, ub);
+				if (!isBoxOverlapping(lb, ub, lowerBound, upperBound)) continue;
+				for (auto id : current->getIds()) {
+					const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+					if (isBoxOverlapping(bounds.first, bounds.second, lowerBound, upperBound)) results.push_back(id);
+				}
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (current->octants[oct] != nullptr) stack.push_back(current->octants[oct]);
+				}
+			}
+			// objects spanning several leaves were found several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryRay(const Bounds& origin, const Bounds& direction, const double& maxDistance, NeighborArray<T>& results) {
+			return queryRay(origin, direction, maxDistance, results, *defaultQuery);
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryRay(const Bounds& origin, const Bounds& direction, const double& maxDistance, NeighborArray<T>& results, OctTreeQuery<T>& query) const {
+			size_t first = results.size();
+			RayCollector<T> collector(results);
+			queryRay(origin, direction, maxDistance, IdSet<T>(), collector, query);
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const double OctTree<T>::queryRay(const Bounds& origin, const Bounds& direction, const double& maxDistance, const IdSet<T>& ignoreIDs,
+			RayVisitor<T>& visitor, OctTreeQuery<T>& query) const {
+			double length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+			if (length == 0.0) throw std::runtime_error("Ray direction must not have zero length.");
+			Bounds dir(direction.x / length, direction.y / length, direction.z / length);
+			auto later = [](const Neighbor<T>& lhs, const Neighbor<T>& rhs) { return (lhs.distance != rhs.distance) ? lhs.distance > rhs.distance : lhs.id > rhs.id; };
+			// objects whose bounding boxes the ray enters, the object entered first is on top of the heap
+			NeighborArray<T>& candidates = query.neighbors;
+			// sorted ids of the visited objects
+			std::vector<T>& visited = query.ids;
+			candidates.clear();
+			visited.clear();
+			double nearestHit = POS_INF;
+			query.begin(arena->getIndexCount());
+			markIgnoredIds(ignoreIDs, query);
+			Bounds lb, ub;
+			calcLooseBounds(root.get(), looseness, lb, ub);
+			double rootDistance = calcRayToBoxDistance(origin, dir, lb, ub);
+			if (rootDistance <= maxDistance && !query.isSubtreeIgnored(root.get())) query.push(root.get(), rootDistance);
+			while (!query.isEmpty() || !candidates.empty()) {
+				// an object is visited once no node on the heap is entered before it
+				bool visitObject = !candidates.empty() && (query.isEmpty() || candidates.front().distance <= query.top().first);
+				// nothing entered beyond the nearest hit can be hit closer
+				if ((visitObject ? candidates.front().distance : query.top().first) > nearestHit) break;
+				if (visitObject) {
+					std::pop_heap(candidates.begin(), candidates.end(), later);
+					Neighbor<T> candidate = candidates.back();
+					candidates.pop_back();
+					// objects spanning several leaves are found again by leaves entered after the object itself
+					auto position = std::lower_bound(visited.begin(), visited.end(), candidate.id);
+					if (position != visited.end() && *position == candidate.id) continue;
+					visited.insert(position, candidate.id);
+					nearestHit = std::min(nearestHit, visitor.visit(candidate.id, candidate.distance));
+					continue;
+				}
+				const OctTreeNode<T>* current = query.pop().second;
+				if (query.hasUnignoredIds(current)) {
+					for (auto id : current->getIds()) {
+						if (ignoreIDs.find(id) != ignoreIDs.end()) continue;
+						const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+						double distance = calcRayToBoxDistance(origin, dir, bounds.first, bounds.second);
+						if (distance > maxDistance) continue;
+						candidates.push_back(Neighbor<T>(id, distance));
+						std::push_heap(candidates.begin(), candidates.end(), later);
+					}
+				}
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					OctTreeNode<T>* child = current->octants[oct];
+					if (child == nullptr || child->getSubtreeIdCount() == 0 || query.isSubtreeIgnored(child)) continue;
+					calcLooseBounds(child, looseness, lb, ub);
+					double distance = calcRayToBoxDistance(origin, dir, lb, ub);
+					if (distance <= maxDistance) query.push(child, distance);
+				}
+			}
+			return nearestHit;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryOBB(const OrientedBox& box, std::vector<T>& results) const {
+			size_t first = results.size();
+			std::vector<const OctTreeNode<T>*> stack = { root.get() };
+			Bounds lb, ub;
+			while (!stack.empty()) {
+				const OctTreeNode<T>* current = stack.back();
+				stack.pop_back();
+				if (current->getSubtreeIdCount() == 0) continue;
+				calcLooseBounds(current, looseness, lb, ub);
+				if (!isBoxOverlappingOBB(lb, ub, box)) continue;
+				for (auto id : current->getIds()) {
+					const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+					if (isBoxOverlappingOBB(bounds.first, bounds.second, box)) results.push_back(id);
+				}
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (current->octants[oct] != nullptr) stack.push_back(current->octants[oct]);
+				}
+			}
+			// objects spanning several leaves were found several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryPolytope(const std::vector<Plane>& planes, std::vector<T>& results) const {
+			size_t first = results.size();
+			std::vector<const OctTreeNode<T>*> stack = { root.get() };
+			Bounds lb, ub;
+			while (!stack.empty()) {
+				const OctTreeNode<T>* current = stack.back();
+				stack.pop_back();
+				if (current->getSubtreeIdCount() == 0) continue;
+				calcLooseBounds(current, looseness, lb, ub);
+				if (isBoxOutsidePlanes(lb, ub, planes)) continue;
+				for (auto id : current->getIds()) {
+					const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+					if (!isBoxOutsidePlanes(bounds.first, bounds.second, planes)) results.push_back(id);
+				}
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (current->octants[oct] != nullptr) stack.push_back(current->octants[oct]);
+				}
+			}
+			// objects spanning several leaves were found several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		const size_t OctTree<T>::queryOverlaps(const OctTree<T>& other, const double& margin, std::vector<std::pair<T, T>>& results) const {
+			size_t first = results.size();
+			// pairs of nodes whose sub-trees still have to be compared with each other
+			std::vector<std::pair<const OctTreeNode<T>*, const OctTreeNode<T>*>> stack = { std::make_pair(root.get(), other.root.get()) };
+			Bounds lowerA, upperA, lowerB, upperB;
+			while (!stack.empty()) {
+				const OctTreeNode<T>* a = stack.back().first;
+				const OctTreeNode<T>* b = stack.back().second;
+				stack.pop_back();
+				if (a->getSubtreeIdCount() == 0 || b->getSubtreeIdCount() == 0) continue;
+				calcLooseBounds(a, looseness, lowerA, upperA);
+				calcLooseBounds(b, other.looseness, lowerB, upperB);
+				if (calcBoxToBoxDistance(lowerA, upperA, lowerB, upperB) > margin) continue;
+				if (a->isLeaf() && b->isLeaf()) {
+					for (auto id : a->getIds()) {
+						const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+						for (auto otherId : b->getIds()) {
+							const std::pair<Bounds, Bounds>& otherBounds = other.objectBounds.at(otherId);
+							if (calcBoxToBoxDistance(bounds.first, bounds.second, otherBounds.first, otherBounds.second) <= margin) results.push_back(std::make_pair(id, otherId));
+						}
+					}
+					continue;
+				}
+				// the larger node is split, ids it stores itself (i.e. in a loose tree) are compared with the whole sub-tree of the smaller node
+				Bounds extentA = a->getDiameter();
+				Bounds extentB = b->getDiameter();
+				if (!a->isLeaf() && (b->isLeaf() || extentA.x + extentA.y + extentA.z >= extentB.x + extentB.y + extentB.z)) {
+					for (auto id : a->getIds()) {
+						const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+						collectOverlaps(id, bounds.first, bounds.second, b, other, margin, false, results);
+					}
+					for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+						if (a->octants[oct] != nullptr) stack.push_back(std::make_pair(a->octants[oct], b));
+					}
+				}
+				else {
+					for (auto otherId : b->getIds()) {
+						const std::pair<Bounds, Bounds>& otherBounds = other.objectBounds.at(otherId);
+						other.collectOverlaps(otherId, otherBounds.first, otherBounds.second, a, *this, margin, true, results);
+					}
+					for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+						if (b->octants[oct] != nullptr) stack.push_back(std::make_pair(a, b->octants[oct]));
+					}
+				}
+			}
+			// objects spanning several leaves were paired several times
+			std::sort(results.begin() + first, results.end());
+			results.erase(std::unique(results.begin() + first, results.end()), results.end());
+			return results.size() - first;
+		}
+
+		template <typename T>
+		void OctTree<T>::collectOverlaps(const T& id, const Bounds& lowerBound, const Bounds& upperBound, const OctTreeNode<T>* node, const OctTree<T>& tree,
+			const double& margin, const bool swapped, std::vector<std::pair<T, T>>& results) const {
+			std::vector<const OctTreeNode<T>*> stack = { node };
+			Bounds lb, ub;
+			while (!stack.empty()) {
+				const OctTreeNode<T>* current = stack.back();
+				stack.pop_back();
+				if (current->getSubtreeIdCount() == 0) continue;
+				calcLooseBounds(current, tree.looseness, lb, ub);
+				if (calcBoxToBoxDistance(lowerBound, upperBound, lb, ub) > margin) continue;
+				for (auto otherId : current->getIds()) {
+					const std::pair<Bounds, Bounds>& bounds = tree.objectBounds.at(otherId);
+					if (calcBoxToBoxDistance(lowerBound, upperBound, bounds.first, bounds.second) > margin) continue;
+					results.push_back(swapped ? std::make_pair(otherId, id) : std::make_pair(id, otherId));
+				}
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (current->octants[oct] != nullptr) stack.push_back(current->octants[oct]);
+				}
+			}
+		}
+
+		template <typename T>
+		bool OctTree<T>::insertObject(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound, const unsigned int& depth) {
 			Bounds diameter = node->getDiameter();
 			// recursion anchor
-			if ( (diameter.x <= minDiameter.x) || (diameter.y <= minDiameter.y) || (diameter.z <= minDiameter.z) ) {
-				node->addId(id);
+			bool anchor = (diameter.x <= minDiameter.x) || (diameter.y <= minDiameter.y) || (diameter.z <= minDiameter.z) || (depth >= maxDepth);
+			// leaves with a capacity are only split once they are full
+			if (!anchor && leafCapacity > 0 && node->isLeaf()) {
+				if (node->getIds().size() < leafCapacity || node->getIds().find(id) != node->getIds().end()) anchor = true;
+				else split(node, depth);
+			}
+			if (anchor) {
+				if (node->getIds().find(id) == node->getIds().end()) objectNodes[id].push_back(node);
+				// the node keeps the sphere of the whole object, not only of the part inside of it
+				const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+				node->addId(id, bounds.first, bounds.second);
 				return true;
 			} else {
 				// -> doesn't fit in children -> split up !
-				// 1 find all involved octants
-				unordered_set<Octant> involvedOctants = node->findInvolvedOctants(lowerBound, upperBound);
-				// 2 create missing octants
-				for (auto oct : involvedOctants) {
-					if (oct == Octant::none) continue;
-					if (node->isOctantNull(oct)) {
-						Bounds lb = node->calcChildLowerBounds(oct);
-						Bounds ub = node->calcChildUpperBounds(oct);
-						makeNewOctant(node, lb, ub, oct);
-					}
+				insertIntoChildren(node, id, lowerBound, upperBound, depth);
+				return true;
+			}
+		}
+
+		template <typename T>
+		void OctTree<T>::insertIntoChildren(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound, const unsigned int& depth) {
+			// 1 find all involved octants
+			unordered_set<Octant> involvedOctants = node->findInvolvedOctants(lowerBound, upperBound);
+			// 2 create missing octants
+			for (auto oct : involvedOctants) {
+				if (oct == Octant::none) continue;
+				if (node->isOctantNull(oct)) {
+					Bounds lb = node->calcChildLowerBounds(oct);
+					Bounds ub = node->calcChildUpperBounds(oct);
+					makeNewOctant(node, lb, ub, oct);
 				}
-				// 3 split bounds up 
-				vector<Bounds> ubs;
-				vector<Bounds> lbs;
-				for (auto oct : involvedOctants) {
-					if (oct == Octant::none) continue;
-					lbs.push_back(node->calcPartialLowerBounds(oct, lowerBound));
-					ubs.push_back(node->calcPartialUpperBounds(oct, upperBound));
-					Bounds u = node->calcPartialUpperBounds(oct, upperBound);
-					Bounds l = node->calcPartialLowerBounds(oct, lowerBound);
-				}
-				// 4 call multiple insertNodes recursively
-				unsigned int c = 0;
-				for (auto oct : involvedOctants) {
-					if (oct == Octant::none) continue;
-					insertObject(node->getChild(oct), id, lbs[c], ubs[c]);
-					c++;
+			}
+			// 3 split bounds up 
+			vector<Bounds> ubs;
+			vector<Bounds> lbs;
+			for (auto oct : involvedOctants) {
+				if (oct == Octant::none) continue;
+				lbs.push_back(node->calcPartialLowerBounds(oct, lowerBound));
+				ubs.push_back(node->calcPartialUpperBounds(oct, upperBound));
+			}
+			// 4 call multiple insertNodes recursively
+			unsigned int c = 0;
+			for (auto oct : involvedOctants) {
+				if (oct == Octant::none) continue;
+				insertObject(node->getChild(oct), id, lbs[c], ubs[c], depth + 1);
+				c++;
+			}
+		}
+
+		template <typename T>
+		void OctTree<T>::storeObjectBounds(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			auto bounds = objectBounds.find(id);
+			if (bounds == objectBounds.end()) {
+				objectBounds.insert(std::make_pair(id, std::make_pair(lowerBound, upperBound)));
+				return;
+			}
+			Bounds& lb = bounds->second.first;
+			Bounds& ub = bounds->second.second;
+			lb = Bounds(std::min(lb.x, lowerBound.x), std::min(lb.y, lowerBound.y), std::min(lb.z, lowerBound.z));
+			ub = Bounds(std::max(ub.x, upperBound.x), std::max(ub.y, upperBound.y), std::max(ub.z, upperBound.z));
+			// the nodes that already hold the object have to enclose its enlarged bounds as well
+			auto occupied = objectNodes.find(id);
+			if (occupied == objectNodes.end()) return;
+			for (auto& node : occupied->second) node->addId(id, lb, ub);
+		}
+
+		template <typename T>
+		const unsigned int OctTree<T>::calcLeafDepth() const {
+			Bounds diameter = root->getDiameter();
+			unsigned int depth = 0;
+			while (diameter.x > minDiameter.x && diameter.y > minDiameter.y && diameter.z > minDiameter.z && depth < maxDepth) {
+				diameter = Bounds(diameter.x / 2.0, diameter.y / 2.0, diameter.z / 2.0);
+				depth++;
+			}
+			return depth;
+		}
+
+		template <typename T>
+		void OctTree<T>::insertLooseObject(NodePtr<T> node, const T& id, const Bounds& lowerBound, const Bounds& upperBound, const unsigned int& depth, const bool forceDescent) {
+			double cx = lowerBound.x + (upperBound.x - lowerBound.x) / 2.0;
+			double cy = lowerBound.y + (upperBound.y - lowerBound.y) / 2.0;
+			double cz = lowerBound.z + (upperBound.z - lowerBound.z) / 2.0;
+			NodePtr<T> current = node;
+			unsigned int currentDepth = depth;
+			bool descend = forceDescent;
+			while (true) {
+				Bounds diameter = current->getDiameter();
+				// recursion anchor
+				if ((diameter.x <= minDiameter.x) || (diameter.y <= minDiameter.y) || (diameter.z <= minDiameter.z) || (currentDepth >= maxDepth)) break;
+				// leaves with a capacity are only split once they are full
+				if (!descend && leafCapacity > 0 && current->isLeaf()) {
+					if (current->getIds().size() < leafCapacity || current->getIds().find(id) != current->getIds().end()) break;
+					split(current, currentDepth);
+				}
+				descend = false;
+				// the object's center selects the child, the child's loose bounds have to contain the whole object
+				Octant oct = current->calcOctantOfPoint(cx, cy, cz);
+				Bounds lb = current->calcChildLowerBounds(oct);
+				Bounds ub = current->calcChildUpperBounds(oct);
+				double ex = (looseness - 1.0) * (ub.x - lb.x) / 2.0;
+				double ey = (looseness - 1.0) * (ub.y - lb.y) / 2.0;
+				double ez = (looseness - 1.0) * (ub.z - lb.z) / 2.0;
+				if (lowerBound.x < lb.x - ex || lowerBound.y < lb.y - ey || lowerBound.z < lb.z - ez) break;
+				if (upperBound.x > ub.x + ex || upperBound.y > ub.y + ey || upperBound.z > ub.z + ez) break;
+				if (current->isOctantNull(oct)) makeNewOctant(current, lb, ub, oct);
+				current = current->getChild(oct);
+				currentDepth++;
+			}
+			if (current->getIds().find(id) == current->getIds().end()) objectNodes[id].push_back(current);
+			const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+			current->addId(id, bounds.first, bounds.second);
+		}
+
+		template <typename T>
+		void OctTree<T>::markIgnoredIds(const IdSet<T>& ignoreIDs, OctTreeQuery<T>& query) const {
+			auto mark = [&query](const NodeArray<T>& occupied) {
+				for (auto& node : occupied) {
+					query.markIgnoredId(node->getIndex(), true);
+					for (OctTreeNode<T>* ancestor = node->parent; ancestor != nullptr; ancestor = ancestor->parent) query.markIgnoredId(ancestor->getIndex(), false);
+				}
+			};
+			// walk the smaller one of the ignore set and this tree's objects
+			if (ignoreIDs.size() <= objectNodes.size()) {
+				for (auto& id : ignoreIDs) {
+					auto occupied = objectNodes.find(id);
+					if (occupied != objectNodes.end()) mark(occupied->second);
+				}
+			}
+			else {
+				for (auto& occupied : objectNodes) {
+					if (ignoreIDs.find(occupied.first) != ignoreIDs.end()) mark(occupied.second);
 				}
-			return true;
 			}
 		}
 
 		template <typename T>
 		void OctTree<T>::makeNewOctant(NodePtr<T> parent, const Bounds& lowerBound, const Bounds& upperBound, const Octant& octant) {
-			NodePtr<T> oct = OctTreeNode<T>::createNode();
+			NodePtr<T> oct = arena->allocate();
 			nodes.push_back(oct);
 			oct->setBounds(lowerBound, upperBound);
 			oct->setParent(parent);
 			parent->setChild(oct, octant);
 		}
 
+		template <typename T>
+		void OctTree<T>::split(NodePtr<T> node, const unsigned int& depth) {
+			std::vector<T> ids(node->getIds().begin(), node->getIds().end());
+			for (auto id : ids) {
+				node->removeId(id);
+				NodeArray<T>& occupied = objectNodes[id];
+				occupied.erase(std::remove(occupied.begin(), occupied.end(), node), occupied.end());
+			}
+			const Bounds& nlb = node->getLowerBounds();
+			const Bounds& nub = node->getUpperBounds();
+			for (auto id : ids) {
+				const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+				if (isLoose()) {
+					insertLooseObject(node, id, bounds.first, bounds.second, depth, true);
+					continue;
+				}
+				// only the part of the object inside this node is pushed down
+				Bounds lb(std::max(bounds.first.x, nlb.x), std::max(bounds.first.y, nlb.y), std::max(bounds.first.z, nlb.z));
+				Bounds ub(std::min(bounds.second.x, nub.x), std::min(bounds.second.y, nub.y), std::min(bounds.second.z, nub.z));
+				if (lb.x > ub.x || lb.y > ub.y || lb.z > ub.z) continue;
+				insertIntoChildren(node, id, lb, ub, depth);
+			}
+		}
+
+		template <typename T>
+		void OctTree<T>::collapse(NodePtr<T> node) {
+			NodePtr<T> current = (node->isLeaf()) ? node->getParent() : node;
+			while (current != nullptr) {
+				// only nodes whose children are all leaves are merged
+				IdSet<T> ids = current->getIds();
+				NodeArray<T> children;
+				bool mergeable = true;
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth && mergeable; oct++) {
+					if (current->isOctantNull(static_cast<Octant>(oct))) continue;
+					NodePtr<T> child = current->getChild(static_cast<Octant>(oct));
+					mergeable = child->isLeaf();
+					ids.insert(child->getIds().begin(), child->getIds().end());
+					children.push_back(child);
+				}
+				if (!mergeable || children.empty() || ids.size() >= mergeThreshold) return;
+				for (auto child : children) {
+					for (auto id : child->getIds()) {
+						NodeArray<T>& occupied = objectNodes[id];
+						occupied.erase(std::remove(occupied.begin(), occupied.end(), child), occupied.end());
+					}
+					current->removeChild(child);
+					arena->release(child);
+				}
+				for (auto id : ids) {
+					if (current->getIds().find(id) == current->getIds().end()) objectNodes[id].push_back(current);
+					const std::pair<Bounds, Bounds>& bounds = objectBounds.at(id);
+					current->addId(id, bounds.first, bounds.second);
+				}
+				nodesOutdated = true;
+				current = current->getParent();
+			}
+		}
+
+		template <typename T>
+		NodePtr<T> OctTree<T>::prune(NodePtr<T> node) {
+			while (!node->isRoot() && node->isEmpty() && node->isLeaf()) {
+				NodePtr<T> parent = node->getParent();
+				parent->removeChild(node);
+				arena->release(node);
+				nodesOutdated = true;
+				node = parent;
+			}
+			return node;
+		}
+
 		template <typename T>
 		void OctTree<T>::resize(const Bounds& lowerBound, const Bounds& upperBound) {
 			unsigned int steps = 0;
 			while (!root->isInBounds(lowerBound, upperBound) && steps < MAX_RESIZE_STEPS) {
 				steps++;
-				NodePtr<T> first = root->getChild(Octant::first);
-				NodePtr<T> second = root->getChild(Octant::second);
-				NodePtr<T> third = root->getChild(Octant::third);
-				NodePtr<T> fourth = root->getChild(Octant::fourth);
-				NodePtr<T> fifth = root->getChild(Octant::fifth);
-				NodePtr<T> sixth = root->getChild(Octant::sixth);
-				NodePtr<T> seventh = root->getChild(Octant::seventh);
-				NodePtr<T> eighth = root->getChild(Octant::eighth);
-
 				Bounds rlb = root->getLowerBounds();
 				Bounds rub = root->getUpperBounds();
-				root->setBounds( Bounds(rlb.x*2, rlb.y*2, rlb.z*2), Bounds(rub.x * 2, rub.y * 2, rub.z * 2) );
+				Bounds extent = root->getDiameter();
+				// grow towards the side that lacks more space, the old root becomes the octant on the opposite side
+				bool downX = rlb.x - lowerBound.x > upperBound.x - rub.x;
+				bool downY = rlb.y - lowerBound.y > upperBound.y - rub.y;
+				bool downZ = rlb.z - lowerBound.z > upperBound.z - rub.z;
+				NodePtr<T> grown = arena->allocate();
+				grown->setBounds(Bounds(downX ? rlb.x - extent.x : rlb.x, downY ? rlb.y - extent.y : rlb.y, downZ ? rlb.z - extent.z : rlb.z),
+					Bounds(downX ? rub.x : rub.x + extent.x, downY ? rub.y : rub.y + extent.y, downZ ? rub.z : rub.z + extent.z));
+				grown->setChild(root, MORTON_OCTANTS[(downX ? 1 : 0) | (downY ? 2 : 0) | (downZ ? 4 : 0)]);
+				root->setParent(grown);
+				root = grown;
+				nodesOutdated = true;
+				resizeCount++;
+			}
+		}
 
-				for (unsigned int i = Octant::first; i <= Octant::eighth; i++) {
-					Bounds lb = root->calcChildLowerBounds(static_cast<Octant>(i));
-					Bounds ub = root->calcChildUpperBounds(static_cast<Octant>(i));
-					makeNewOctant(root, lb, ub, static_cast<Octant>(i));
+		template <typename T>
+		void OctTree<T>::shrink() {
+			while (root->isEmpty() && !root->isLeaf()) {
+				NodePtr<T> child = nullptr;
+				unsigned int children = 0;
+				for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+					if (root->isOctantNull(static_cast<Octant>(oct))) continue;
+					child = root->getChild(static_cast<Octant>(oct));
+					children++;
 				}
-				root->getChild(Octant::first)->setChild(first, Octant::seventh);
-				root->getChild(Octant::second)->setChild(second, Octant::eighth);
-				root->getChild(Octant::third)->setChild(third, Octant::fifth);
-				root->getChild(Octant::fourth)->setChild(fourth, Octant::sixth);
-				root->getChild(Octant::fifth)->setChild(fifth, Octant::third);
-				root->getChild(Octant::sixth)->setChild(sixth, Octant::fourth);
-				root->getChild(Octant::seventh)->setChild(seventh, Octant::first);
-				root->getChild(Octant::eighth)->setChild(seventh, Octant::second);
+				if (children != 1) return;
+				root->removeChild(child);
+				child->parent = nullptr;
+				child->root = true;
+				arena->release(root);
+				root = child;
+				nodesOutdated = true;
+				resizeCount++;
 			}
 		}
 
 		template class OctTree<double>;
 		template class OctTree<unsigned int>;
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
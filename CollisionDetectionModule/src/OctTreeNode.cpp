@@ -1,12 +1,33 @@
 #include "..\include\OctTreeNode.h"
 #include <sstream>
+#include <algorithm>
+#include <cmath>
 
 namespace collision {
 	namespace octtree {
 
+		/**
+			\brief Calculate the distances of a coordinate to the lower and upper half of a node's (loose) extent along one axis,
+			performing exactly the operations of OctTreeNode::calcMinDistance on the children's bounds.
+			\param[in] value Coordinate of the query-point along the axis.
+			\param[in] lower Lower bound of the parent along the axis.
+			\param[in] center Upper bound of the lower children and lower bound of the upper children along the axis.
+			\param[in] upper Upper bound of the parent along the axis.
+			\param[in] scale Looseness of the tree minus one, 0.0 for regular bounds.
+			\param[out] distances Distance to the lower half at index 0 and to the upper half at index 1.
+		*/
+		static void calcHalfDistances(const double& value, const double& lower, const double& center, const double& upper, const double& scale, double* distances) {
+			double lowerExpand = scale * std::fabs(center - lower) / 2.0;
+			double upperExpand = scale * std::fabs(upper - center) / 2.0;
+			distances[0] = std::max(std::max(lower - lowerExpand - value, 0.0), value - center - lowerExpand);
+			distances[1] = std::max(std::max(center - upperExpand - value, 0.0), value - upper - upperExpand);
+		}
+
 		template <typename T>
 		NodePtr<T> OctTreeNode<T>::createNode() {
-			return NodePtr<T>(new OctTreeNode<T>());
+			NodePtr<T> node(new OctTreeNode<T>());
+			node->self = node;
+			return node;
 		}
 
 		template <typename T>
@@ -26,24 +47,45 @@ namespace collision {
 
 		template <typename T>
 		const bool OctTreeNode<T>::isOctantNull(const Octant& octant) const {
-			NodePtr<T> oct = octants[octant].lock();
-			return (oct == nullptr);
+			return (octants[octant] == nullptr);
 		}
 
 		template <typename T>
 		void OctTreeNode<T>::setChild(NodePtr<T> child, const Octant& octant) {
-			octants[octant] = child;
+			std::ptrdiff_t delta = 0;
+			if (octants[octant] != nullptr) delta -= octants[octant]->subtreeIds;
+			if (child != nullptr) delta += child->subtreeIds;
+			octants[octant] = child.get();
 			leaf = false;
+			if (delta != 0) countSubtreeIds(delta);
 		}
 
 		template <typename T>
 		NodePtr<T> OctTreeNode<T>::getChild(const Octant& octant) {
-			return octants[octant].lock();
+			OctTreeNode<T>* child = octants[octant];
+			return (child == nullptr) ? nullptr : child->self.lock();
+		}
+
+		template <typename T>
+		void OctTreeNode<T>::removeChild(const NodePtr<T>& child) {
+			leaf = true;
+			for (auto& octant : octants) {
+				if (octant == child.get()) {
+					octant = nullptr;
+					if (child->subtreeIds > 0) countSubtreeIds(-static_cast<std::ptrdiff_t>(child->subtreeIds));
+				}
+				if (octant != nullptr) leaf = false;
+			}
+		}
+
+		template <typename T>
+		NodePtr<T> OctTreeNode<T>::getParent() {
+			return (parent == nullptr) ? nullptr : parent->self.lock();
 		}
 
 		template <typename T>
 		void OctTreeNode<T>::setParent(NodePtr<T> parent) {
-			this->parent = parent;
+			this->parent = parent.get();
 			root = false;
 		}
 
@@ -51,44 +93,36 @@ namespace collision {
 		void OctTreeNode<T>::setBounds(const Bounds& lowerBound, const Bounds& upperBound) {
 			lower = lowerBound;
 			upper = upperBound;
-
-			x = lower.x + (upper.x - lower.x) / 2.0;
-			y = lower.y + (upper.y - lower.y) / 2.0;
-			z = lower.z + (upper.z - lower.z) / 2.0;
-
-			width = std::fabs(upper.x - lower.x);
-			height = std::fabs(upper.y - lower.y);
-			length = std::fabs(upper.z - lower.z);
 		}
 
 		template <typename T>
-		const double& OctTreeNode<T>::getX() const {
-			return x;
+		const double OctTreeNode<T>::getX() const {
+			return static_cast<double>(lower.x) + (static_cast<double>(upper.x) - lower.x) / 2.0;
 		}
 
 		template <typename T>
-		const double& OctTreeNode<T>::getY() const {
-			return y;
+		const double OctTreeNode<T>::getY() const {
+			return static_cast<double>(lower.y) + (static_cast<double>(upper.y) - lower.y) / 2.0;
 		}
 
 		template <typename T>
-		const double& OctTreeNode<T>::getZ() const {
-			return z;
+		const double OctTreeNode<T>::getZ() const {
+			return static_cast<double>(lower.z) + (static_cast<double>(upper.z) - lower.z) / 2.0;
 		}
 
 		template <typename T>
-		const Bounds& OctTreeNode<T>::getLowerBounds() const {
+		const Bounds OctTreeNode<T>::getLowerBounds() const {
 			return lower;
 		}
 
 		template <typename T>
-		const Bounds& OctTreeNode<T>::getUpperBounds() const {
+		const Bounds OctTreeNode<T>::getUpperBounds() const {
 			return upper;
 		}
 
 		template <typename T>
 		const Bounds OctTreeNode<T>::getDiameter() const {
-			return Bounds(width, height, length);
+			return Bounds(std::fabs(static_cast<double>(upper.x) - lower.x), std::fabs(static_cast<double>(upper.y) - lower.y), std::fabs(static_cast<double>(upper.z) - lower.z));
 		}
 
 		template <typename T>
@@ -125,6 +159,7 @@ namespace collision {
 
 		template <typename T>
 		const Bounds OctTreeNode<T>::calcChildLowerBounds(const Octant& octant) const {
+			double x = getX(), y = getY(), z = getZ();
 			switch (octant) {
 			case Octant::first: {
 				//first octant (+,+,+)
@@ -168,6 +203,7 @@ namespace collision {
 
 		template <typename T>
 		const Bounds OctTreeNode<T>::calcChildUpperBounds(const Octant& octant) const {
+			double x = getX(), y = getY(), z = getZ();
 			switch (octant) {
 			case Octant::first: {
 				//first octant (+,+,+)
@@ -211,6 +247,7 @@ namespace collision {
 
 		template <typename T>
 		const Bounds OctTreeNode<T>::calcPartialLowerBounds(const Octant& octant, const Bounds& lowerBound) const {
+			double x = getX(), y = getY(), z = getZ();
 			double lbx, lby, lbz;
 
 			switch (octant) {
@@ -281,6 +318,7 @@ namespace collision {
 
 		template <typename T>
 		const Bounds OctTreeNode<T>::calcPartialUpperBounds(const Octant& octant, const Bounds& upperBound) const {
+			double x = getX(), y = getY(), z = getZ();
 			double ubx, uby, ubz;
 
 			switch (octant) {
@@ -350,6 +388,7 @@ namespace collision {
 
 		template <typename T>
 		const Octant OctTreeNode<T>::calcOctantOfBounds(const Bounds& lowerBound, const Bounds& upperBound) const {
+			double x = getX(), y = getY(), z = getZ();
 			//first octant (+,+,+)
 			if (lowerBound.x >= x && lowerBound.y >= y && lowerBound.z >= z) return Octant::first;
 			//second octant (-,+,+)
@@ -371,21 +410,22 @@ namespace collision {
 
 		template <typename T>
 		const Octant OctTreeNode<T>::calcOctantOfPoint(const double& x, const double& y, const double& z) const {
+			double cx = getX(), cy = getY(), cz = getZ();
 
 			//first octant (+,+,+)
-			if (x >= this->x && y >= this->y && z >= this->z) return Octant::first;
+			if (x >= cx && y >= cy && z >= cz) return Octant::first;
 			//second octant (-,+,+)
-			else if (x < this->x && y >= this->y && z >= this->z) return Octant::second;
+			else if (x < cx && y >= cy && z >= cz) return Octant::second;
 			//third octant (-,-,+)
-			else if (x < this->x && y < this->y && z >= this->z) return Octant::third;
+			else if (x < cx && y < cy && z >= cz) return Octant::third;
 			//fourth octant (+,-,+)
-			else if (x >= this->x && y < this->y && z >= this->z) return Octant::fourth;
+			else if (x >= cx && y < cy && z >= cz) return Octant::fourth;
 			//fifth octant (+,+,-)
-			else if (x >= this->x && y >= this->y && z < this->z) return Octant::fifth;
+			else if (x >= cx && y >= cy && z < cz) return Octant::fifth;
 			//sixth octant (-,+,-)
-			else if (x < this->x && y >= this->y && z < this->z) return Octant::sixth;
+			else if (x < cx && y >= cy && z < cz) return Octant::sixth;
 			//seventh octant (-,-,-)
-			else if (x < this->x && y < this->y && z < this->z) return Octant::seventh;
+			else if (x < cx && y < cy && z < cz) return Octant::seventh;
 			//eigth octant (+,-,-)
 			else return Octant::eighth;
 		}
@@ -427,14 +467,84 @@ namespace collision {
 		}
 
 		template <typename T>
-		void OctTreeNode<T>::addId(const T& id) {
-			ids.insert(id);
+		const double OctTreeNode<T>::calcMinDistance(const double& x, const double& y, const double& z, const double& looseness) const {
+			if (looseness <= 1.0) return calcMinDistance(x, y, z);
+			Bounds diameter = getDiameter();
+			double ex = (looseness - 1.0) * diameter.x / 2.0;
+			double ey = (looseness - 1.0) * diameter.y / 2.0;
+			double ez = (looseness - 1.0) * diameter.z / 2.0;
+			double dx = std::max(std::max(lower.x - ex - x, 0.0), x - upper.x - ex);
+			double dy = std::max(std::max(lower.y - ey - y, 0.0), y - upper.y - ey);
+			double dz = std::max(std::max(lower.z - ez - z, 0.0), z - upper.z - ez);
+			return std::sqrt(dx*dx + dy * dy + dz * dz);
+		}
+
+		template <typename T>
+		void OctTreeNode<T>::calcChildDistances(const double& x, const double& y, const double& z, const double& looseness, ChildDistances& distances) const {
+			// children split their parent at its center, i.e. each axis only has two intervals and the children are not touched
+			double scale = (looseness > 1.0) ? looseness - 1.0 : 0.0;
+			double dx[2], dy[2], dz[2];
+			calcHalfDistances(x, lower.x, static_cast<NodeScalar>(getX()), upper.x, scale, dx);
+			calcHalfDistances(y, lower.y, static_cast<NodeScalar>(getY()), upper.y, scale, dy);
+			calcHalfDistances(z, lower.z, static_cast<NodeScalar>(getZ()), upper.z, scale, dz);
+			double dxx[2] = { dx[0] * dx[0], dx[1] * dx[1] }, dyy[2] = { dy[0] * dy[0], dy[1] * dy[1] }, dzz[2] = { dz[0] * dz[0], dz[1] * dz[1] };
+			//first octant (+,+,+)
+			distances[Octant::first] = std::sqrt(dxx[1] + dyy[1] + dzz[1]);
+			//second octant (-,+,+)
+			distances[Octant::second] = std::sqrt(dxx[0] + dyy[1] + dzz[1]);
+			//third octant (-,-,+)
+			distances[Octant::third] = std::sqrt(dxx[0] + dyy[0] + dzz[1]);
+			//fourth octant (+,-,+)
+			distances[Octant::fourth] = std::sqrt(dxx[1] + dyy[0] + dzz[1]);
+			//fifth octant (+,+,-)
+			distances[Octant::fifth] = std::sqrt(dxx[1] + dyy[1] + dzz[0]);
+			//sixth octant (-,+,-)
+			distances[Octant::sixth] = std::sqrt(dxx[0] + dyy[1] + dzz[0]);
+			//seventh octant (-,-,-)
+			distances[Octant::seventh] = std::sqrt(dxx[0] + dyy[0] + dzz[0]);
+			//eigth octant (+,-,-)
+			distances[Octant::eighth] = std::sqrt(dxx[1] + dyy[0] + dzz[0]);
+		}
+
+		template <typename T>
+		void OctTreeNode<T>::addId(const T& id, const Bounds& lowerBound, const Bounds& upperBound) {
+			if (ids.insert(id, ObjectSphere(lowerBound, upperBound))) countSubtreeIds(1);
 			empty = false;
 		}
 
 		template <typename T>
-		const IdSet<T>& OctTreeNode<T>::getIds() const {
-			return ids;
+		const bool OctTreeNode<T>::removeId(const T& id) {
+			bool removed = ids.erase(id);
+			empty = (ids.size() == 0);
+			if (removed) countSubtreeIds(-1);
+			return removed;
+		}
+
+		template <typename T>
+		const IdSpan<T> OctTreeNode<T>::getIds() const {
+			return ids.getSpan();
+		}
+
+		template <typename T>
+		const ObjectSphere* OctTreeNode<T>::getSpheres() const {
+			return ids.getSpheres();
+		}
+
+		template <typename T>
+		const unsigned int& OctTreeNode<T>::getSubtreeIdCount() const {
+			return subtreeIds;
+		}
+
+		template <typename T>
+		const size_t& OctTreeNode<T>::getIndex() const {
+			return index;
+		}
+
+		template <typename T>
+		void OctTreeNode<T>::countSubtreeIds(const std::ptrdiff_t& delta) {
+			for (OctTreeNode<T>* node = this; node != nullptr; node = node->parent) {
+				node->subtreeIds = static_cast<unsigned int>(node->subtreeIds + delta);
+			}
 		}
 
 		template <typename T>
@@ -444,32 +554,33 @@ namespace collision {
 			ss << " Node is " << ((root) ? std::string("root") : std::string("not Root")) << " , is " << ((empty) ? std::string("empty") : std::string("not empty"))
 				<< " and is " << ((leaf) ? std::string("leaf") : std::string("not leaf")) << ".\n";
 			ss << " This Node contains " << ids.size() << " ids, which are:\n";
-			for (auto id : ids) {
+			for (auto id : ids.getSpan()) {
 				ss << " ID: " << id << "\n";
 			}
 			ss << " Upper Bounds are: x=" << upper.x << ", y=" << upper.y << ", z=" << upper.z << "\n";
 			ss << " Lower Bounds are: x=" << lower.x << ", y=" << lower.y << ", z=" << lower.z << "\n";
-			ss << " Center lies in: x=" << x << ", y=" << y << ", z=" << z << "\n";
-			ss << " Width is: " << width << ", Height is: " << height << ", Length is: " << length << "\n";
+			ss << " Center lies in: x=" << getX() << ", y=" << getY() << ", z=" << getZ() << "\n";
+			ss << " Width is: " << getDiameter().x << ", Height is: " << getDiameter().y << ", Length is: " << getDiameter().z << "\n";
 			ss << "++++++++++++++++\n";
 			return ss.str();
 		}
 
 		template <typename T>
 		OctTreeNode<T>::OctTreeNode() {
-			parent = WeakNodePtr<T>();
-			octants = Octants<T>(8);
+			parent = nullptr;
+			self = WeakNodePtr<T>();
+			octants.fill(nullptr);
 			root = true;
 			empty = true;
 			leaf = true;
 			lower = Bounds(0, 0, 0);
 			upper = Bounds(0, 0, 0);
-			ids = IdSet<T>();
-			x = y = z = 0;
-			width = height = length = 0;
+			ids = IdStorage<T>();
+			subtreeIds = 0;
+			index = 0;
 		}
 
 		template class OctTreeNode<unsigned int>;
 		template class OctTreeNode<double>;
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
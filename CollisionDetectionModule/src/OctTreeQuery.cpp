@@ -0,0 +1,99 @@
+#include "..\include\OctTreeQuery.h"
+#include <algorithm>
+
+namespace collision {
+	namespace octtree {
+
+		/**
+			\brief Order of the heap entries, such that the entry with the smallest distance is on top.
+			Only distances are compared, i.e. equally distant nodes are popped in the same order as by a std::priority_queue.
+		*/
+		template <typename T>
+		static bool isFarther(const std::pair<double, OctTreeNode<T>*>& lhs, const std::pair<double, OctTreeNode<T>*>& rhs) {
+			return lhs.first > rhs.first;
+		}
+
+		template <typename T>
+		OctTreeQuery<T>::OctTreeQuery() {
+			heap = std::vector<std::pair<double, OctTreeNode<T>*>>();
+			stamp = 0;
+			stamps = std::vector<size_t>();
+			ignoredIds = std::vector<size_t>();
+			ignoredSubtreeIds = std::vector<size_t>();
+			neighbors = NeighborArray<T>();
+			ids = std::vector<T>();
+		}
+
+		template <typename T>
+		QueryPtr<T> OctTreeQuery<T>::create() {
+			return QueryPtr<T>(new OctTreeQuery<T>());
+		}
+
+		template <typename T>
+		void OctTreeQuery<T>::reserve(const size_t& nodeCount) {
+			heap.reserve(nodeCount);
+			if (stamps.size() < nodeCount) {
+				stamps.resize(nodeCount, 0);
+				ignoredIds.resize(nodeCount, 0);
+				ignoredSubtreeIds.resize(nodeCount, 0);
+			}
+		}
+
+		template <typename T>
+		void OctTreeQuery<T>::begin(const size_t& nodeCount) {
+			heap.clear();
+			stamp++;
+			if (stamps.size() < nodeCount) reserve(nodeCount);
+		}
+
+		template <typename T>
+		void OctTreeQuery<T>::push(OctTreeNode<T>* node, const double& distance) {
+			heap.push_back(std::make_pair(distance, node));
+			std::push_heap(heap.begin(), heap.end(), isFarther<T>);
+		}
+
+		template <typename T>
+		const std::pair<double, OctTreeNode<T>*> OctTreeQuery<T>::pop() {
+			std::pop_heap(heap.begin(), heap.end(), isFarther<T>);
+			std::pair<double, OctTreeNode<T>*> nearest = heap.back();
+			heap.pop_back();
+			return nearest;
+		}
+
+		template <typename T>
+		const std::pair<double, OctTreeNode<T>*>& OctTreeQuery<T>::top() const {
+			return heap.front();
+		}
+
+		template <typename T>
+		const bool OctTreeQuery<T>::isEmpty() const {
+			return heap.empty();
+		}
+
+		template <typename T>
+		void OctTreeQuery<T>::markIgnoredId(const size_t& index, const bool own) {
+			if (stamps[index] != stamp) {
+				stamps[index] = stamp;
+				ignoredIds[index] = 0;
+				ignoredSubtreeIds[index] = 0;
+			}
+			if (own) ignoredIds[index]++;
+			ignoredSubtreeIds[index]++;
+		}
+
+		template <typename T>
+		const bool OctTreeQuery<T>::hasUnignoredIds(const OctTreeNode<T>* node) const {
+			size_t index = node->getIndex();
+			return node->getIds().size() > ((stamps[index] == stamp) ? ignoredIds[index] : 0);
+		}
+
+		template <typename T>
+		const bool OctTreeQuery<T>::isSubtreeIgnored(const OctTreeNode<T>* node) const {
+			size_t index = node->getIndex();
+			return node->getSubtreeIdCount() == ((stamps[index] == stamp) ? ignoredSubtreeIds[index] : 0);
+		}
+
+		template class OctTreeQuery<unsigned int>;
+		template class OctTreeQuery<double>;
+	}
+}
@@ -89,6 +89,13 @@ namespace simobj {
 		*/
 		const unsigned long& getId() const;
 
+		/**
+			\brief Get the version of this object, which is increased whenever its local position or orientation is changed.
+			\returns The objects version as unsigned long.
+			\note Global coordinates of an object also change with the position and orientation of its parent, e.g. its cluster.
+		*/
+		const unsigned long& getVersion() const;
+
 		/**
 		\brief Rotates this object locally.
 		\param[in] rotation Quaternion with which this object should be rotated.
@@ -127,6 +134,9 @@ namespace simobj {
 		/*This objects local orientation as quaternion.*/
 		Quaternion orientation;
 
+		/*This objects version, increased on every change of its local position or orientation.*/
+		unsigned long version;
+
 		/** \brief Constructor
 			\param[in] id Unique identifier of this object (used for reference in the simulation)
 			\param[in] type Defines the type of this object (used to generate objects from a template)
@@ -4,6 +4,7 @@ namespace simobj {
 	SimulationObject::SimulationObject(const unsigned long& id, const string& type) : type(type), id(id) {
 		orientation = Quaternion::Identity();
 		position = Vector3d::Zero();
+		version = 0;
 	}
 	SimulationObject::~SimulationObject() {
 	}
@@ -16,6 +17,10 @@ namespace simobj {
 		return id;
 	}
 
+	const unsigned long& SimulationObject::getVersion() const {
+		return version;
+	}
+
 	const Quaternion& SimulationObject::getOrientation() const {
 		return orientation;
 	}
@@ -26,17 +31,21 @@ namespace simobj {
 
 	void SimulationObject::rotate(const Quaternion& rotation) {
 		orientation = orientation * rotation;
+		version++;
 	}
 
 	void SimulationObject::move(const Vector3d& translation) {
 		position = position + translation;
+		version++;
 	}
 
 	void SimulationObject::setOrientation(const Quaternion& orientation) {
 		this->orientation = orientation;
+		version++;
 	}
 
 	void SimulationObject::setPosition(const Vector3d& position) {
 		this->position = position;
+		version++;
 	}
 }
\ No newline at end of file
@@ -2,19 +2,66 @@
 
 #include "..\include\TestBench.h"
 
+namespace collision {
+	namespace octtree {
+		class Bounds;
+
+		template <typename T>
+		class ObjectEntry;
+	}
+}
+
 namespace tests {
 	class OctTreeTestBench : public TestBench {
 	public:
 		OctTreeTestBench(bool showVisualization) : TestBench(showVisualization) {};
 		virtual void setup();
 		virtual void runAllTests();
+		void benchmarkOctTreeBuild();
+		void benchmarkOctTreeNearest();
 	private:
+		static vector<collision::octtree::ObjectEntry<unsigned int>> makeScatteredObjects(const unsigned int& count, const collision::octtree::Bounds& origin,
+			const collision::octtree::Bounds& scale, const double& frequencyX, const double& frequencyY, const double& radius,
+			const double& radiusStep = 0.0, const unsigned int& radiusPeriod = 1);
+
 		void testOctTreeConstrution_setup();
 		void testOctTreeNearestSearch_setup();
 		void testOctTreeCollision_setup();
+		void testLinearOctTreeNearestSearch_setup();
+		void testCollisionDetectionSync_setup();
+		void testClusterCollision_setup();
+		void testRaycast_setup();
+		void testOctTreeRegionQueries_setup();
+		void testOctTreeFreeze_setup();
+		void testBackgroundRebuild_setup();
+		void testOctTreeLeafSpheres_setup();
 
 		void testOctTreeConstrution();
 		void testOctTreeNearestSearch();
 		void testOctTreeCollision();
+		void testLinearOctTreeNearestSearch();
+		void testOctTreeUpdate();
+		void testLooseOctTree();
+		void testOctTreeLeafCapacity();
+		void testOctTreeBulkLoad();
+		void testOctTreeParallelBuild();
+		void testOctTreeKNearest();
+		void testOctTreeRangeQueries();
+		void testOctTreeIgnoreFilter();
+		void testOctTreeQueryContext();
+		void testOctTreeIdStorage();
+		void testOctTreeGrowth();
+		void testOctTreeNodeGeometry();
+		void testOctTreeChildDistances();
+		void testCollisionDetectionSync();
+		void testOctTreeSnapshot();
+		void testOctTreeStats();
+		void testOctTreeOverlaps();
+		void testClusterCollision();
+		void testRaycast();
+		void testOctTreeRegionQueries();
+		void testOctTreeFreeze();
+		void testBackgroundRebuild();
+		void testOctTreeLeafSpheres();
 	};
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -2,6 +2,11 @@
 #include "..\include\TestUtilities.h"
 
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <atomic>
 #include <MetaSpecification.h>
 #include <CLibCollisionController.h>
 #include <Shape.h>
@@ -11,6 +16,10 @@
 #include <AgentCluster.h>
 #include <OctTree.h>
 #include <OctTreeNode.h>
+#include <LinearOctTree.h>
+#include <NodeArena.h>
+#include <OctTreeQuery.h>
+#include <MappedOctTree.h>
 
 namespace tests {
 
@@ -27,13 +36,63 @@ namespace tests {
 	using collision::octtree::OctTreeNode;
 	using collision::octtree::TreePtr;
 	using collision::octtree::NodePtr;
+	using collision::octtree::LinearOctTree;
+	using collision::octtree::LinearTreePtr;
 	using collision::octtree::IdSet;
+	using collision::octtree::Octant;
+	using collision::octtree::AllocationStats;
+	using collision::octtree::NODE_SLAB_SIZE;
+	using collision::octtree::Bounds;
+	using collision::octtree::ObjectEntry;
+	using collision::octtree::ObjectArray;
+	using collision::octtree::Neighbor;
+	using collision::octtree::NeighborArray;
+	using collision::octtree::OrientedBox;
+	using collision::octtree::Plane;
+	using collision::octtree::OctTreeQuery;
+	using collision::octtree::QueryPtr;
+	using collision::octtree::IdSpan;
+	using collision::octtree::INLINE_ID_COUNT;
+	using collision::octtree::NodeBounds;
+	using collision::octtree::ObjectSphere;
+	using collision::octtree::NodeScalar;
+	using collision::octtree::ChildDistances;
+	using collision::octtree::MappedOctTree;
+	using collision::octtree::MappedTreePtr;
+	using collision::octtree::MappedOctTreeQuery;
+	using collision::octtree::MappedQueryPtr;
+	using collision::octtree::SnapshotHeader;
+	using collision::octtree::SnapshotNode;
+	using collision::octtree::TreeStats;
 
 	using namespace clib;
 
 	using Eigen::Vector3d;
 	using utils::Quaternion;
 
+	/**
+		\brief Narrow-phase of the raycast test, which hits every object where the ray enters its bounding box and counts its calls.
+	*/
+	class CountingRayVisitor : public collision::octtree::RayVisitor<unsigned int> {
+	public:
+		size_t visits = 0;
+		virtual const double visit(const unsigned int& id, const double& distance) { visits++; return distance; };
+	};
+
+	ObjectArray<unsigned int> OctTreeTestBench::makeScatteredObjects(const unsigned int& count, const Bounds& origin, const Bounds& scale,
+		const double& frequencyX, const double& frequencyY, const double& radius, const double& radiusStep, const unsigned int& radiusPeriod) {
+		ObjectArray<unsigned int> objects;
+		objects.reserve(count);
+		for (unsigned int i = 0; i < count; i++) {
+			double x = origin.x + scale.x * std::sin(frequencyX * i);
+			double y = origin.y + scale.y * std::cos(frequencyY * i);
+			double z = origin.z + scale.z * i;
+			double r = radius + radiusStep * (i % radiusPeriod);
+			objects.push_back(ObjectEntry<unsigned int>(i, Bounds(x - r, y - r, z - r), Bounds(x + r, y + r, z + r)));
+		}
+		return objects;
+	}
+
 	void OctTreeTestBench::testOctTreeConstrution_setup() {
 		//setup
 		SiteSpecArray ssa;
@@ -76,6 +135,123 @@ namespace tests {
 		CLibController["Collision-Test"]->setMinimalLeafDiameter(2.0);
 	}
 
+	void OctTreeTestBench::testLinearOctTreeNearestSearch_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		ssa.push_back(clib::createSiteSpecification(1, 1, M_PI / 2, M_PI * 3.0 / 4.0, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Linear-Search-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Linear-Search-Test"]->setInitialRootDiameter(4.0);
+		CLibController["Linear-Search-Test"]->setMinimalLeafDiameter(2.0);
+		CLibController["Linear-Search-Test"]->getCollisionDetector().setUseLinearTrees(true);
+	}
+
+	void OctTreeTestBench::testCollisionDetectionSync_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		ssa.push_back(clib::createSiteSpecification(1, 1, M_PI / 2, M_PI, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Sync-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Sync-Test"]->setInitialRootDiameter(4.0);
+		CLibController["Sync-Test"]->setMinimalLeafDiameter(2.0);
+	}
+
+	void OctTreeTestBench::testClusterCollision_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		ssa.push_back(clib::createSiteSpecification(1, 1, M_PI / 2, M_PI, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Cluster-Collision-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Cluster-Collision-Test"]->setInitialRootDiameter(4.0);
+		CLibController["Cluster-Collision-Test"]->setMinimalLeafDiameter(2.0);
+		asa.clear();
+		asa.push_back(clib::createAgentSpecification("CylinderAgent", CLibCollisionController::createShape(ShapeType::Cylinder, 0.5, 2.0), ssa));
+		asa.push_back(clib::createAgentSpecification("SmallSphereAgent", CLibCollisionController::createShape(ShapeType::Sphere, 0.01), ssa));
+		meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Rotated-Cluster-Collision-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Rotated-Cluster-Collision-Test"]->setInitialRootDiameter(4.0);
+		CLibController["Rotated-Cluster-Collision-Test"]->setMinimalLeafDiameter(2.0);
+	}
+
+	void OctTreeTestBench::testRaycast_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		asa.push_back(clib::createAgentSpecification("CylinderAgent", shapes["shapes1"][1], ssa));
+		asa.push_back(clib::createAgentSpecification("EllipsoidAgent", CLibCollisionController::createShape(ShapeType::Ellipsoid, 1.0, 2.0, 3.0), ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Raycast-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Raycast-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Raycast-Test"]->setMinimalLeafDiameter(2.0);
+		asa.clear();
+		asa.push_back(clib::createAgentSpecification("CylinderAgent", CLibCollisionController::createShape(ShapeType::Cylinder, 0.5, 2.0), ssa));
+		meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Rotated-Raycast-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Rotated-Raycast-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Rotated-Raycast-Test"]->setMinimalLeafDiameter(2.0);
+	}
+
+	void OctTreeTestBench::testOctTreeRegionQueries_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		asa.push_back(clib::createAgentSpecification("CylinderAgent", shapes["shapes1"][1], ssa));
+		asa.push_back(clib::createAgentSpecification("EllipsoidAgent", CLibCollisionController::createShape(ShapeType::Ellipsoid, 1.0, 2.0, 3.0), ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Region-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Region-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Region-Test"]->setMinimalLeafDiameter(2.0);
+		asa.clear();
+		asa.push_back(clib::createAgentSpecification("CylinderAgent", CLibCollisionController::createShape(ShapeType::Cylinder, 0.5, 2.0), ssa));
+		asa.push_back(clib::createAgentSpecification("SmallSphereAgent", CLibCollisionController::createShape(ShapeType::Sphere, 0.01), ssa));
+		meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Rotated-Region-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Rotated-Region-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Rotated-Region-Test"]->setMinimalLeafDiameter(2.0);
+	}
+
+	void OctTreeTestBench::testOctTreeFreeze_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Freeze-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Freeze-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Freeze-Test"]->setMinimalLeafDiameter(2.0);
+	}
+
+	void OctTreeTestBench::testOctTreeLeafSpheres_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Leaf-Sphere-Test", std::make_shared<CLibCollisionController>(meta)));
+		// leaves are large, so that each of them holds many agents
+		CLibController["Leaf-Sphere-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Leaf-Sphere-Test"]->setMinimalLeafDiameter(8.0);
+	}
+
+	void OctTreeTestBench::testBackgroundRebuild_setup() {
+		SiteSpecArray ssa;
+		ssa.push_back(clib::createSiteSpecification(0, 1, M_PI / 2, 0, CoordinateType::ParametricPointerToHull));
+		AgentSpecArray asa;
+		asa.push_back(clib::createAgentSpecification("SphereAgent", shapes["shapes1"][0], ssa));
+		MetaSpecification meta = clib::createMetaSpecification(asa);
+		CLibController.insert(std::make_pair("Rebuild-Test", std::make_shared<CLibCollisionController>(meta)));
+		CLibController["Rebuild-Test"]->setInitialRootDiameter(32.0);
+		CLibController["Rebuild-Test"]->setMinimalLeafDiameter(2.0);
+	}
+
 	void OctTreeTestBench::setup() {
 		vector<ShapePtr> shapeArray;
 		shapeArray.push_back(CLibCollisionController::createShape(ShapeType::Sphere, 1.0));
@@ -85,6 +261,14 @@ namespace tests {
 		testOctTreeConstrution_setup();
 		testOctTreeNearestSearch_setup();
 		testOctTreeCollision_setup();
+		testLinearOctTreeNearestSearch_setup();
+		testCollisionDetectionSync_setup();
+		testClusterCollision_setup();
+		testRaycast_setup();
+		testOctTreeRegionQueries_setup();
+		testOctTreeFreeze_setup();
+		testBackgroundRebuild_setup();
+		testOctTreeLeafSpheres_setup();
 	}
 
 	void OctTreeTestBench::testOctTreeConstrution() {
@@ -113,6 +297,10 @@ namespace tests {
 			std::cout << e.what() << std::endl;
 		}
 		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto tree = cc.getCollisionDetector().getOctTree(0);
+		const AllocationStats& stats = tree->getAllocationStats();
+		BOOST_TEST(stats.nodeCount == tree->getNodes().size());
+		BOOST_TEST(stats.slabCount == (stats.nodeCount + NODE_SLAB_SIZE - 1) / NODE_SLAB_SIZE);
 		if (showVisualization) BOOST_TEST(cc.displayClusterCollisionTree(0) == true);
 	}
 
@@ -143,7 +331,7 @@ namespace tests {
 
 		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
 		auto& cd = cc.getCollisionDetector();
-		auto tree = cd.getTree(0);
+		auto tree = cd.getOctTree(0);
 		// Test1
 		auto node = tree->getNearest(1, 1, 0);
 		auto ids = node->getIds();
@@ -221,7 +409,7 @@ namespace tests {
 		BOOST_TEST(nearestDistance == (std::sqrt(2) - 2), "\n Error in Collision Test 1.2 Expexted distance " << (std::sqrt(2) - 2) << "but received " << nearestDistance);
 		ignoreIDs = { 0,1 };
 		BOOST_TEST(cd.checkForCollision(cluster, ignoreIDs, candidate, nearest, nearestDistance) == false, "\n Error in Collision Test 1.3 Collision not expected, but collision occured!");
-		BOOST_TEST((nearest->getId() == 4) == true, "\n Error in Collision Test 1.3 Expexted candidate " << 4 << " but received " << nearest->getId());
+		BOOST_TEST((nearest->getId() == 7) == true, "\n Error in Collision Test 1.3 Expexted candidate " << 7 << " but received " << nearest->getId());
 		candidate->setPosition(Vector3d(1, 1, 6));
 		ignoreIDs = {};
 		BOOST_TEST(cd.checkForCollision(cluster, ignoreIDs, candidate, nearest, nearestDistance) == false, "\n Error in Collision Test 1.4 Collision not expected, but collision occured!");
@@ -353,9 +541,1356 @@ namespace tests {
 		BOOST_TEST((nearest->getId() == 10) == true, "\n Error in Collision Test 3.3.8 Expexted candidate " << 10 << " but received " << nearest->getId());
 	}
 
+	void OctTreeTestBench::testLinearOctTreeNearestSearch() {
+		CLibCollisionController& cc = *CLibController["Linear-Search-Test"];
+		BOOST_TEST(cc.createAgent(0, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(1, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(2, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(3, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(4, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(5, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(6, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(7, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(8, "SphereAgent") == true);
+
+		try {
+			cc.connectAgents(0, 1, 0, 1);
+			cc.connectAgents(1, 2, 0, 1);
+			cc.connectAgents(2, 3, 0, 1);
+			cc.connectAgents(3, 4, 0, 1);
+			cc.connectAgents(4, 5, 0, 1);
+			cc.connectAgents(5, 6, 0, 1);
+			cc.connectAgents(6, 7, 0, 1);
+
+		}
+		catch (std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
+
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		auto tree = cd.getLinearTree(0);
+		// Test1
+		auto leaf = tree->getNearest(1, 1, 0);
+		IdSet<unsigned int> ids(leaf.begin(), leaf.end());
+		IdSet<unsigned int> requiredIds = { 0,1 };
+		utils::checkRequiredIds(ids, requiredIds, "\"Find nearest linear Node - Test1\"");
+		// Test2
+		leaf = tree->getNearest(5, 1, 1);
+		ids = IdSet<unsigned int>(leaf.begin(), leaf.end());
+		requiredIds = { 2 };
+		utils::checkRequiredIds(ids, requiredIds, "\"Find nearest linear Node - Test2\"");
+		// Test3
+		leaf = tree->getNearest(1, 10, 3);
+		ids = IdSet<unsigned int>(leaf.begin(), leaf.end());
+		requiredIds = { 4,5 };
+		utils::checkRequiredIds(ids, requiredIds, "\"Find nearest linear Node - Test3\"");
+		// Test4
+		auto cluster = std::static_pointer_cast<AgentCluster>(cc.getAgentCluster(0));
+		auto candidate = std::static_pointer_cast<Agent>(cc.getAgent(8));
+		SimObjPtr nearest = nullptr;
+		double nearestDistance = 0;
+		IdSet<unsigned int> ignoreIDs = { 0 };
+		candidate->setPosition(Vector3d(1, 1, 0));
+		BOOST_TEST(cd.checkForCollision(cluster, ignoreIDs, candidate, nearest, nearestDistance) == true, "\n Error in linear Collision Test 4 Collision expected, but no collision occured!");
+		BOOST_TEST((nearest->getId() == 1) == true, "\n Error in linear Collision Test 4 Expexted candidate " << 1 << " but received " << nearest->getId());
+		// Test5 linear trees are used through the same interface as OctTrees
+		auto spatialTree = cd.getTree(0);
+		requiredIds = { 0,1 };
+		utils::checkRequiredIds(spatialTree->getNearestIds(1, 1, 0, IdSet<unsigned int>()), requiredIds, "\"Find nearest linear Node - Test5\"");
+		Bounds lb, ub;
+		BOOST_TEST(spatialTree->getObjectBounds(2, lb, ub) == true);
+		TreeStats stats;
+		BOOST_TEST(cc.getClusterTreeStats(0, stats) == true);
+		BOOST_TEST(stats.objectCount == 8);
+		BOOST_TEST(stats.nodeCount == tree->getNodeCount());
+		bool octTreeTest = false;
+		try {
+			cd.getOctTree(0);
+		}
+		catch (std::exception& e) {
+			octTreeTest = true;
+		}
+		BOOST_TEST(octTreeTest == true, "Linear Test 5 did not trigger the expected exception!");
+		bool linearTreeTest = false;
+		try {
+			cd.getLinearTree(99);
+		}
+		catch (std::runtime_error& e) {
+			linearTreeTest = true;
+		}
+		BOOST_TEST(linearTreeTest == true, "Linear Test 5 did not trigger the expected exception!");
+		// Test6 roots that do not straddle the origin grow towards objects below them
+		for (double rootLower : { 1.0, 0.0 }) {
+			LinearTreePtr<unsigned int> offset = LinearOctTree<unsigned int>::create(Bounds(rootLower, rootLower, rootLower), Bounds(rootLower + 2.0, rootLower + 2.0, rootLower + 2.0), Bounds(0.5, 0.5, 0.5));
+			offset->setAllowResize(true);
+			offset->insertObject(0, Bounds(rootLower + 0.1, rootLower + 0.1, rootLower + 0.1), Bounds(rootLower + 0.4, rootLower + 0.4, rootLower + 0.4));
+			offset->insertObject(1, Bounds(-2.0, -2.0, -2.0), Bounds(-1.6, -1.6, -1.6));
+			leaf = offset->getNearest(-1.8, -1.8, -1.8);
+			BOOST_TEST((IdSet<unsigned int>(leaf.begin(), leaf.end()) == IdSet<unsigned int>({ 1 })) == true, "\n Error in Linear Test 6, the object below a root at " << rootLower << " was clamped into an edge cell");
+			std::vector<std::pair<Bounds, Bounds>> bounds;
+			offset->getNodeBounds(bounds, false);
+			bool contained = false;
+			for (auto& node : bounds) contained = contained || (node.first.x <= -2.0 && node.second.x >= -1.6);
+			BOOST_TEST((contained && offset->getStats().resizeCount == 1) == true);
+		}
+	}
+
+	void OctTreeTestBench::testOctTreeUpdate() {
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(8.0, 2.0);
+		tree->insertObject(0, Bounds(1, 1, 1), Bounds(1.5, 1.5, 1.5));
+		tree->insertObject(1, Bounds(-3, -3, -3), Bounds(-2.5, -2.5, -2.5));
+		BOOST_TEST(tree->getNodes().size() == 5);
+		// Test1 move object into the leaf of another object
+		tree->updateObject(0, Bounds(-3.5, -3.5, -3.5), Bounds(-3.2, -3.2, -3.2));
+		IdSet<unsigned int> requiredIds = { 0,1 };
+		utils::checkRequiredIds(tree->getNearest(1, 1, 1)->getIds(), requiredIds, "\"Update Object - Test1\"");
+		BOOST_TEST(tree->getNodes().size() == 3);
+		BOOST_TEST(tree->getAllocationStats().nodeCount == tree->getNodes().size());
+		// Test2 remove object
+		BOOST_TEST(tree->removeObject(1) == true);
+		BOOST_TEST(tree->removeObject(1) == false);
+		BOOST_TEST(tree->containsObject(0) == true);
+		requiredIds = { 0 };
+		utils::checkRequiredIds(tree->getNearest(-3, -3, -3)->getIds(), requiredIds, "\"Remove Object - Test2\"");
+		// Test3 remove last object, only root remains
+		BOOST_TEST(tree->removeObject(0) == true);
+		BOOST_TEST(tree->getNodes().size() == 1);
+		BOOST_TEST(tree->getNearest(1, 1, 1)->getIds().empty() == true);
+		// Test4 re-insert, released nodes are recycled
+		tree->insertObject(2, Bounds(1, 1, 1), Bounds(1.5, 1.5, 1.5));
+		requiredIds = { 2 };
+		utils::checkRequiredIds(tree->getNearest(1, 1, 1)->getIds(), requiredIds, "\"Re-insert Object - Test4\"");
+		BOOST_TEST(tree->getAllocationStats().slabCount == 1);
+	}
+
+	void OctTreeTestBench::testLooseOctTree() {
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(8.0, 2.0, 2.0);
+		BOOST_TEST(tree->isLoose() == true);
+		tree->insertObject(0, Bounds(-3, -0.5, -0.5), Bounds(3, 0.5, 0.5));
+		tree->insertObject(1, Bounds(1, 1, 1), Bounds(1.5, 1.5, 1.5));
+		// Test1 every object is stored exactly once
+		unsigned int occurences = 0;
+		for (auto node : tree->getNodes()) {
+			occurences += static_cast<unsigned int>(node->getIds().size());
+		}
+		BOOST_TEST(occurences == 2);
+		// Test2 objects in different nodes are found if their loose bounds contain the query-point
+		IdSet<unsigned int> requiredIds = { 0,1 };
+		utils::checkRequiredIds(tree->getNearestIds(1.2, 1.2, 1.2, IdSet<unsigned int>()), requiredIds, "\"Loose Nearest Ids - Test2\"");
+		// Test3
+		requiredIds = { 0 };
+		utils::checkRequiredIds(tree->getNearestIds(-3, 3, 3, IdSet<unsigned int>()), requiredIds, "\"Loose Nearest Ids - Test3\"");
+		// Test4
+		requiredIds = { 1 };
+		utils::checkRequiredIds(tree->getNearestIds(1.2, 1.2, 1.2, IdSet<unsigned int>({ 0 })), requiredIds, "\"Loose Nearest Ids - Test4\"");
+		// Test5 looseness below 1.0 is invalid
+		bool loosenessTest = false;
+		try {
+			OctTree<unsigned int>::create(8.0, 2.0, 0.5);
+		}
+		catch (std::exception& e) {
+			loosenessTest = true;
+		}
+		BOOST_TEST(loosenessTest == true, "Looseness test 5 did not trigger the expected exception!");
+	}
+
+	void OctTreeTestBench::testOctTreeLeafCapacity() {
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(8.0, 0.25);
+		tree->setLeafCapacity(2, 2);
+		tree->insertObject(0, Bounds(1, 1, 1), Bounds(1.1, 1.1, 1.1));
+		tree->insertObject(1, Bounds(-3, -3, -3), Bounds(-2.9, -2.9, -2.9));
+		// Test1 root is not split until it is full
+		BOOST_TEST(tree->getNodes().size() == 1);
+		IdSet<unsigned int> requiredIds = { 0,1 };
+		utils::checkRequiredIds(tree->getNearest(1, 1, 1)->getIds(), requiredIds, "\"Leaf Capacity - Test1\"");
+		// Test2 split of a full root, sparse leaves are not subdivided any further
+		tree->insertObject(2, Bounds(3, 3, -3), Bounds(3.1, 3.1, -2.9));
+		BOOST_TEST(tree->getNodes().size() == 4);
+		requiredIds = { 0 };
+		utils::checkRequiredIds(tree->getNearest(1, 1, 1)->getIds(), requiredIds, "\"Leaf Capacity - Test2\"");
+		// Test3 siblings with enough ids are not merged
+		BOOST_TEST(tree->removeObject(2) == true);
+		BOOST_TEST(tree->getNodes().size() == 3);
+		// Test4 siblings below the merge threshold are merged into their parent
+		BOOST_TEST(tree->removeObject(1) == true);
+		BOOST_TEST(tree->getNodes().size() == 1);
+		requiredIds = { 0 };
+		utils::checkRequiredIds(tree->getNearest(-3, -3, -3)->getIds(), requiredIds, "\"Leaf Capacity - Test4\"");
+		// Test5 the depth limit stops splitting of crowded leaves
+		tree = OctTree<unsigned int>::create(8.0, 0.25);
+		tree->setLeafCapacity(1, 0);
+		tree->setMaxDepth(1);
+		tree->insertObject(0, Bounds(1, 1, 1), Bounds(1.1, 1.1, 1.1));
+		tree->insertObject(1, Bounds(1, 1, 1), Bounds(1.1, 1.1, 1.1));
+		tree->insertObject(2, Bounds(1, 1, 1), Bounds(1.1, 1.1, 1.1));
+		BOOST_TEST(tree->getNodes().size() == 2);
+		requiredIds = { 0,1,2 };
+		utils::checkRequiredIds(tree->getNearest(1, 1, 1)->getIds(), requiredIds, "\"Leaf Capacity - Test5\"");
+	}
+
+	void OctTreeTestBench::testOctTreeBulkLoad() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(60, Bounds(0.0, 0.0, -6.0), Bounds(9.0, 7.0, 0.2), 1.3, 0.7, 0.25, 0.05, 7);
+		TreePtr<unsigned int> sequential = OctTree<unsigned int>::create(4.0, 1.0);
+		sequential->setAllowResize(true);
+		for (auto& object : objects) sequential->insertObject(object.id, object.lower, object.upper);
+		TreePtr<unsigned int> bulk = OctTree<unsigned int>::create(4.0, 1.0);
+		bulk->setAllowResize(true);
+		bulk->insertObjects(objects);
+		// Test1 bulk-loading results in the same tree as inserting one by one
+		BOOST_TEST(bulk->getNodes().size() == sequential->getNodes().size());
+		unsigned int mismatches = 0;
+		for (double x = -10.0; x <= 10.0; x += 2.5) {
+			for (double y = -8.0; y <= 8.0; y += 2.5) {
+				for (double z = -7.0; z <= 7.0; z += 3.5) {
+					if (bulk->getNearest(x, y, z)->getIds() != sequential->getNearest(x, y, z)->getIds()) mismatches++;
+				}
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Bulk Load Test 1, " << mismatches << " queries returned different nodes");
+		// Test2 a tree constructed around all objects contains every object
+		TreePtr<unsigned int> tight = OctTree<unsigned int>::createFromObjects(objects, Bounds(1.0, 1.0, 1.0));
+		unsigned int contained = 0;
+		for (auto& object : objects) {
+			if (tight->containsObject(object.id)) contained++;
+		}
+		BOOST_TEST(contained == objects.size());
+		IdSet<unsigned int> requiredIds = { 5 };
+		const ObjectEntry<unsigned int>& object = objects[5];
+		utils::checkRequiredIds(tight->getNearest((object.lower.x + object.upper.x) / 2.0, (object.lower.y + object.upper.y) / 2.0, (object.lower.z + object.upper.z) / 2.0)->getIds(), requiredIds, "\"Bulk Load - Test2\"");
+	}
+
+	void OctTreeTestBench::testOctTreeParallelBuild() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(400, Bounds(0.0, 0.0, -12.0), Bounds(12.0, 10.0, 0.06), 0.37, 0.91, 0.3, 0.1, 5);
+		TreePtr<unsigned int> serial = OctTree<unsigned int>::create(4.0, 0.5);
+		serial->setAllowResize(true);
+		serial->insertObjects(objects);
+		TreePtr<unsigned int> parallel = OctTree<unsigned int>::create(4.0, 0.5);
+		parallel->setAllowResize(true);
+		parallel->setBuildThreads(4);
+		parallel->insertObjects(objects);
+		// Test1 the threaded build results in exactly the same tree, i.e. same nodes, bounds and order of ids within each node
+		BOOST_TEST(parallel->getAllocationStats().nodeCount == serial->getAllocationStats().nodeCount);
+		unsigned int mismatches = 0;
+		vector<std::pair<NodePtr<unsigned int>, NodePtr<unsigned int>>> stack = { std::make_pair(serial->getNodes().front(), parallel->getNodes().front()) };
+		while (!stack.empty()) {
+			NodePtr<unsigned int> lhs = stack.back().first;
+			NodePtr<unsigned int> rhs = stack.back().second;
+			stack.pop_back();
+			vector<unsigned int> lhsIds(lhs->getIds().begin(), lhs->getIds().end());
+			vector<unsigned int> rhsIds(rhs->getIds().begin(), rhs->getIds().end());
+			if (lhsIds != rhsIds || lhs->getLowerBounds().x != rhs->getLowerBounds().x || lhs->getUpperBounds().z != rhs->getUpperBounds().z) mismatches++;
+			for (unsigned int oct = 0; oct < 8; oct++) {
+				Octant octant = static_cast<Octant>(oct);
+				if (lhs->isOctantNull(octant) != rhs->isOctantNull(octant)) mismatches++;
+				else if (!lhs->isOctantNull(octant)) stack.push_back(std::make_pair(lhs->getChild(octant), rhs->getChild(octant)));
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Parallel Build Test 1, " << mismatches << " nodes differ from the serial build");
+		// Test2 objects built by other threads can be moved and removed afterwards
+		parallel->updateObject(7, Bounds(30.0, 30.0, 30.0), Bounds(30.5, 30.5, 30.5));
+		IdSet<unsigned int> requiredIds = { 7 };
+		utils::checkRequiredIds(parallel->getNearest(30.2, 30.2, 30.2)->getIds(), requiredIds, "\"Parallel Build - Test2\"");
+		BOOST_TEST(parallel->removeObject(11) == true);
+		BOOST_TEST(parallel->containsObject(11) == false);
+		BOOST_TEST(parallel->getAllocationStats().nodeCount == parallel->getNodes().size());
+	}
+
+	void OctTreeTestBench::testOctTreeKNearest() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(120, Bounds(0.0, 0.0, -8.0), Bounds(8.0, 8.0, 0.13), 0.83, 1.21, 0.2, 0.15, 4);
+		auto boxDistance = [](const double& x, const double& y, const double& z, const ObjectEntry<unsigned int>& object) {
+			double dx = std::max(std::max(object.lower.x - x, 0.0), x - object.upper.x);
+			double dy = std::max(std::max(object.lower.y - y, 0.0), y - object.upper.y);
+			double dz = std::max(std::max(object.lower.z - z, 0.0), z - object.upper.z);
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		};
+		IdSet<unsigned int> ignoreIds = { 3, 17, 42 };
+		for (double looseness : { 1.0, 2.0 }) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 0.5, looseness);
+			tree->setAllowResize(true);
+			tree->insertObjects(objects);
+			// Test1 the k nearest objects match a brute-force search over all objects
+			unsigned int mismatches = 0;
+			for (double x = -9.0; x <= 9.0; x += 4.5) {
+				for (double y = -9.0; y <= 9.0; y += 4.5) {
+					for (double z = -9.0; z <= 9.0; z += 6.0) {
+						NeighborArray<unsigned int> expected;
+						for (auto& object : objects) {
+							if (ignoreIds.find(object.id) == ignoreIds.end()) expected.push_back(Neighbor<unsigned int>(object.id, boxDistance(x, y, z, object)));
+						}
+						std::sort(expected.begin(), expected.end(), [](const Neighbor<unsigned int>& lhs, const Neighbor<unsigned int>& rhs) { return (lhs.distance != rhs.distance) ? lhs.distance < rhs.distance : lhs.id < rhs.id; });
+						for (unsigned int k : { 1, 5, 20 }) {
+							NeighborArray<unsigned int> nearest = tree->getKNearest(x, y, z, k, ignoreIds);
+							if (nearest.size() != k) {
+								mismatches++;
+								continue;
+							}
+							for (unsigned int i = 0; i < k; i++) {
+								if (nearest[i].id != expected[i].id || std::fabs(nearest[i].distance - expected[i].distance) > utils::EPS) mismatches++;
+							}
+						}
+					}
+				}
+			}
+			BOOST_TEST(mismatches == 0, "\n Error in K-Nearest Test 1 with looseness " << looseness << ", " << mismatches << " neighbors differ from brute-force search");
+		}
+		// Test2 asking for more objects than the tree contains returns all of them
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 0.5);
+		tree->insertObject(0, Bounds(-1.0, -1.0, -1.0), Bounds(-0.5, -0.5, -0.5));
+		tree->insertObject(1, Bounds(0.5, 0.5, 0.5), Bounds(1.0, 1.0, 1.0));
+		NeighborArray<unsigned int> nearest = tree->getKNearest(0.75, 0.75, 0.75, 5, IdSet<unsigned int>());
+		BOOST_TEST(nearest.size() == 2);
+		BOOST_TEST(nearest.front().id == 1);
+		BOOST_TEST(nearest.front().distance == 0.0);
+	}
+
+	void OctTreeTestBench::testOctTreeRangeQueries() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(120, Bounds(0.0, 0.0, -8.0), Bounds(8.0, 8.0, 0.13), 0.59, 1.37, 0.2, 0.3, 3);
+		for (double looseness : { 1.0, 2.0 }) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 0.5, looseness);
+			tree->setAllowResize(true);
+			tree->insertObjects(objects);
+			// Test1 radius and box queries match a brute-force search over all objects, each id is reported once
+			unsigned int mismatches = 0;
+			vector<unsigned int> results;
+			for (double x = -9.0; x <= 9.0; x += 3.0) {
+				for (double y = -9.0; y <= 9.0; y += 4.5) {
+					for (double z = -9.0; z <= 9.0; z += 4.5) {
+						vector<unsigned int> inRadius, inBox;
+						for (auto& object : objects) {
+							double dx = std::max(std::max(object.lower.x - x, 0.0), x - object.upper.x);
+							double dy = std::max(std::max(object.lower.y - y, 0.0), y - object.upper.y);
+							double dz = std::max(std::max(object.lower.z - z, 0.0), z - object.upper.z);
+							if (std::sqrt(dx * dx + dy * dy + dz * dz) <= 2.5) inRadius.push_back(object.id);
+							if (object.lower.x <= x + 2.0 && x - 2.0 <= object.upper.x && object.lower.y <= y + 1.0 && y - 1.0 <= object.upper.y && object.lower.z <= z + 3.0 && z - 3.0 <= object.upper.z) inBox.push_back(object.id);
+						}
+						results.clear();
+						if (tree->queryRadius(x, y, z, 2.5, results) != inRadius.size() || results != inRadius) mismatches++;
+						results.clear();
+						if (tree->queryBox(Bounds(x - 2.0, y - 1.0, z - 3.0), Bounds(x + 2.0, y + 1.0, z + 3.0), results) != inBox.size() || results != inBox) mismatches++;
+					}
+				}
+			}
+			BOOST_TEST(mismatches == 0, "\n Error in Range Query Test 1 with looseness " << looseness << ", " << mismatches << " queries differ from brute-force search");
+		}
+		// Test2 results are appended to the buffer
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 0.5);
+		tree->insertObject(0, Bounds(-1.0, -1.0, -1.0), Bounds(-0.5, -0.5, -0.5));
+		tree->insertObject(1, Bounds(0.5, 0.5, 0.5), Bounds(1.0, 1.0, 1.0));
+		vector<unsigned int> results = { 7 };
+		BOOST_TEST(tree->queryRadius(0.0, 0.0, 0.0, 0.5, results) == 0);
+		BOOST_TEST(tree->queryRadius(0.0, 0.0, 0.0, 1.0, results) == 2);
+		BOOST_TEST(tree->queryBox(Bounds(0.9, 0.9, 0.9), Bounds(2.0, 2.0, 2.0), results) == 1);
+		vector<unsigned int> expected = { 7, 0, 1, 1 };
+		BOOST_TEST(results == expected);
+	}
+
+	void OctTreeTestBench::testOctTreeIgnoreFilter() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(200, Bounds(0.0, 0.0, -8.0), Bounds(8.0, 8.0, 0.08), 0.71, 1.13, 0.2, 0.2, 3);
+		auto countIds = [](TreePtr<unsigned int> tree) {
+			size_t count = 0;
+			for (auto& node : tree->getNodes()) count += node->getIds().size();
+			return count;
+		};
+		for (unsigned int threads : { 1, 4 }) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 0.5);
+			tree->setAllowResize(true);
+			tree->setBuildThreads(threads);
+			tree->insertObjects(objects);
+			// Test1 the root counts all ids of the tree, also after objects were moved and removed
+			BOOST_TEST(tree->getNodes().front()->getSubtreeIdCount() == countIds(tree));
+			tree->updateObject(3, Bounds(20.0, 20.0, 20.0), Bounds(21.0, 21.0, 21.0));
+			tree->removeObject(4);
+			BOOST_TEST(tree->getNodes().front()->getSubtreeIdCount() == countIds(tree));
+			// Test2 the nearest node with ignored ids is as close as the nearest node with any id that is not ignored
+			IdSet<unsigned int> ignoreIds;
+			for (unsigned int i = 0; i < 5000; i += 2) ignoreIds.insert(i);
+			unsigned int mismatches = 0;
+			for (double x = -9.0; x <= 9.0; x += 3.0) {
+				for (double y = -9.0; y <= 9.0; y += 3.0) {
+					for (double z = -9.0; z <= 9.0; z += 4.5) {
+						double expected = collision::octtree::POS_INF;
+						for (auto& node : tree->getNodes()) {
+							for (auto id : node->getIds()) {
+								if (ignoreIds.find(id) == ignoreIds.end()) expected = std::min(expected, node->calcMinDistance(x, y, z));
+							}
+						}
+						NodePtr<unsigned int> nearest = tree->getNearest(x, y, z, ignoreIds);
+						bool unignored = false;
+						for (auto id : nearest->getIds()) unignored = unignored || ignoreIds.find(id) == ignoreIds.end();
+						if (!unignored || std::fabs(nearest->calcMinDistance(x, y, z) - expected) > utils::EPS) mismatches++;
+					}
+				}
+			}
+			BOOST_TEST(mismatches == 0, "\n Error in Ignore Filter Test 2, " << mismatches << " queries returned wrong nodes");
+			// Test3 ignoring all ids results in root, ignoring all but one id results in the node of that id
+			IdSet<unsigned int> allIds;
+			for (unsigned int i = 0; i < 200; i++) allIds.insert(i);
+			BOOST_TEST(tree->getNearest(0.0, 0.0, 0.0, allIds) == tree->getNodes().front());
+			allIds.erase(3);
+			IdSet<unsigned int> requiredIds = { 3 };
+			utils::checkRequiredIds(tree->getNearest(0.0, 0.0, 0.0, allIds)->getIds(), requiredIds, "\"Ignore Filter - Test3\"");
+		}
+	}
+
+	void OctTreeTestBench::testOctTreeQueryContext() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(150, Bounds(0.0, 0.0, -7.5), Bounds(8.0, 8.0, 0.1), 0.47, 1.07, 0.2, 0.2, 3);
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::createFromObjects(objects, Bounds(0.5, 0.5, 0.5));
+		TreePtr<unsigned int> small = OctTree<unsigned int>::create(4.0, 1.0);
+		small->insertObject(0, Bounds(-1.0, -1.0, -1.0), Bounds(-0.5, -0.5, -0.5));
+		IdSet<unsigned int> ignoreIds;
+		for (unsigned int i = 0; i < 150; i += 3) ignoreIds.insert(i);
+		vector<Bounds> points;
+		for (double x = -9.0; x <= 9.0; x += 3.0) {
+			for (double y = -9.0; y <= 9.0; y += 3.0) {
+				for (double z = -9.0; z <= 9.0; z += 4.5) points.push_back(Bounds(x, y, z));
+			}
+		}
+		// Test1 a reused query context returns the same nodes as the tree's own context, also when alternating between trees
+		QueryPtr<unsigned int> query = OctTreeQuery<unsigned int>::create();
+		vector<unsigned int> ids;
+		NeighborArray<unsigned int> neighbors;
+		unsigned int mismatches = 0;
+		for (auto& p : points) {
+			if (tree->getNearest(p.x, p.y, p.z, *query) != tree->getNearest(p.x, p.y, p.z)) mismatches++;
+			if (small->getNearest(p.x, p.y, p.z, ignoreIds, *query) != small->getNearest(p.x, p.y, p.z, ignoreIds)) mismatches++;
+			if (tree->getNearest(p.x, p.y, p.z, ignoreIds, *query) != tree->getNearest(p.x, p.y, p.z, ignoreIds)) mismatches++;
+			ids.clear();
+			tree->getNearestIds(p.x, p.y, p.z, ignoreIds, ids, *query);
+			if (IdSet<unsigned int>(ids.begin(), ids.end()) != tree->getNearestIds(p.x, p.y, p.z, ignoreIds) || !std::is_sorted(ids.begin(), ids.end())) mismatches++;
+			neighbors.clear();
+			NeighborArray<unsigned int> expectedNeighbors = tree->getKNearest(p.x, p.y, p.z, 7, ignoreIds);
+			if (tree->getKNearest(p.x, p.y, p.z, 7, ignoreIds, neighbors, *query) != 7 || neighbors.size() != expectedNeighbors.size()) {
+				mismatches++;
+				continue;
+			}
+			for (size_t i = 0; i < neighbors.size(); i++) {
+				if (neighbors[i].id != expectedNeighbors[i].id || neighbors[i].distance != expectedNeighbors[i].distance) mismatches++;
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Query Context Test 1, " << mismatches << " queries returned different nodes");
+		// Test2 threads with a query context each may query the same tree concurrently
+		vector<NodePtr<unsigned int>> expected;
+		for (auto& p : points) expected.push_back(tree->getNearest(p.x, p.y, p.z, ignoreIds));
+		vector<unsigned int> threadMismatches(4, 0);
+		vector<std::thread> threads;
+		for (unsigned int t = 0; t < 4; t++) {
+			threads.push_back(std::thread([&, t]() {
+				QueryPtr<unsigned int> threadQuery = OctTreeQuery<unsigned int>::create();
+				for (unsigned int repeat = 0; repeat < 20; repeat++) {
+					for (size_t i = 0; i < points.size(); i++) {
+						if (tree->getNearest(points[i].x, points[i].y, points[i].z, ignoreIds, *threadQuery) != expected[i]) threadMismatches[t]++;
+					}
+				}
+			}));
+		}
+		for (auto& thread : threads) thread.join();
+		for (unsigned int t = 0; t < 4; t++) mismatches += threadMismatches[t];
+		BOOST_TEST(mismatches == 0, "\n Error in Query Context Test 2, " << mismatches << " concurrent queries returned different nodes");
+	}
+
+	void OctTreeTestBench::testOctTreeIdStorage() {
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 4.0);
+		// Test1 ids are kept sorted, inline as well as after spilling to the heap
+		for (unsigned int id = 20; id > 0; id -= 2) tree->insertObject(id, Bounds(0.5, 0.5, 0.5), Bounds(1.0, 1.0, 1.0));
+		tree->insertObject(8, Bounds(0.5, 0.5, 0.5), Bounds(1.0, 1.0, 1.0));
+		IdSpan<unsigned int> ids = tree->getNearest(0.75, 0.75, 0.75)->getIds();
+		vector<unsigned int> expected = { 2, 4, 6, 8, 10, 12, 14, 16, 18, 20 };
+		BOOST_TEST(vector<unsigned int>(ids.begin(), ids.end()) == expected);
+		BOOST_TEST(ids.size() > INLINE_ID_COUNT);
+		BOOST_TEST((ids.find(14) != ids.end()) == true);
+		BOOST_TEST((ids.find(15) == ids.end()) == true);
+		// Test2 removing ids keeps the remaining ids sorted, spans of equal ids compare equal
+		for (unsigned int id = 4; id <= 20; id += 4) tree->removeObject(id);
+		ids = tree->getNearest(0.75, 0.75, 0.75)->getIds();
+		expected = { 2, 6, 10, 14, 18 };
+		BOOST_TEST(vector<unsigned int>(ids.begin(), ids.end()) == expected);
+		TreePtr<unsigned int> other = OctTree<unsigned int>::create(4.0, 4.0);
+		for (auto id : expected) other->insertObject(id, Bounds(0.5, 0.5, 0.5), Bounds(1.0, 1.0, 1.0));
+		BOOST_TEST((other->getNearest(0.75, 0.75, 0.75)->getIds() == ids) == true);
+		other->removeObject(2);
+		BOOST_TEST((other->getNearest(0.75, 0.75, 0.75)->getIds() != ids) == true);
+		IdSet<unsigned int> requiredIds = { 2, 6, 10, 14, 18 };
+		utils::checkRequiredIds(ids, requiredIds, "\"Id Storage - Test2\"");
+	}
+
+	void OctTreeTestBench::testOctTreeGrowth() {
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 1.0);
+		tree->setAllowResize(true);
+		tree->insertObject(0, Bounds(0.5, 0.5, 0.5), Bounds(0.9, 0.9, 0.9));
+		// Test1 the tree only grows towards a far object, the old root stays in place as one octant
+		tree->insertObject(1, Bounds(100.0, 100.0, 100.0), Bounds(100.5, 100.5, 100.5));
+		NodePtr<unsigned int> root = tree->getNodes().front();
+		BOOST_TEST(root->getLowerBounds().x == -2.0);
+		BOOST_TEST(root->getLowerBounds().z == -2.0);
+		BOOST_TEST(root->getUpperBounds().y == 126.0);
+		BOOST_TEST(tree->getAllocationStats().nodeCount < 40);
+		IdSet<unsigned int> requiredIds = { 1 };
+		utils::checkRequiredIds(tree->getNearest(100.2, 100.2, 100.2)->getIds(), requiredIds, "\"Growth - Test1\"");
+		requiredIds = { 0 };
+		utils::checkRequiredIds(tree->getNearest(0.7, 0.7, 0.7)->getIds(), requiredIds, "\"Growth - Test1\"");
+		// Test2 once the far object is removed, empty roots with a single child are dropped again
+		tree->removeObject(1);
+		root = tree->getNodes().front();
+		BOOST_TEST(root->getDiameter().x <= 4.0);
+		BOOST_TEST((root->getParent() == nullptr) == true);
+		BOOST_TEST(root->isInBounds(Bounds(0.5, 0.5, 0.5), Bounds(0.9, 0.9, 0.9)));
+		utils::checkRequiredIds(tree->getNearest(0.7, 0.7, 0.7)->getIds(), requiredIds, "\"Growth - Test2\"");
+		tree->updateObject(0, Bounds(-50.0, -50.0, -50.0), Bounds(-49.5, -49.5, -49.5));
+		BOOST_TEST(tree->getNodes().front()->getUpperBounds().x <= 1.0);
+		utils::checkRequiredIds(tree->getNearest(-49.7, -49.7, -49.7)->getIds(), requiredIds, "\"Growth - Test2\"");
+		// Test3 compact rebuilds the root tightly around the objects and keeps query results
+		ObjectArray<unsigned int> objects = makeScatteredObjects(60, Bounds(500.0, 500.0, 497.0), Bounds(3.0, 3.0, 0.1), 0.7, 1.3, 0.3);
+		TreePtr<unsigned int> offset = OctTree<unsigned int>::create(2048.0, 0.5);
+		offset->insertObjects(objects);
+		vector<IdSet<unsigned int>> expected;
+		for (double x = 496.0; x <= 504.0; x += 2.0) {
+			for (double y = 496.0; y <= 504.0; y += 2.0) expected.push_back(offset->getNearestIds(x, y, 500.0, IdSet<unsigned int>()));
+		}
+		size_t nodeCount = offset->getAllocationStats().nodeCount;
+		offset->compact();
+		BOOST_TEST(offset->getNodes().front()->getDiameter().x <= 8.0);
+		BOOST_TEST(offset->getAllocationStats().nodeCount < nodeCount);
+		unsigned int mismatches = 0;
+		size_t i = 0;
+		for (double x = 496.0; x <= 504.0; x += 2.0) {
+			for (double y = 496.0; y <= 504.0; y += 2.0) {
+				if (offset->getNearestIds(x, y, 500.0, IdSet<unsigned int>()) != expected[i++]) mismatches++;
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Growth Test 3, " << mismatches << " queries returned different ids after compacting");
+	}
+
+	void OctTreeTestBench::testOctTreeNodeGeometry() {
+		// Test1 nodes only store their bounds in the precision of NodeScalar
+		BOOST_TEST(sizeof(NodeBounds) == 3 * sizeof(NodeScalar));
+		// Test2 center and diameter are derived from the bounds
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(Bounds(-2.0, 0.0, 4.0), Bounds(6.0, 4.0, 6.0), Bounds(1.0, 1.0, 0.5));
+		tree->insertObject(0, Bounds(3.0, 2.5, 5.5), Bounds(3.5, 3.0, 5.75));
+		NodePtr<unsigned int> root = tree->getNodes().front();
+		BOOST_TEST(root->getX() == 2.0);
+		BOOST_TEST(root->getY() == 2.0);
+		BOOST_TEST(root->getZ() == 5.0);
+		BOOST_TEST(root->getDiameter().x == 8.0);
+		BOOST_TEST(root->getDiameter().z == 2.0);
+		NodePtr<unsigned int> leaf = tree->getNearest(3.2, 2.7, 5.6);
+		BOOST_TEST(leaf->getDiameter().x == 2.0);
+		BOOST_TEST(leaf->getDiameter().z == 0.5);
+		BOOST_TEST(leaf->getLowerBounds().x == 2.0);
+		BOOST_TEST(leaf->getUpperBounds().y == 3.0);
+		BOOST_TEST(leaf->getZ() == 5.75);
+		// Test3 distances to nodes are calculated in double precision from the stored bounds
+		BOOST_TEST(leaf->calcMinDistance(3.5, 2.5, 5.5) == 0.0);
+		BOOST_TEST(leaf->calcMinDistance(3.0, 1.5, 5.75) == 0.5);
+		BOOST_TEST(leaf->calcMinDistance(3.5, 2.5, 5.5, 2.0) == 0.0);
+		IdSet<unsigned int> requiredIds = { 0 };
+		utils::checkRequiredIds(leaf->getIds(), requiredIds, "\"Node Geometry - Test2\"");
+	}
+
+	void OctTreeTestBench::testOctTreeChildDistances() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(120, Bounds(0.0, 0.0, -7.7), Bounds(7.3, 5.9, 0.13), 0.61, 1.19, 0.15, 0.1, 4);
+		// Test1 the distances derived from the parent equal exactly the distances of the single children, for regular and loose trees
+		unsigned int mismatches = 0;
+		for (double looseness : { 1.0, 2.0 }) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::createFromObjects(objects, Bounds(0.3, 0.3, 0.3), looseness);
+			ChildDistances distances;
+			for (auto node : tree->getNodes()) {
+				if (node->isLeaf()) continue;
+				for (double x = -9.0; x <= 9.0; x += 2.25) {
+					for (double y = -9.0; y <= 9.0; y += 2.25) {
+						for (double z = -9.0; z <= 9.0; z += 4.5) {
+							node->calcChildDistances(x, y, z, looseness, distances);
+							for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+								if (node->isOctantNull(static_cast<Octant>(oct))) continue;
+								if (distances[oct] != node->getChild(static_cast<Octant>(oct))->calcMinDistance(x, y, z, looseness)) mismatches++;
+							}
+						}
+					}
+				}
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Child Distances Test 1, " << mismatches << " distances differ from the single child distances");
+		// Test2 after growing, the former root differs from the bounds derived from its new parent by rounding only
+		TreePtr<unsigned int> grown = OctTree<unsigned int>::createFromObjects(objects, Bounds(0.3, 0.3, 0.3));
+		grown->setAllowResize(true);
+		grown->insertObject(1000, Bounds(23.1, -31.7, 5.3), Bounds(23.6, -31.2, 5.8));
+		ChildDistances distances;
+		for (auto node : grown->getNodes()) {
+			if (node->isLeaf()) continue;
+			for (double x = -30.0; x <= 30.0; x += 7.5) {
+				for (double y = -30.0; y <= 30.0; y += 7.5) {
+					node->calcChildDistances(x, y, 1.0, 1.0, distances);
+					for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+						if (node->isOctantNull(static_cast<Octant>(oct))) continue;
+						if (std::fabs(distances[oct] - node->getChild(static_cast<Octant>(oct))->calcMinDistance(x, y, 1.0)) > utils::EPS) mismatches++;
+					}
+				}
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Child Distances Test 2, " << mismatches << " distances differ from the single child distances");
+		// Test3 radius queries only descending into children within the radius still find all objects
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::createFromObjects(objects, Bounds(0.3, 0.3, 0.3));
+		vector<unsigned int> found;
+		tree->queryRadius(0.0, 0.0, 0.0, 100.0, found);
+		BOOST_TEST(found.size() == objects.size());
+	}
+
+	void OctTreeTestBench::benchmarkOctTreeNearest() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(100000, Bounds(0.0, 0.0, -100.0), Bounds(100.0, 100.0, 0.002), 0.37, 0.91, 0.5);
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::createFromObjects(objects, Bounds(1.0, 1.0, 1.0));
+		vector<NodePtr<unsigned int>> inner;
+		for (auto node : tree->getNodes()) {
+			if (!node->isLeaf()) inner.push_back(node);
+		}
+		// per node evaluation of all children, one at a time and derived from the parent
+		double singleSum = 0.0, derivedSum = 0.0;
+		ChildDistances distances;
+		auto start = std::chrono::steady_clock::now();
+		for (auto node : inner) {
+			for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+				if (!node->isOctantNull(static_cast<Octant>(oct))) singleSum += node->getChild(static_cast<Octant>(oct))->calcMinDistance(1.0, 2.0, 3.0, 1.0);
+			}
+		}
+		double singleTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		for (auto node : inner) {
+			node->calcChildDistances(1.0, 2.0, 3.0, 1.0, distances);
+			for (unsigned int oct = Octant::first; oct <= Octant::eighth; oct++) {
+				if (!node->isOctantNull(static_cast<Octant>(oct))) derivedSum += distances[oct];
+			}
+		}
+		double derivedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		BOOST_TEST(singleSum == derivedSum);
+		std::cout << "OctTree child distances of " << inner.size() << " nodes: single " << singleTime << " ms, derived " << derivedTime << " ms" << std::endl;
+		// nearest queries, which evaluate the children of every visited node
+		start = std::chrono::steady_clock::now();
+		unsigned int queries = 0;
+		for (double x = -100.0; x <= 100.0; x += 2.0) {
+			for (double y = -100.0; y <= 100.0; y += 2.0) {
+				tree->getNearest(x, y, 0.0);
+				queries++;
+			}
+		}
+		double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "OctTree nearest search of " << queries << " query-points: " << time << " ms" << std::endl;
+	}
+
+	void OctTreeTestBench::benchmarkOctTreeBuild() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(200000, Bounds(0.0, 0.0, -100.0), Bounds(100.0, 100.0, 0.001), 0.37, 0.91, 0.5);
+		unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		double serialTime = 0.0;
+		size_t serialNodes = 0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(200.0, 1.0);
+			tree->setBuildThreads(threads);
+			auto start = std::chrono::steady_clock::now();
+			tree->insertObjects(objects);
+			double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (threads == 1) {
+				serialTime = time;
+				serialNodes = tree->getAllocationStats().nodeCount;
+			}
+			BOOST_TEST(tree->getAllocationStats().nodeCount == serialNodes);
+			std::cout << "OctTree bulk-load of " << objects.size() << " objects with " << threads << " thread(s): " << time << " ms, speedup " << serialTime / time << std::endl;
+		}
+	}
+
+	void OctTreeTestBench::testCollisionDetectionSync() {
+		CLibCollisionController& cc = *CLibController["Sync-Test"];
+		BOOST_TEST(cc.createAgent(0, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(1, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(2, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(3, "SphereAgent") == true);
+		try {
+			cc.connectAgents(0, 1, 1, 0);
+			cc.connectAgents(1, 2, 1, 0);
+			cc.connectAgents(2, 3, 1, 0);
+		}
+		catch (std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		auto cluster = std::static_pointer_cast<AgentCluster>(cc.getAgentCluster(0));
+		auto agent = std::static_pointer_cast<Agent>(cc.getAgent(3));
+		// Test1 nothing changed since the tree was constructed
+		BOOST_TEST(cd.sync(0) == 0);
+		// Test2 only the moved agent is updated and found at its new position
+		unsigned long version = agent->getVersion();
+		agent->move(Vector3d(20, 0, 0));
+		BOOST_TEST(agent->getVersion() == version + 1);
+		BOOST_TEST(cd.sync(0) == 1);
+		BOOST_TEST(cd.sync(0) == 0);
+		Vector3d position = agent->getPosition(ReferenceFrame::Global);
+		IdSet<unsigned int> requiredIds = { 3 };
+		utils::checkRequiredIds(cd.getTree(0)->getNearestIds(position.x(), position.y(), position.z(), IdSet<unsigned int>()), requiredIds, "\"Sync moved Agent - Test2\"");
+		// Test3 rotating a sphere does not change its bounding box
+		agent->rotate(Quaternion::FromTwoVectors(Vector3d(0, 0, 1), Vector3d(0, 1, 1)));
+		BOOST_TEST(cd.sync(0) == 0);
+		// Test4 moving the cluster moves all of its agents
+		cluster->move(Vector3d(0, 0, 10));
+		BOOST_TEST(cd.sync(0) == cluster->getAllAgents().size());
+		position = agent->getPosition(ReferenceFrame::Global);
+		utils::checkRequiredIds(cd.getTree(0)->getNearestIds(position.x(), position.y(), position.z(), IdSet<unsigned int>()), requiredIds, "\"Sync moved Cluster - Test4\"");
+		// Test5 unknown clusters cannot be synchronized
+		bool syncTest = false;
+		try {
+			cd.sync(1);
+		}
+		catch (std::exception& e) {
+			syncTest = true;
+		}
+		BOOST_TEST(syncTest == true, "Sync test 5 did not trigger the expected exception!");
+	}
+
+	void OctTreeTestBench::testOctTreeSnapshot() {
+		const std::string path = "OctTreeSnapshot.bin";
+		for (double looseness : { 1.0, 2.0 }) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(16.0, 1.0, looseness);
+			for (unsigned int id = 0; id < 40; id++) {
+				double x = -7.5 + (id * 37 % 15), y = -7.5 + (id * 11 % 15), z = -7.5 + (id * 5 % 15);
+				tree->insertObject(id, Bounds(x, y, z), Bounds(x + 0.5, y + 0.5, z + 0.5));
+			}
+			tree->save(path);
+			MappedTreePtr<unsigned int> mapped = MappedOctTree<unsigned int>::create(path);
+			// Test1 the snapshot contains all nodes and objects of the tree
+			BOOST_TEST(mapped->getNodeCount() == tree->getNodes().size());
+			BOOST_TEST(mapped->getObjectCount() == 40);
+			BOOST_TEST(mapped->isLoose() == tree->isLoose());
+			Bounds lb, ub, mappedLb, mappedUb;
+			tree->getObjectBounds(5, lb, ub);
+			BOOST_TEST(mapped->getObjectBounds(5, mappedLb, mappedUb) == true);
+			BOOST_TEST((lb.x == mappedLb.x && lb.y == mappedLb.y && lb.z == mappedLb.z && ub.x == mappedUb.x && ub.y == mappedUb.y && ub.z == mappedUb.z) == true);
+			BOOST_TEST(mapped->containsObject(40) == false);
+			// Test2 queries on the mapped snapshot return the same results as the tree
+			IdSet<unsigned int> ignoreIDs = { 3, 7, 12 };
+			std::vector<unsigned int> expected, received;
+			MappedQueryPtr<unsigned int> query = MappedOctTreeQuery<unsigned int>::create();
+			bool identical = true;
+			for (unsigned int q = 0; q < 50; q++) {
+				double x = -9.0 + (q * 7 % 19), y = -9.0 + (q * 13 % 19), z = -9.0 + (q * 3 % 19);
+				identical = identical && mapped->getNearest(x, y, z) == tree->getNearest(x, y, z)->getIds();
+				identical = identical && mapped->getNearest(x, y, z, ignoreIDs) == tree->getNearest(x, y, z, ignoreIDs)->getIds();
+				identical = identical && mapped->getNearestIds(x, y, z, ignoreIDs) == tree->getNearestIds(x, y, z, ignoreIDs);
+				// a reused query context returns the same results
+				identical = identical && mapped->getNearest(x, y, z, ignoreIDs, *query) == tree->getNearest(x, y, z, ignoreIDs)->getIds();
+				received.clear();
+				mapped->getNearestIds(x, y, z, ignoreIDs, received, *query);
+				identical = identical && IdSet<unsigned int>(received.begin(), received.end()) == tree->getNearestIds(x, y, z, ignoreIDs);
+				expected.clear();
+				received.clear();
+				tree->queryRadius(x, y, z, 3.0, expected);
+				mapped->queryRadius(x, y, z, 3.0, received);
+				identical = identical && expected == received;
+				expected.clear();
+				received.clear();
+				tree->queryBox(Bounds(x - 2, y - 2, z - 2), Bounds(x + 2, y + 2, z + 2), expected);
+				mapped->queryBox(Bounds(x - 2, y - 2, z - 2), Bounds(x + 2, y + 2, z + 2), received);
+				identical = identical && expected == received;
+			}
+			BOOST_TEST(identical == true, "Snapshot test 2 mapped tree (looseness " << looseness << ") differs from its tree!");
+		}
+		// Test3 snapshots of trees with another id type are rejected
+		bool idTypeTest = false;
+		try {
+			MappedOctTree<double>::create(path);
+		}
+		catch (std::exception& e) {
+			idTypeTest = true;
+		}
+		BOOST_TEST(idTypeTest == true, "Snapshot test 3 did not trigger the expected exception!");
+		// Test4 files that are no snapshots are rejected
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file << std::string(256, 'x');
+		}
+		bool magicTest = false;
+		try {
+			MappedOctTree<unsigned int>::create(path);
+		}
+		catch (std::exception& e) {
+			magicTest = true;
+		}
+		BOOST_TEST(magicTest == true, "Snapshot test 4 did not trigger the expected exception!");
+		// Test5 snapshots with node indices outside of the node section are rejected
+		{
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(16.0, 1.0);
+			tree->insertObject(0, Bounds(1.0, 1.0, 1.0), Bounds(1.5, 1.5, 1.5));
+			tree->save(path);
+			std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+			SnapshotHeader header;
+			file.read(reinterpret_cast<char*>(&header), sizeof(SnapshotHeader));
+			SnapshotNode root;
+			file.seekg(header.nodeOffset);
+			file.read(reinterpret_cast<char*>(&root), sizeof(SnapshotNode));
+			root.firstChild = header.nodeCount + 1000;
+			file.seekp(header.nodeOffset);
+			file.write(reinterpret_cast<const char*>(&root), sizeof(SnapshotNode));
+		}
+		bool nodeTest = false;
+		try {
+			MappedOctTree<unsigned int>::create(path);
+		}
+		catch (std::exception& e) {
+			nodeTest = true;
+		}
+		BOOST_TEST(nodeTest == true, "Snapshot test 5 did not trigger the expected exception!");
+		// Test6 trees of a collision detector are loaded and answer collision checks of their clusters
+		CLibCollisionController& cc = *CLibController["Collision-Test"];
+		CollisionDetection& cd = cc.getCollisionDetector();
+		cd.saveTrees(path);
+		{
+			CollisionDetection loaded;
+			loaded.loadTrees(path);
+			BOOST_TEST((loaded.getMappedTree(0)->getNearest(1, 1, 0) == cd.getOctTree(0)->getNearest(1, 1, 0)->getIds()) == true);
+			BOOST_TEST(loaded.getMappedTree(1)->getNodeCount() == cd.getOctTree(1)->getNodes().size());
+			auto cluster = cc.getAgentCluster(0);
+			auto candidate = cc.getAgent(8);
+			SimObjPtr nearest = nullptr, loadedNearest = nullptr;
+			double nearestDistance = 0, loadedDistance = 0;
+			IdSet<unsigned int> ignoreIDs;
+			bool collision = cd.checkForCollision(cluster, ignoreIDs, candidate, nearest, nearestDistance);
+			BOOST_TEST(loaded.checkForCollision(cluster, ignoreIDs, candidate, loadedNearest, loadedDistance) == collision);
+			BOOST_TEST((nearest == loadedNearest && nearestDistance == loadedDistance) == true, "Snapshot test 6 loaded tree found another nearest agent!");
+		}
+		std::remove(path.c_str());
+	}
+
+	void OctTreeTestBench::testOctTreeStats() {
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(8.0, 2.0);
+		tree->insertObject(0, Bounds(1, 1, 1), Bounds(1.5, 1.5, 1.5));
+		tree->insertObject(1, Bounds(-0.5, -0.5, -0.5), Bounds(0.5, 0.5, 0.5));
+		// Test1 object 1 occupies the eight leaves around the origin, one of them is shared with object 0
+		TreeStats stats = tree->getStats();
+		BOOST_TEST(stats.nodeCount == 17);
+		BOOST_TEST(stats.nodeCount == tree->getNodes().size());
+		BOOST_TEST(stats.leafCount == 8);
+		BOOST_TEST((stats.nodesPerDepth == std::vector<size_t>({ 1, 8, 8 })) == true);
+		BOOST_TEST((stats.leavesPerIdCount == std::vector<size_t>({ 0, 7, 1 })) == true);
+		BOOST_TEST(stats.emptyNodeCount == 9);
+		BOOST_TEST(stats.emptyNodeFraction == 9.0 / 17.0);
+		BOOST_TEST(stats.objectCount == 2);
+		BOOST_TEST(stats.idEntryCount == 9);
+		BOOST_TEST(stats.duplicationFactor == 4.5);
+		BOOST_TEST(stats.nodeBytes == tree->getAllocationStats().reservedBytes);
+		BOOST_TEST(stats.totalBytes == stats.nodeBytes + stats.idBytes + stats.objectBytes);
+		BOOST_TEST(stats.resizeCount == 0);
+		// Test2 growing and shrinking the root is counted
+		tree->setAllowResize(true);
+		tree->insertObject(2, Bounds(5, 5, 5), Bounds(5.5, 5.5, 5.5));
+		BOOST_TEST(tree->getStats().resizeCount == 1);
+		tree->removeObject(2);
+		BOOST_TEST(tree->getStats().resizeCount == 2);
+		// Test3 statistics of a cluster's tree
+		CLibCollisionController& cc = *CLibController["Contruction-Test"];
+		BOOST_TEST(cc.getClusterTreeStats(0, stats) == true);
+		BOOST_TEST(stats.nodeCount == cc.getCollisionDetector().getOctTree(0)->getNodes().size());
+		BOOST_TEST(stats.objectCount == 8);
+	}
+
+	void OctTreeTestBench::testOctTreeOverlaps() {
+		for (double looseness : { 1.0, 2.0 }) {
+			TreePtr<unsigned int> treeA = OctTree<unsigned int>::create(16.0, 1.0, looseness);
+			TreePtr<unsigned int> treeB = OctTree<unsigned int>::create(16.0, 2.0, looseness);
+			for (unsigned int id = 0; id < 30; id++) {
+				double x = -7.5 + (id * 37 % 15), y = -7.5 + (id * 11 % 15), z = -7.5 + (id * 5 % 15);
+				treeA->insertObject(id, Bounds(x, y, z), Bounds(x + 1.5, y + 0.5, z + 0.5));
+				treeB->insertObject(id, Bounds(z, x, y), Bounds(z + 0.5, x + 0.5, y + 2.5));
+			}
+			for (double margin : { 0.0, 1.0 }) {
+				// Test1 the dual-tree traversal finds the same pairs as comparing all bounding boxes
+				std::vector<std::pair<unsigned int, unsigned int>> expected, received;
+				for (unsigned int idA = 0; idA < 30; idA++) {
+					Bounds lbA, ubA, lbB, ubB;
+					treeA->getObjectBounds(idA, lbA, ubA);
+					for (unsigned int idB = 0; idB < 30; idB++) {
+						treeB->getObjectBounds(idB, lbB, ubB);
+						double dx = std::max(std::max(lbA.x - ubB.x, lbB.x - ubA.x), 0.0);
+						double dy = std::max(std::max(lbA.y - ubB.y, lbB.y - ubA.y), 0.0);
+						double dz = std::max(std::max(lbA.z - ubB.z, lbB.z - ubA.z), 0.0);
+						if (std::sqrt(dx * dx + dy * dy + dz * dz) <= margin) expected.push_back(std::make_pair(idA, idB));
+					}
+				}
+				BOOST_TEST(treeA->queryOverlaps(*treeB, margin, received) == expected.size());
+				BOOST_TEST((received == expected) == true, "Overlap test 1 (looseness " << looseness << ", margin " << margin << ") returned other pairs than the brute force!");
+				// Test2 swapping the trees swaps the pairs
+				received.clear();
+				treeB->queryOverlaps(*treeA, margin, received);
+				for (auto& pair : received) pair = std::make_pair(pair.second, pair.first);
+				std::sort(received.begin(), received.end());
+				BOOST_TEST((received == expected) == true, "Overlap test 2 (looseness " << looseness << ", margin " << margin << ") returned other pairs than the brute force!");
+			}
+		}
+	}
+
+	void OctTreeTestBench::testClusterCollision() {
+		CLibCollisionController& cc = *CLibController["Cluster-Collision-Test"];
+		BOOST_TEST(cc.createAgent(0, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(1, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(2, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(3, "SphereAgent") == true);
+		try {
+			cc.connectAgents(0, 1, 1, 0);
+			cc.connectAgents(2, 3, 1, 0);
+		}
+		catch (std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(1) == true);
+		auto& cd = cc.getCollisionDetector();
+		auto clusterA = cc.getAgentCluster(0);
+		auto clusterB = cc.getAgentCluster(1);
+		SimObjPtr nearestA = nullptr, nearestB = nullptr;
+		double nearestDistance = 0;
+		// Test1 both clusters occupy the same space
+		BOOST_TEST(cd.checkClusterCollision(clusterA, clusterB, nearestA, nearestB, nearestDistance) == true);
+		BOOST_TEST((nearestA != nullptr && nearestB != nullptr && nearestDistance < 0) == true);
+		// Test2 no bounding boxes are close after moving one cluster away
+		clusterB->move(Vector3d(0, 10, 0));
+		cd.sync(1);
+		BOOST_TEST(cd.checkClusterCollision(clusterA, clusterB, nearestA, nearestB, nearestDistance) == false);
+		BOOST_TEST((nearestA == nullptr && nearestB == nullptr) == true);
+		// Test3 a margin finds the closest pair without a collision, i.e. the spheres are 10 apart
+		BOOST_TEST(cd.checkClusterCollision(clusterA, clusterB, nearestA, nearestB, nearestDistance, 10.0) == false);
+		BOOST_TEST((nearestA != nullptr && nearestB != nullptr) == true);
+		BOOST_TEST((std::fabs(nearestDistance - 8.0) < 1e-9) == true, "Cluster collision test 3 expected distance 8 but received " << nearestDistance);
+		// Test4 agents agree with single agent checks
+		clusterB->move(Vector3d(0, -9, 0));
+		cd.sync(1);
+		bool collision = false;
+		SimObjPtr nearest = nullptr;
+		for (unsigned long id : { 2, 3 }) {
+			collision = cd.checkForCollision(clusterA, IdSet<unsigned int>(), cc.getAgent(id), nearest, nearestDistance) || collision;
+		}
+		BOOST_TEST(cd.checkClusterCollision(clusterA, clusterB, nearestA, nearestB, nearestDistance) == collision);
+		// Test5 a small sphere touching the cap of a rotated cylinder outside of the cube of its largest dimension
+		CLibCollisionController& rc = *CLibController["Rotated-Cluster-Collision-Test"];
+		BOOST_TEST(rc.createAgentCluster(0, "default") == true);
+		BOOST_TEST(rc.createAgentCluster(1, "default") == true);
+		BOOST_TEST(rc.createAgent(0, "CylinderAgent") == true);
+		BOOST_TEST(rc.createAgent(1, "SmallSphereAgent") == true);
+		BOOST_TEST(rc.addAgentToCluster(0, 0) == true);
+		BOOST_TEST(rc.addAgentToCluster(1, 1) == true);
+		rc.getAgent(0)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 4, Vector3d::UnitX())));
+		rc.getAgent(1)->setPosition(Vector3d(0, 1.04, -0.36));
+		BOOST_TEST(rc.addAgentClusterToCollisionDetector(0) == true);
+		BOOST_TEST(rc.addAgentClusterToCollisionDetector(1) == true);
+		auto& rcd = rc.getCollisionDetector();
+		BOOST_TEST(rcd.checkClusterCollision(rc.getAgentCluster(0), rc.getAgentCluster(1), nearestA, nearestB, nearestDistance, 0.0) == true);
+		BOOST_TEST((nearestA == rc.getAgent(0) && nearestB == rc.getAgent(1) && nearestDistance < 0) == true, "Cluster collision test 5 received distance " << nearestDistance);
+	}
+
+	void OctTreeTestBench::testRaycast() {
+		CLibCollisionController& cc = *CLibController["Raycast-Test"];
+		BOOST_TEST(cc.createAgentCluster(0, "default") == true);
+		BOOST_TEST(cc.createAgent(0, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(1, "CylinderAgent") == true);
+		BOOST_TEST(cc.createAgent(2, "EllipsoidAgent") == true);
+		for (unsigned long id : { 0, 1, 2 }) {
+			BOOST_TEST(cc.addAgentToCluster(id, 0) == true);
+		}
+		// the cylinder's axis points along the y-axis, the ellipsoid's smallest radius as well
+		cc.getAgent(1)->setPosition(Vector3d(5, 0, 0));
+		cc.getAgent(1)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 2, Vector3d::UnitX())));
+		cc.getAgent(2)->setPosition(Vector3d(10, 0, 0));
+		cc.getAgent(2)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 2, Vector3d::UnitZ())));
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		auto cluster = cc.getAgentCluster(0);
+		SimObjPtr hit = nullptr;
+		double hitDistance = 0;
+
+		// Test1 the boxes are entered front to back
+		NeighborArray<unsigned int> candidates;
+		BOOST_TEST(cd.getOctTree(0)->queryRay(Bounds(-5, 0, 0), Bounds(1, 0, 0), 100.0, candidates) == 3);
+		BOOST_TEST((candidates[0].id == 0 && candidates[1].id == 1 && candidates[2].id == 2) == true);
+		BOOST_TEST((std::fabs(candidates[0].distance - 4.0) < 1e-9) == true, "Raycast test 1 expected distance 4 but received " << candidates[0].distance);
+		// Test2 sphere
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), Bounds(-5, 0, 0), Bounds(2, 0, 0), 100.0, hit, hitDistance) == true);
+		BOOST_TEST((hit == cc.getAgent(0) && std::fabs(hitDistance - 4.0) < 1e-9) == true, "Raycast test 2 expected distance 4 but received " << hitDistance);
+		// Test3 ignored agents are passed through, the cylinder's mantle is hit
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>({ 0 }), Bounds(-5, 0, 0), Bounds(1, 0, 0), 100.0, hit, hitDistance) == true);
+		BOOST_TEST((hit == cc.getAgent(1) && std::fabs(hitDistance - 9.0) < 1e-9) == true, "Raycast test 3 expected distance 9 but received " << hitDistance);
+		// Test4 the cylinder's cap is hit in its global pose
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), Bounds(5, -10, 0), Bounds(0, 1, 0), 100.0, hit, hitDistance) == true);
+		BOOST_TEST((hit == cc.getAgent(1) && std::fabs(hitDistance - 7.0) < 1e-9) == true, "Raycast test 4 expected distance 7 but received " << hitDistance);
+		// Test5 the ellipsoid is hit in its global pose
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), Bounds(10, -10, 0), Bounds(0, 1, 0), 100.0, hit, hitDistance) == true);
+		BOOST_TEST((hit == cc.getAgent(2) && std::fabs(hitDistance - 9.0) < 1e-9) == true, "Raycast test 5 expected distance 9 but received " << hitDistance);
+		// Test6 hits beyond the maximal distance and rays passing between the agents are missed
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), Bounds(-5, 0, 0), Bounds(1, 0, 0), 3.0, hit, hitDistance) == false);
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), Bounds(2.5, -10, 0), Bounds(0, 1, 0), 100.0, hit, hitDistance) == false);
+		BOOST_TEST(hit == nullptr);
+		// Test7 rays starting inside an agent hit it immediately
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), Bounds(0, 0.5, 0), Bounds(0, 0, 1), 100.0, hit, hitDistance) == true);
+		BOOST_TEST((hit == cc.getAgent(0) && hitDistance == 0.0) == true);
+		// Test8 the batch form agrees with single rays
+		std::vector<Bounds> origins = { Bounds(-5, 0, 0), Bounds(5, -10, 0), Bounds(2.5, -10, 0), Bounds(10, -10, 0) };
+		std::vector<Bounds> directions = { Bounds(1, 0, 0), Bounds(0, 1, 0), Bounds(0, 1, 0), Bounds(0, 1, 0) };
+		std::vector<SimObjPtr> hits;
+		std::vector<double> hitDistances;
+		BOOST_TEST(cd.raycast(cluster, IdSet<unsigned int>(), origins, directions, 100.0, hits, hitDistances) == 3);
+		for (size_t i = 0; i < origins.size(); i++) {
+			bool found = cd.raycast(cluster, IdSet<unsigned int>(), origins[i], directions[i], 100.0, hit, hitDistance);
+			BOOST_TEST((found == (hits[i] != nullptr) && hit == hits[i] && hitDistance == hitDistances[i]) == true, "Raycast test 8 ray " << i << " differs from the single ray");
+		}
+		// Test9 the ordered traversal stops at the first hit, ignored objects are never visited
+		QueryPtr<unsigned int> query = OctTreeQuery<unsigned int>::create();
+		CountingRayVisitor visitor;
+		double nearestHit = cd.getOctTree(0)->queryRay(Bounds(-5, 0, 0), Bounds(1, 0, 0), 100.0, IdSet<unsigned int>(), visitor, *query);
+		BOOST_TEST((visitor.visits == 1 && std::fabs(nearestHit - 4.0) < 1e-9) == true, "Raycast test 9 visited " << visitor.visits << " objects");
+		visitor.visits = 0;
+		nearestHit = cd.getOctTree(0)->queryRay(Bounds(-5, 0, 0), Bounds(1, 0, 0), 100.0, IdSet<unsigned int>({ 0, 1 }), visitor, *query);
+		BOOST_TEST((visitor.visits == 1 && nearestHit > 9.0) == true, "Raycast test 9 visited " << visitor.visits << " objects");
+		// Test10 caller-owned query contexts agree with the collision detector's own context
+		candidates.clear();
+		BOOST_TEST(cd.getOctTree(0)->queryRay(Bounds(-5, 0, 0), Bounds(1, 0, 0), 100.0, candidates, *query) == 3);
+		BOOST_TEST((candidates[0].id == 0 && candidates[1].id == 1 && candidates[2].id == 2) == true);
+		SimObjPtr queryHit = nullptr;
+		double queryHitDistance = 0;
+		for (size_t i = 0; i < origins.size(); i++) {
+			bool found = cd.raycast(cluster, IdSet<unsigned int>(), origins[i], directions[i], 100.0, *query, queryHit, queryHitDistance);
+			BOOST_TEST((found == (hits[i] != nullptr) && queryHit == hits[i] && queryHitDistance == hitDistances[i]) == true, "Raycast test 10 ray " << i << " differs from the batch");
+		}
+		// Test11 a ray hitting the mantle of a rotated cylinder outside of the cube of its largest dimension
+		CLibCollisionController& rc = *CLibController["Rotated-Raycast-Test"];
+		BOOST_TEST(rc.createAgentCluster(0, "default") == true);
+		BOOST_TEST(rc.createAgent(0, "CylinderAgent") == true);
+		BOOST_TEST(rc.addAgentToCluster(0, 0) == true);
+		rc.getAgent(0)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 4, Vector3d::UnitX())));
+		BOOST_TEST(rc.addAgentClusterToCollisionDetector(0) == true);
+		BOOST_TEST(rc.getCollisionDetector().raycast(rc.getAgentCluster(0), IdSet<unsigned int>(), Bounds(-10, 1.04, -0.36), Bounds(1, 0, 0), 100.0, *query, hit, hitDistance) == true);
+		BOOST_TEST((hit == rc.getAgent(0) && std::fabs(hitDistance - 9.86) < 0.01) == true, "Raycast test 11 expected distance 9.86 but received " << hitDistance);
+	}
+
+	void OctTreeTestBench::testOctTreeRegionQueries() {
+		// a flat 7x7 grid of boxes with gaps between them
+		ObjectArray<unsigned int> objects;
+		for (int i = -3; i <= 3; i++) {
+			for (int j = -3; j <= 3; j++) {
+				objects.push_back(ObjectEntry<unsigned int>((i + 3) * 7 + (j + 3), Bounds(i - 0.4, j - 0.4, -0.4), Bounds(i + 0.4, j + 0.4, 0.4)));
+			}
+		}
+		for (double looseness : { 1.0, 2.0 }) {
+			TreePtr<unsigned int> tree = OctTree<unsigned int>::create(8.0, 0.5, looseness);
+			tree->insertObjects(objects);
+			// Test1 an unrotated box matches the box query
+			vector<unsigned int> results, expected;
+			tree->queryBox(Bounds(-1.5, -2.5, -1.0), Bounds(0.5, 1.0, 1.0), expected);
+			BOOST_TEST(tree->queryOBB(OrientedBox(Bounds(-0.5, -0.75, 0.0), Bounds(1.0, 1.75, 1.0), Bounds(1, 0, 0), Bounds(0, 1, 0), Bounds(0, 0, 1)), results) == expected.size());
+			BOOST_TEST(results == expected);
+			// Test2 a thin box along the diagonal only overlaps the boxes on the diagonal, its axis aligned bounds would overlap 25 boxes
+			results.clear();
+			expected.clear();
+			for (int i = -2; i <= 2; i++) expected.push_back((i + 3) * 7 + (i + 3));
+			double s = std::sqrt(0.5);
+			BOOST_TEST(tree->queryOBB(OrientedBox(Bounds(0, 0, 0), Bounds(2.0 / s, 0.01, 1.0), Bounds(s, s, 0), Bounds(-s, s, 0), Bounds(0, 0, 1)), results) == 5);
+			BOOST_TEST(results == expected, "\n Error in Region Query Test 2 with looseness " << looseness);
+			// Test3 a half-space contains the boxes below the diagonal and the diagonal itself
+			results.clear();
+			expected.clear();
+			for (int i = -3; i <= 3; i++) {
+				for (int j = -3; j <= 3; j++) {
+					if (i + j <= 0) expected.push_back((i + 3) * 7 + (j + 3));
+				}
+			}
+			std::sort(expected.begin(), expected.end());
+			BOOST_TEST(tree->queryPolytope({ Plane(Bounds(s, s, 0), 0.0) }, results) == 28);
+			BOOST_TEST(results == expected, "\n Error in Region Query Test 3 with looseness " << looseness);
+			// Test4 six planes bounding a box match the box query
+			results.clear();
+			expected.clear();
+			tree->queryBox(Bounds(-1.5, -2.5, -1.0), Bounds(0.5, 1.0, 1.0), expected);
+			std::vector<Plane> planes = { Plane(Bounds(-1, 0, 0), 1.5), Plane(Bounds(1, 0, 0), 0.5), Plane(Bounds(0, -1, 0), 2.5),
+				Plane(Bounds(0, 1, 0), 1.0), Plane(Bounds(0, 0, -1), 1.0), Plane(Bounds(0, 0, 1), 1.0) };
+			BOOST_TEST(tree->queryPolytope(planes, results) == expected.size());
+			BOOST_TEST(results == expected);
+		}
+		// Test5 the oriented bounding box of a rotated cylinder only overlaps the cylinder itself, not the ellipsoid next to it
+		CLibCollisionController& cc = *CLibController["Region-Test"];
+		BOOST_TEST(cc.createAgentCluster(0, "default") == true);
+		BOOST_TEST(cc.createAgent(0, "SphereAgent") == true);
+		BOOST_TEST(cc.createAgent(1, "CylinderAgent") == true);
+		BOOST_TEST(cc.createAgent(2, "EllipsoidAgent") == true);
+		for (unsigned long id : { 0, 1, 2 }) {
+			BOOST_TEST(cc.addAgentToCluster(id, 0) == true);
+		}
+		cc.getAgent(1)->setPosition(Vector3d(5, 0, 0));
+		cc.getAgent(1)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 2, Vector3d::UnitX())));
+		cc.getAgent(2)->setPosition(Vector3d(10, 0, 0));
+		cc.getAgent(2)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 2, Vector3d::UnitZ())));
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		vector<unsigned int> ids;
+		BOOST_TEST(cd.getOverlapCandidates(cc.getAgentCluster(0), cc.getAgent(1), ids) == 1);
+		BOOST_TEST(ids == vector<unsigned int>({ 1 }));
+		ids.clear();
+		BOOST_TEST(cd.getOverlapCandidates(cc.getAgentCluster(0), cc.getAgent(1), ids, 1.5) == 2);
+		BOOST_TEST(ids == vector<unsigned int>({ 1, 2 }));
+		// Test6 a small sphere next to the cap of a rotated cylinder in the tree, outside of the cube of the cylinder's largest dimension
+		CLibCollisionController& rc = *CLibController["Rotated-Region-Test"];
+		BOOST_TEST(rc.createAgentCluster(0, "default") == true);
+		BOOST_TEST(rc.createAgentCluster(1, "default") == true);
+		BOOST_TEST(rc.createAgent(0, "CylinderAgent") == true);
+		BOOST_TEST(rc.createAgent(1, "SmallSphereAgent") == true);
+		BOOST_TEST(rc.addAgentToCluster(0, 0) == true);
+		BOOST_TEST(rc.addAgentToCluster(1, 1) == true);
+		rc.getAgent(0)->setOrientation(Quaternion(Eigen::AngleAxisd(M_PI / 4, Vector3d::UnitX())));
+		rc.getAgent(1)->setPosition(Vector3d(0, 1.04, -0.36));
+		BOOST_TEST(rc.addAgentClusterToCollisionDetector(0) == true);
+		ids.clear();
+		BOOST_TEST(rc.getCollisionDetector().getOverlapCandidates(rc.getAgentCluster(0), rc.getAgent(1), ids) == 1);
+		BOOST_TEST(ids == vector<unsigned int>({ 0 }), "\n Error in Region Query Test 6, the rotated cylinder was not found");
+	}
+
+	void OctTreeTestBench::testOctTreeFreeze() {
+		ObjectArray<unsigned int> objects = makeScatteredObjects(120, Bounds(0.0, 0.0, -8.0), Bounds(8.0, 8.0, 0.13), 0.59, 1.37, 0.2, 0.3, 3);
+		TreePtr<unsigned int> tree = OctTree<unsigned int>::create(4.0, 0.5, 2.0);
+		tree->setAllowResize(true);
+		tree->insertObjects(objects);
+		MappedTreePtr<unsigned int> frozen = tree->freeze();
+		// Test1 the frozen tree answers queries like the tree it was frozen from
+		vector<vector<unsigned int>> expected;
+		vector<unsigned int> results;
+		unsigned int mismatches = 0;
+		for (double x = -9.0; x <= 9.0; x += 3.0) {
+			for (double y = -9.0; y <= 9.0; y += 4.5) {
+				expected.push_back(vector<unsigned int>());
+				tree->queryRadius(x, y, 0.0, 2.5, expected.back());
+				results.clear();
+				frozen->queryRadius(x, y, 0.0, 2.5, results);
+				if (results != expected.back()) mismatches++;
+			}
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Freeze Test 1, " << mismatches << " queries differ from the tree");
+		BOOST_TEST(frozen->getObjectCount() == 120);
+		// Test2 many threads query the frozen tree while the tree itself is modified and frozen again
+		std::atomic<unsigned int> readerMismatches(0);
+		vector<std::thread> readers;
+		for (unsigned int r = 0; r < 4; r++) {
+			readers.push_back(std::thread([&frozen, &expected, &readerMismatches]() {
+				vector<unsigned int> buffer;
+				for (unsigned int round = 0; round < 50; round++) {
+					size_t query = 0;
+					for (double x = -9.0; x <= 9.0; x += 3.0) {
+						for (double y = -9.0; y <= 9.0; y += 4.5) {
+							buffer.clear();
+							frozen->queryRadius(x, y, 0.0, 2.5, buffer);
+							if (buffer != expected[query++]) readerMismatches++;
+						}
+					}
+				}
+			}));
+		}
+		MappedTreePtr<unsigned int> refrozen = nullptr;
+		for (unsigned int i = 0; i < 60; i++) {
+			tree->removeObject(i);
+			if (i % 10 == 9) refrozen = tree->freeze();
+		}
+		for (auto& reader : readers) reader.join();
+		BOOST_TEST(readerMismatches == 0, "\n Error in Freeze Test 2, " << readerMismatches << " concurrent queries differ from the tree");
+		BOOST_TEST((frozen->containsObject(0) && !refrozen->containsObject(0) && refrozen->getObjectCount() == 60) == true);
+		// Test3 snapshots of a cluster are published again once its tree is synchronized, readers keep the snapshot they hold
+		CLibCollisionController& cc = *CLibController["Freeze-Test"];
+		BOOST_TEST(cc.createAgentCluster(0, "default") == true);
+		for (unsigned long id = 0; id < 3; id++) {
+			BOOST_TEST(cc.createAgent(id, "SphereAgent") == true);
+			BOOST_TEST(cc.addAgentToCluster(id, 0) == true);
+			cc.getAgent(id)->setPosition(Vector3d(4.0 * id, 0, 0));
+		}
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		BOOST_TEST(cd.getFrozenTree(0) == nullptr);
+		MappedTreePtr<unsigned int> published = cd.freezeTree(0);
+		BOOST_TEST((cd.getFrozenTree(0) == published && published->getObjectCount() == 3) == true);
+		Bounds lb, ub;
+		{
+			collision::PinnedFrozenTrees pinned = cd.getFrozenTrees();
+			cc.getAgent(0)->setPosition(Vector3d(0, 0, 10));
+			BOOST_TEST(cd.sync(0) == 1);
+			BOOST_TEST((cd.getFrozenTree(0) != published && cd.getFrozenTrees()->size() == 1) == true);
+			BOOST_TEST(pinned->at(0).tree == published, "\n Error in Freeze Test 3, a pinned map changed after the snapshot was published again");
+			BOOST_TEST((published->getObjectBounds(0, lb, ub) && lb.z == -1.0) == true);
+			BOOST_TEST((cd.getFrozenTree(0)->getObjectBounds(0, lb, ub) && lb.z == 9.0) == true);
+		}
+		// Test4 retired maps are deleted once no reader pinned them, i.e. only the test still holds the first snapshot
+		cc.getAgent(0)->setPosition(Vector3d(0, 0, 20));
+		BOOST_TEST(cd.sync(0) == 1);
+		BOOST_TEST(published.use_count() == 1, "\n Error in Freeze Test 4, a retired map was not deleted");
+		// Test5 readers pin and query the published map while the owner keeps publishing snapshots
+		std::atomic<bool> publishing(true);
+		readerMismatches = 0;
+		readers.clear();
+		for (unsigned int r = 0; r < 4; r++) {
+			readers.push_back(std::thread([&cd, &publishing, &readerMismatches]() {
+				while (publishing) {
+					collision::PinnedFrozenTrees pinned = cd.getFrozenTrees();
+					if (pinned->at(0).tree->getObjectCount() != 3) readerMismatches++;
+				}
+			}));
+		}
+		for (unsigned int i = 0; i < 200; i++) {
+			cc.getAgent(1)->setPosition(Vector3d(4.0, 0, 0.1 * (i % 2)));
+			cd.sync(0);
+		}
+		publishing = false;
+		for (auto& reader : readers) reader.join();
+		BOOST_TEST(readerMismatches == 0, "\n Error in Freeze Test 5, " << readerMismatches << " pinned maps differ from the tree");
+		BOOST_TEST((cd.getFrozenTree(0)->getObjectBounds(1, lb, ub) && lb.z == -0.9) == true);
+	}
+
+	void OctTreeTestBench::testBackgroundRebuild() {
+		CLibCollisionController& cc = *CLibController["Rebuild-Test"];
+		BOOST_TEST(cc.createAgentCluster(0, "default") == true);
+		for (unsigned long id = 0; id < 64; id++) {
+			BOOST_TEST(cc.createAgent(id, "SphereAgent") == true);
+			BOOST_TEST(cc.addAgentToCluster(id, 0) == true);
+			cc.getAgent(id)->setPosition(Vector3d(3.0 * (id % 4) - 4.5, 3.0 * ((id / 4) % 4) - 4.5, 3.0 * (id / 16) - 4.5));
+		}
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		auto cluster = cc.getAgentCluster(0);
+		// Test1 the previous tree is published before the rebuild starts
+		BOOST_TEST(cd.getTreeVersion(0) == 0);
+		cd.rebuildTreeAsync(0);
+		unsigned long version = 0;
+		MappedTreePtr<unsigned int> previous = cd.getFrozenTree(0, version);
+		BOOST_TEST((previous != nullptr && version >= 1 && previous->getObjectCount() == 64) == true);
+		// Test2 the simulation keeps moving agents and querying the previous tree during the rebuild
+		cc.getAgent(0)->setPosition(Vector3d(-10.5, -4.5, -4.5));
+		SimObjPtr nearest = nullptr;
+		double nearestDistance = 0;
+		BOOST_TEST(cd.checkForCollision(cluster, IdSet<unsigned int>({ 0 }), cc.getAgent(0), nearest, nearestDistance) == false);
+		bool failed = false;
+		try {
+			cd.rebuildTreeAsync(0);
+		}
+		catch (std::exception&) {
+			failed = true;
+		}
+		BOOST_TEST(failed == true, "\n Error in Rebuild Test 2, a cluster was rebuilt twice at once");
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		BOOST_TEST(cd.getFrozenTree(0) == previous, "\n Error in Rebuild Test 2, the new tree was published before it caught up with the agents");
+		// Test3 the rebuilt tree replaces the previous one and catches up with the moved agent
+		BOOST_TEST(cd.completeRebuilds(true) == 1);
+		BOOST_TEST(cd.completeRebuilds(true) == 0);
+		Bounds lb, ub;
+		BOOST_TEST((cd.getTree(0)->getObjectBounds(0, lb, ub) && lb.x == -11.5) == true);
+		BOOST_TEST((cd.getFrozenTree(0)->getObjectBounds(0, lb, ub) && lb.x == -11.5) == true);
+		BOOST_TEST(cd.getTreeVersion(0) > version, "\n Error in Rebuild Test 3, the version did not increase");
+		// Test4 snapshots held by readers stay valid
+		BOOST_TEST((previous->getObjectBounds(0, lb, ub) && lb.x == -5.5) == true);
+		vector<unsigned int> ids;
+		BOOST_TEST(previous->queryBox(Bounds(-5.0, -5.0, -5.0), Bounds(5.0, 5.0, 5.0), ids) == 64);
+		// Test5 collision checks use the rebuilt tree
+		BOOST_TEST(cd.checkForCollision(cluster, IdSet<unsigned int>({ 1 }), cc.getAgent(1), nearest, nearestDistance) == false);
+		BOOST_TEST((std::fabs(nearestDistance - 1.0) < 1e-9) == true, "\n Error in Rebuild Test 5 expected distance 1 but received " << nearestDistance);
+	}
+
+	void OctTreeTestBench::testOctTreeLeafSpheres() {
+		// the spheres of each node have to be aligned with its ids and enclose the bounds the tree stores for them
+		auto countMismatches = [](TreePtr<unsigned int> tree) {
+			unsigned int mismatches = 0;
+			for (auto& node : tree->getNodes()) {
+				const ObjectSphere* sphere = node->getSpheres();
+				for (auto id : node->getIds()) {
+					Bounds lb, ub;
+					ObjectSphere expected = (tree->getObjectBounds(id, lb, ub)) ? ObjectSphere(lb, ub) : ObjectSphere(Bounds(0, 0, 0), Bounds(-1, -1, -1));
+					if (sphere->x != expected.x || sphere->y != expected.y || sphere->z != expected.z || sphere->radius != expected.radius) mismatches++;
+					sphere++;
+				}
+			}
+			return mismatches;
+		};
+		ObjectArray<unsigned int> objects = makeScatteredObjects(120, Bounds(0.0, 0.0, -8.0), Bounds(8.0, 8.0, 0.13), 0.59, 1.37, 0.2, 0.3, 3);
+		// Test1 spheres follow the objects through bulk loading, updates, merged bounds, removals, splits and merges
+		for (double looseness : { 1.0, 2.0 }) {
+			for (unsigned int capacity : { 0u, 4u }) {
+				TreePtr<unsigned int> tree = OctTree<unsigned int>::create(16.0, 0.5, looseness);
+				if (capacity > 0) tree->setLeafCapacity(capacity, 2);
+				tree->insertObjects(ObjectArray<unsigned int>(objects.begin(), objects.begin() + 60));
+				for (unsigned int i = 60; i < 120; i++) tree->insertObject(i, objects[i].lower, objects[i].upper);
+				for (unsigned int i = 0; i < 120; i += 3) tree->updateObject(i, Bounds(objects[i].lower.x + 0.1, objects[i].lower.y, objects[i].lower.z), Bounds(objects[i].upper.x + 0.1, objects[i].upper.y, objects[i].upper.z));
+				tree->insertObject(7, Bounds(0.0, 0.0, 0.0), Bounds(1.0, 1.0, 1.0));
+				for (unsigned int i = 1; i < 120; i += 4) tree->removeObject(i);
+				BOOST_TEST(countMismatches(tree) == 0, "\n Error in Leaf Sphere Test 1 with looseness " << looseness << " and capacity " << capacity);
+			}
+		}
+		// Test2 the sphere of a body encloses it in any orientation
+		ObjectSphere sphere(Bounds(-1.0, -1.0, -1.0), Bounds(1.0, 1.0, 1.0));
+		BOOST_TEST((sphere.x == 0.0 && std::fabs(sphere.radius - std::sqrt(3.0)) < utils::EPS) == true);
+		BOOST_TEST((std::fabs(sphere.calcMinDistance(10.0, 0.0, 0.0, 1.0) - (9.0 - std::sqrt(3.0))) < utils::EPS) == true);
+		// Test3 collision checks reject candidates by their spheres and still find the same agents as checking all candidates of the nearest node
+		CLibCollisionController& cc = *CLibController["Leaf-Sphere-Test"];
+		BOOST_TEST(cc.createAgentCluster(0, "default") == true);
+		for (unsigned long id = 0; id < 64; id++) {
+			BOOST_TEST(cc.createAgent(id, "SphereAgent") == true);
+			BOOST_TEST(cc.addAgentToCluster(id, 0) == true);
+			cc.getAgent(id)->setPosition(Vector3d(3.0 * (id % 4) - 4.5, 3.0 * ((id / 4) % 4) - 4.5, 3.0 * (id / 16) - 4.5));
+		}
+		cc.getAgent(5)->setPosition(Vector3d(-0.5, -1.5, -4.5));
+		BOOST_TEST(cc.addAgentClusterToCollisionDetector(0) == true);
+		auto& cd = cc.getCollisionDetector();
+		auto cluster = cc.getAgentCluster(0);
+		cd.resetCandidateStats();
+		size_t candidateCount = 0;
+		unsigned int mismatches = 0;
+		for (unsigned long id = 0; id < 64; id++) {
+			IdSet<unsigned int> ignore({ static_cast<unsigned int>(id) });
+			const Vector3d& position = cc.getAgent(id)->getPosition(ReferenceFrame::Global);
+			NodePtr<unsigned int> node = cd.getOctTree(0)->getNearest(position.x(), position.y(), position.z(), ignore);
+			SimObjPtr expected = nullptr;
+			double expectedDistance = std::numeric_limits<double>::max();
+			for (auto other : node->getIds()) {
+				if (other == id) continue;
+				candidateCount++;
+				double distance = cd.calcBodyToBodyDistance(cc.getAgent(id), cc.getAgent(other));
+				if (distance < expectedDistance) {
+					expectedDistance = distance;
+					expected = cc.getAgent(other);
+				}
+				if (distance < 0) break;
+			}
+			SimObjPtr nearest = nullptr;
+			double nearestDistance = 0;
+			bool collision = cd.checkForCollision(cluster, ignore, cc.getAgent(id), nearest, nearestDistance);
+			if (collision != (expectedDistance < 0) || nearest != expected || nearestDistance != expectedDistance) mismatches++;
+		}
+		BOOST_TEST(mismatches == 0, "\n Error in Leaf Sphere Test 3, " << mismatches << " collision checks differ from checking all candidates");
+		// every candidate is either rejected by its sphere or looked up, and some lookups are skipped
+		const collision::CandidateStats& stats = cd.getCandidateStats();
+		BOOST_TEST((stats.candidateCount == stats.rejectedCount + stats.lookupCount) == true);
+		BOOST_TEST((stats.rejectedCount > 0 && stats.lookupCount < candidateCount) == true, "\n Error in Leaf Sphere Test 3, " << stats.lookupCount << " of " << candidateCount << " candidates were looked up");
+	}
+
 	void OctTreeTestBench::runAllTests() {
 		testOctTreeConstrution();
 		testOctTreeNearestSearch();
 		testOctTreeCollision();
+		testLinearOctTreeNearestSearch();
+		testOctTreeUpdate();
+		testLooseOctTree();
+		testOctTreeLeafCapacity();
+		testOctTreeBulkLoad();
+		testOctTreeParallelBuild();
+		testOctTreeKNearest();
+		testOctTreeRangeQueries();
+		testOctTreeIgnoreFilter();
+		testOctTreeQueryContext();
+		testOctTreeIdStorage();
+		testOctTreeGrowth();
+		testOctTreeNodeGeometry();
+		testOctTreeChildDistances();
+		testCollisionDetectionSync();
+		testOctTreeSnapshot();
+		testOctTreeStats();
+		testOctTreeOverlaps();
+		testClusterCollision();
+		testRaycast();
+		testOctTreeRegionQueries();
+		testOctTreeFreeze();
+		testBackgroundRebuild();
+		testOctTreeLeafSpheres();
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
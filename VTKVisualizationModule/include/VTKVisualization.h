@@ -32,7 +32,7 @@ namespace simobj {
 namespace collision {
 	namespace octtree {
 		template <typename T>
-		class OctTree;
+		class SpatialTree;
 
 	}
 }
@@ -50,8 +50,8 @@ namespace vis {
 	using std::shared_ptr;
 	using SimObjPtr = shared_ptr<SimulationObject>;
 	using ShapePtr = shared_ptr<Shape>;
-	using collision::octtree::OctTree;
-	using TreePtr = shared_ptr<OctTree<unsigned int>>;
+	using collision::octtree::SpatialTree;
+	using TreePtr = shared_ptr<SpatialTree<unsigned int>>;
 	using RenderPtr = shared_ptr<vtkSmartPointer<vtkRenderer> >;
 	using RenderWindowPtr = shared_ptr<vtkSmartPointer<vtkRenderWindow> >;
 	using RenderWindowInteractorPtr = shared_ptr<vtkSmartPointer<vtkRenderWindowInteractor> >;
@@ -100,7 +100,7 @@ namespace vis {
 			Tree nodes will be rendered as collection of wireframe boxes containing agents from the cluster from
 			which this tree was build. The tree and all contained agents will be displayed upon calling the display() method.
 			\param[in] cluster Smart pointer an AgentCluster-object.
-			\param[in] tree Smart pointer an OctTree-object representing the given cluster.
+			\param[in] tree Smart pointer to an OctTree- or LinearOctTree-object representing the given cluster.
 		*/
 		VTK_VISUALIZATION_API void renderCollisionTree(SimObjPtr cluster, TreePtr tree);
 
@@ -178,7 +178,7 @@ namespace vis {
 			\brief Render the OctTrees nodes as boxes and store internally.
 			If the display empty nodes flag is true the complete tree will be rendered.
 			Tree will be displayed upon calling the display() method.
-			\param[in] tree Smart pointer an OctTree-object representing a cluster.
+			\param[in] tree Smart pointer to an OctTree- or LinearOctTree-object representing a cluster.
 		*/
 		void renderTree(TreePtr tree);
 
@@ -33,8 +33,7 @@ VTK_MODULE_INIT(vtkRenderingOpenGL2); VTK_MODULE_INIT(vtkInteractionStyle); VTK_
 #include <AgentCluster.h>
 #include <Shape.h>
 
-#include <OctTree.h>
-#include <OctTreeNode.h>
+#include <SpatialTree.h>
 
 namespace vis {
 
@@ -52,9 +51,7 @@ namespace vis {
 	using simobj::shapes::Sphere;
 	using simobj::shapes::Cylinder;
 	using simobj::shapes::Ellipsoid;
-	using collision::octtree::OctTree;
 	using collision::octtree::Bounds;
-	using NodePtr = collision::octtree::NodePtr<unsigned int>;
 
 	VTK_VISUALIZATION_API VTKVisualization::VTKVisualization() {
 		createRenderer();
@@ -148,7 +145,8 @@ namespace vis {
 	}
 
 	void VTKVisualization::renderTree(TreePtr tree) {
-		std::vector<NodePtr> nodes = tree->getNodes();
+		std::vector<std::pair<Bounds, Bounds>> nodes;
+		tree->getNodeBounds(nodes, renderEmptyNodesOn);
 
 		vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
 		vtkSmartPointer<vtkFloatArray> scales =
@@ -157,11 +155,11 @@ namespace vis {
 
 		vtkSmartPointer<vtkCubeSource> cubeSource = vtkSmartPointer<vtkCubeSource>::New();
 
-		for (auto node : nodes) {
-			if (node->isEmpty() && !renderEmptyNodesOn) continue;
-			Bounds diameter = node->getDiameter();
-			points->InsertNextPoint(node->getX(), node->getY(), node->getZ());
-			scales->InsertNextValue(diameter.x);
+		for (auto& node : nodes) {
+			const Bounds& lb = node.first;
+			const Bounds& ub = node.second;
+			points->InsertNextPoint(lb.x + (ub.x - lb.x) / 2.0, lb.y + (ub.y - lb.y) / 2.0, lb.z + (ub.z - lb.z) / 2.0);
+			scales->InsertNextValue(ub.x - lb.x);
 		}
 
 		vtkSmartPointer<vtkPolyData> polydata = vtkSmartPointer<vtkPolyData>::New();